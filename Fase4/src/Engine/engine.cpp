@@ -46,6 +46,15 @@ staticCamera* static_camera;
 int camera_mode = 0; // 0 -> static   1 -> fps
 int draw_axis = 0;
 
+// Level of detail values
+int window_height = 1;
+float fov = 45.0f;
+int lods_enabled = 1;
+float lod_pixel_error = 1.0f;   // largest error allowed on screen, in pixels
+
+// View frustum culling
+int culling_enabled = 1;
+
 // FPS counter variables
 int timebase;
 float elapsed_frames;
@@ -60,6 +69,12 @@ void processMouseMotion(int xx, int yy);
 void processMouseButtons(int button, int state, int xx, int yy);
 void drawAxis(void);
 void drawGroup(Group g);
+void modelFrustum(float planes[6][4]);
+bool boxOutsideFrustum(float planes[6][4], const GLfloat min[3], const GLfloat max[3]);
+bool modelOutsideFrustum(Model& m, float planes[6][4]);
+void modelCamera(float camera[3]);
+bool clusterOutOfView(ModelCluster& cluster, float planes[6][4], const float camera[3]);
+ModelLOD* chooseModelLOD(Model& m);
 void drawModel(Model m);
 void engineHelpMenu();
 
@@ -73,6 +88,7 @@ void changeSize(int w, int h) {
 	// (you cant make a window with zero width).
 	if(h == 0)
 		h = 1;
+	window_height = h;
 
 	// compute window's aspect ratio
 	float ratio = w * 1.0 / h;
@@ -86,7 +102,7 @@ void changeSize(int w, int h) {
     glViewport(0, 0, w, h);
 
 	// Set perspective
-	gluPerspective(45.0f ,ratio, 1.0f ,500.0f);
+	gluPerspective(fov ,ratio, 1.0f ,500.0f);
 
 	// return to the model view matrix mode
 	glMatrixMode(GL_MODELVIEW);
@@ -185,6 +201,18 @@ void reactRegularKeys(unsigned char key, int xx, int yy) {
 		case 'p':
 			camera_mode ? fps_camera->saveCamera(FPS_CAMERA_CFG_FILE) : static_camera->saveCamera(STATIC_CAMERA_CFG_FILE);
 			break;
+		case 'o':
+			lods_enabled = !lods_enabled;
+			break;
+		case '+':
+			lod_pixel_error *= 2.0f;
+			break;
+		case '-':
+			if (lod_pixel_error > 0.125f) lod_pixel_error /= 2.0f;
+			break;
+		case 'c':
+			culling_enabled = !culling_enabled;
+			break;
 		case 27:
 			exit(0);
 			break;
@@ -284,6 +312,18 @@ void drawGroup(Group g) {
 		drawModel(model);
 	}
 
+	// Drawing the chunks of the terrains in this group, after loading the ones the camera got close to
+	vector<Terrain*> terrains = g.getTerrains();
+	for (Terrain* terrain : terrains) {
+		float camera[3];
+		modelCamera(camera);
+		terrain->update(camera);
+
+		for (Model* chunk : terrain->getLoadedChunks()) {
+			drawModel(*chunk);
+		}
+	}
+
 	// Drawing groups in this group
 	vector<Group> groups = g.getGroups();
 	for (Group group : groups) {
@@ -294,9 +334,135 @@ void drawGroup(Group g) {
 	glPopMatrix();
 }
 
+// Function to get the planes of the view frustum in model space, from the projection and model view matrices.
+// A point p is inside plane i if planes[i][0] * p.x + planes[i][1] * p.y + planes[i][2] * p.z + planes[i][3] >= 0,
+// and each plane is normalized so that value is a distance in model units
+void modelFrustum(float planes[6][4]) {
+	GLfloat projection[16], modelview[16], clip[16];
+	glGetFloatv(GL_PROJECTION_MATRIX, projection);
+	glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+
+	// Matrices are column-major, clip = projection * modelview
+	for (int col = 0; col < 4; col++) {
+		for (int row = 0; row < 4; row++) {
+			clip[col * 4 + row] = 0.0f;
+			for (int k = 0; k < 4; k++) clip[col * 4 + row] += projection[k * 4 + row] * modelview[col * 4 + k];
+		}
+	}
+
+	// Left, right, bottom, top, near and far planes: the last row plus or minus each of the others
+	for (int i = 0; i < 6; i++) {
+		int row = i / 2;
+		float sign = i % 2 == 0 ? 1.0f : -1.0f;
+		for (int col = 0; col < 4; col++) planes[i][col] = clip[col * 4 + 3] + sign * clip[col * 4 + row];
+
+		float length = sqrtf(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] + planes[i][2] * planes[i][2]);
+		if (length > 0.0f) {
+			for (int col = 0; col < 4; col++) planes[i][col] /= length;
+		}
+	}
+}
+
+// Function to check if a box is entirely outside one of the frustum planes, testing the corner furthest inside it
+bool boxOutsideFrustum(float planes[6][4], const GLfloat min[3], const GLfloat max[3]) {
+	for (int i = 0; i < 6; i++) {
+		float distance = planes[i][3];
+		for (int c = 0; c < 3; c++) distance += planes[i][c] * (planes[i][c] >= 0.0f ? max[c] : min[c]);
+		if (distance < 0.0f) return true;
+	}
+	return false;
+}
+
+// Function to check if a model is out of view, first with its bounding sphere and then with its bounding box
+bool modelOutsideFrustum(Model& m, float planes[6][4]) {
+	const GLfloat* centre = m.getSphereCentre();
+	for (int i = 0; i < 6; i++) {
+		float distance = planes[i][0] * centre[0] + planes[i][1] * centre[1] + planes[i][2] * centre[2] + planes[i][3];
+		if (distance < -m.getSphereRadius()) return true;
+	}
+	return boxOutsideFrustum(planes, m.getBoundsMin(), m.getBoundsMax());
+}
+
+// Function to get the position of the camera in model space, inverting the model view matrix
+void modelCamera(float camera[3]) {
+	GLfloat m[16];
+	glGetFloatv(GL_MODELVIEW_MATRIX, m);
+
+	// Solves M * camera = -translation by Cramer's rule, the columns of M being a, b and c
+	const float* a = &m[0];
+	const float* b = &m[4];
+	const float* c = &m[8];
+	float t[3] = {-m[12], -m[13], -m[14]};
+	auto det = [](const float* x, const float* y, const float* z) {
+		return x[0] * (y[1] * z[2] - y[2] * z[1]) - y[0] * (x[1] * z[2] - x[2] * z[1]) + z[0] * (x[1] * y[2] - x[2] * y[1]);
+	};
+	float d = det(a, b, c);
+	if (fabsf(d) < 1e-20f) d = 1e-20f;
+	camera[0] = det(t, b, c) / d;
+	camera[1] = det(a, t, c) / d;
+	camera[2] = det(a, b, t) / d;
+}
+
+// Function to check if a cluster is out of view, either outside the frustum or facing away from the camera
+bool clusterOutOfView(ModelCluster& cluster, float planes[6][4], const float camera[3]) {
+	for (int i = 0; i < 6; i++) {
+		float distance = planes[i][0] * cluster.centre[0] + planes[i][1] * cluster.centre[1] + planes[i][2] * cluster.centre[2] + planes[i][3];
+		if (distance < -cluster.radius) return true;
+	}
+	if (cluster.cone_cutoff >= 1.0f) return false;
+
+	float view[3] = {cluster.centre[0] - camera[0], cluster.centre[1] - camera[1], cluster.centre[2] - camera[2]};
+	float length = sqrtf(view[0] * view[0] + view[1] * view[1] + view[2] * view[2]);
+	float dot = view[0] * cluster.cone_axis[0] + view[1] * cluster.cone_axis[1] + view[2] * cluster.cone_axis[2];
+	return dot >= cluster.cone_cutoff * length + cluster.radius;
+}
+
+// Function to choose the coarsest level of detail of a model whose error, projected at the
+// distance of the closest point of its bounding sphere (or its origin) to the camera, stays below
+// lod_pixel_error pixels
+ModelLOD* chooseModelLOD(Model& m) {
+	ModelLOD* lods = m.getLODs();
+	int lod_count = m.getLODCount();
+	if (lod_count == 0) return nullptr;
+	if (!lods_enabled) return &lods[0];
+
+	// The model view matrix holds the model origin in camera space and the scale of the model
+	GLfloat matrix[16];
+	glGetFloatv(GL_MODELVIEW_MATRIX, matrix);
+	float scale = sqrtf(matrix[0] * matrix[0] + matrix[1] * matrix[1] + matrix[2] * matrix[2]);
+	float position[3] = {matrix[12], matrix[13], matrix[14]};
+	float radius = 0.0f;
+	if (m.hasBounds()) {
+		const GLfloat* centre = m.getSphereCentre();
+		for (int i = 0; i < 3; i++) position[i] += matrix[i] * centre[0] + matrix[4 + i] * centre[1] + matrix[8 + i] * centre[2];
+		radius = m.getSphereRadius() * scale;
+	}
+	float distance = sqrtf(position[0] * position[0] + position[1] * position[1] + position[2] * position[2]) - radius;
+	if (distance < 1e-6f) return &lods[0];
+
+	// Pixels per model unit at that distance
+	float pixels = scale * window_height / (2.0f * distance * tanf(fov * (float) M_PI / 360.0f));
+
+	int chosen = 0;
+	for (int i = 1; i < lod_count; i++) {
+		if (lods[i].error * pixels <= lod_pixel_error) chosen = i;
+	}
+	return &lods[chosen];
+}
+
 // Function to draw a single model
 void drawModel(Model m) {
 
+	// Models out of view are skipped, large models only draw the regions in view and models split
+	// in clusters only the clusters in view and facing the camera
+	float planes[6][4], camera[3];
+	bool culled = culling_enabled && m.hasBounds();
+	if (culled) {
+		modelFrustum(planes);
+		if (modelOutsideFrustum(m, planes)) return;
+		if (m.getClusterCount() > 0) modelCamera(camera);
+	}
+
 	// Set model material properties
 	glMaterialfv(GL_FRONT, GL_AMBIENT, m.getAmbient());
 	glMaterialfv(GL_FRONT, GL_DIFFUSE, m.getDiffuse());
@@ -306,25 +472,107 @@ void drawModel(Model m) {
 
 	// Bind points VBO
 	glBindBuffer(GL_ARRAY_BUFFER, m.getPVBOInd());
-	glVertexPointer(3, GL_FLOAT, 0, 0);
+	glVertexPointer(3, m.getPointType(), m.getPointStride(), 0);
 
 	// If defined, bind normals VBO
 	GLuint n_vbo_ind = m.getNVBOInd();
 	if (n_vbo_ind != 0) {
 		glBindBuffer(GL_ARRAY_BUFFER, n_vbo_ind);
-		glNormalPointer(GL_FLOAT, 0, 0);
+		glNormalPointer(m.getNormalType(), m.getNormalStride(), 0);
 	}
 
 	// If defined, bind textures VBO
 	GLuint t_vbo_ind = m.getTVBOInd();
 	if (t_vbo_ind != 0) {
 		glBindBuffer(GL_ARRAY_BUFFER, t_vbo_ind);
-		glTexCoordPointer(2, GL_FLOAT, 0, 0);
+		glTexCoordPointer(2, m.getTextureType(), 0, 0);
 		glBindTexture(GL_TEXTURE_2D, m.getTextureID());
 	}
 
-	glDrawArrays(GL_TRIANGLES, 0, m.getVerticeCount());
+	// Indexed models are drawn with their index buffer, older models as independent triangles.
+	// Models with levels of detail only draw the range of indices of the chosen level
+	GLuint i_vbo_ind = m.getIVBOInd();
+	ModelLOD* lod = chooseModelLOD(m);
+
+	// Strips restart at the largest index of their type. Restart is only on while they're drawn, as the indices
+	// of triangle lists must never restart
+	bool restart = m.getMode() == GL_TRIANGLE_STRIP;
+#ifdef GL_PRIMITIVE_RESTART
+	if (restart) {
+		glEnable(GL_PRIMITIVE_RESTART);
+		glPrimitiveRestartIndex(m.getIndexType() == GL_UNSIGNED_SHORT ? 0xFFFF : 0xFFFFFFFF);
+	}
+#endif
+
+	// Quantized points are scaled and moved back to the model's place. The scale is the same in every
+	// axis and normals are renormalized, so they keep their direction
+	if (m.isQuantized()) {
+		const GLfloat* centre = m.getQuantizationCentre();
+		GLfloat scale = m.getQuantizationScale();
+		glPushMatrix();
+		glTranslatef(centre[0], centre[1], centre[2]);
+		glScalef(scale, scale, scale);
+	}
+	if (i_vbo_ind != 0 && culled && (m.getClusterCount() > 0 || m.getRegionCount() > 0)) {
+		GLsizeiptr index_size = m.getIndexType() == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+		GLsizei first = lod ? lod->first_index : 0;
+		GLsizei last = lod ? lod->first_index + lod->index_count : m.getIndexCount();
+		GLuint first_vertex = lod ? lod->first_vertex : 0;
+		GLuint last_vertex = lod ? lod->last_vertex : m.getVerticeCount() - 1;
+		ModelCluster* clusters = m.getClusters();
+		ModelRegion* regions = m.getRegions();
+		int parts = clusters ? m.getClusterCount() : m.getRegionCount();
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, i_vbo_ind);
+
+		// Consecutive clusters (or regions) in view are drawn together
+		GLsizei range_first = 0, range_count = 0;
+		for (int i = 0; i <= parts; i++) {
+			GLsizei part_first = 0, part_indices = 0;
+			bool visible = false;
+			if (i < parts && clusters) {
+				part_first = clusters[i].first_index;
+				part_indices = clusters[i].index_count;
+				visible = part_first >= first && part_first + part_indices <= last && !clusterOutOfView(clusters[i], planes, camera);
+			}
+			else if (i < parts) {
+				part_first = regions[i].first_index;
+				part_indices = regions[i].index_count;
+				visible = part_first >= first && part_first + part_indices <= last && !boxOutsideFrustum(planes, regions[i].min, regions[i].max);
+			}
+
+			if (visible && range_count > 0 && range_first + range_count == part_first) {
+				range_count += part_indices;
+				continue;
+			}
+			if (range_count > 0) {
+				glDrawRangeElements(m.getMode(), first_vertex, last_vertex, range_count, m.getIndexType(),
+									(const GLvoid*) (range_first * index_size));
+			}
+			range_first = visible ? part_first : 0;
+			range_count = visible ? part_indices : 0;
+		}
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+	else if (i_vbo_ind != 0 && lod) {
+		GLsizeiptr index_size = m.getIndexType() == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, i_vbo_ind);
+		glDrawRangeElements(m.getMode(), lod->first_vertex, lod->last_vertex, lod->index_count, m.getIndexType(),
+							(const GLvoid*) (lod->first_index * index_size));
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+	else if (i_vbo_ind != 0) {
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, i_vbo_ind);
+		glDrawElements(m.getMode(), m.getIndexCount(), m.getIndexType(), 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+	else {
+		glDrawArrays(GL_TRIANGLES, 0, m.getVerticeCount());
+	}
 
+#ifdef GL_PRIMITIVE_RESTART
+	if (restart) glDisable(GL_PRIMITIVE_RESTART);
+#endif
+	if (m.isQuantized()) glPopMatrix();
 	glBindTexture(GL_TEXTURE_2D, 0);
 }
 
@@ -356,6 +604,10 @@ void engineHelpMenu() {
 	std::cout << "│    › t : Cycle between drawing modes                        │" << endl;
 	std::cout << "│    › 1 : Sets camera to static mode                         │" << endl;
 	std::cout << "│    › 2 : Sets camera to fps mode                            │" << endl;
+	std::cout << "│    › o : Toggle levels of detail                            │" << endl;
+	std::cout << "│    › + : Double the error allowed on screen                 │" << endl;
+	std::cout << "│    › - : Halve the error allowed on screen                  │" << endl;
+	std::cout << "│    › c : Toggle view frustum culling                        │" << endl;
 	std::cout << "│                                                             │" << endl;
 	std::cout << "│    Press ESC at any time to exit program                    │" << endl;
 	std::cout << "└─────────────────────────────────────────────────────────────┘" << endl;
@@ -260,6 +260,14 @@ vector<Model> Group::getModels() {
     return this->models;
 }
 
+void Group::addTerrain(Terrain* terrain) {
+    this->terrains.push_back(terrain);
+}
+
+vector<Terrain*> Group::getTerrains() {
+    return this->terrains;
+}
+
 void Group::addGroup(Group group) {
     this->groups.push_back(group);
 }
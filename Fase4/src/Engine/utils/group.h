@@ -2,6 +2,7 @@
 #define GROUP_H
 
 #include "model.h"
+#include "terrain.h"
 #include "../../utils/ponto.h"
 
 #define CATMULL_TESSELATION 0.01
@@ -112,6 +113,7 @@ class Group {
         vector<Transformation*> transformations;
         Color* color;
         vector<Model> models;
+        vector<Terrain*> terrains;  // shared by the copies of the group, as they stream chunks in and out
         vector<Group> groups;
     public:
         Group();
@@ -127,6 +129,8 @@ class Group {
 
         void addModel(Model model);
         vector<Model> getModels();
+        void addTerrain(Terrain* terrain);
+        vector<Terrain*> getTerrains();
         void addGroup(Group group);
         vector<Group> getGroups();
 };
@@ -39,3 +39,22 @@ void Model::loadTexture(string texture_file) {
 
 	glBindTexture(GL_TEXTURE_2D, 0);
 }
+
+// Releases the VBOs and the arrays of the model, leaving it empty. The texture and material are shared and kept
+void Model::unload() {
+	GLuint vbos[4] = {this->p_vbo_ind, this->n_vbo_ind, this->t_vbo_ind, this->i_vbo_ind};
+	for (int i = 0; i < 4; i++) {
+		if (vbos[i] != 0) glDeleteBuffers(1, &vbos[i]);
+	}
+	this->p_vbo_ind = this->n_vbo_ind = this->t_vbo_ind = this->i_vbo_ind = 0;
+	this->vertice_count = 0;
+	this->index_count = 0;
+
+	delete[] this->lods;
+	delete[] this->regions;
+	delete[] this->clusters;
+	this->lods = nullptr;
+	this->regions = nullptr;
+	this->clusters = nullptr;
+	this->lod_count = this->region_count = this->cluster_count = 0;
+}
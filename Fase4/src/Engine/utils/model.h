@@ -5,26 +5,88 @@
 
 using namespace std;
 
+// Level of detail of a model: a range of its indices, drawing vertices first_vertex to last_vertex.
+// error is the largest distance between the level and the real surface, in model units
+class ModelLOD {
+    public:
+        GLsizei first_index = 0;
+        GLsizei index_count = 0;
+        GLuint first_vertex = 0;
+        GLuint last_vertex = 0;
+        GLfloat error = 0.0f;
+};
+
+// Region of a model: a range of its indices and the bounding box of the points it draws, in model units
+class ModelRegion {
+    public:
+        GLsizei first_index = 0;
+        GLsizei index_count = 0;
+        GLfloat min[3] = {0.0f, 0.0f, 0.0f};
+        GLfloat max[3] = {0.0f, 0.0f, 0.0f};
+};
+
+// Cluster of a model: a range of its indices, the sphere around its points and the cone of its triangle normals.
+// It faces away from cameras where dot(centre - camera, cone_axis) >= cone_cutoff * |centre - camera| + radius
+class ModelCluster {
+    public:
+        GLsizei first_index = 0;
+        GLsizei index_count = 0;
+        GLfloat centre[3] = {0.0f, 0.0f, 0.0f};
+        GLfloat radius = 0.0f;
+        GLfloat cone_axis[3] = {0.0f, 0.0f, 0.0f};
+        GLfloat cone_cutoff = 1.0f;
+};
+
 class Model {
     private:
         GLuint p_vbo_ind;
         GLuint n_vbo_ind;
         GLuint t_vbo_ind;
+        GLuint i_vbo_ind;
         GLuint texture_id;
 
         GLsizei vertice_count;
+        GLsizei index_count;
+        GLenum index_type;
+        GLenum mode = GL_TRIANGLES;     // GL_TRIANGLE_STRIP for strips joined by the largest index of index_type
         GLfloat* ambient;
         GLfloat* specular;
         GLfloat* diffuse;
         GLfloat* emissive;
         GLfloat shininess = 0.0;
+        ModelLOD* lods = nullptr;   // from the finest to the coarsest
+        int lod_count = 0;
+
+        // Types of the arrays in the VBOs. Quantized points are scaled and moved back when drawn
+        GLenum point_type = GL_FLOAT;
+        GLsizei point_stride = 0;
+        GLenum normal_type = GL_FLOAT;
+        GLsizei normal_stride = 0;
+        GLenum texture_type = GL_FLOAT;
+        bool quantized = false;
+        GLfloat quantization_centre[3] = {0.0f, 0.0f, 0.0f};
+        GLfloat quantization_scale = 1.0f;
+
+        // Bounding box and sphere of the points, in model units, and the boxes of ranges of large models
+        bool bounded = false;
+        GLfloat bounds_min[3] = {0.0f, 0.0f, 0.0f};
+        GLfloat bounds_max[3] = {0.0f, 0.0f, 0.0f};
+        GLfloat sphere_centre[3] = {0.0f, 0.0f, 0.0f};
+        GLfloat sphere_radius = 0.0f;
+        ModelRegion* regions = nullptr;
+        int region_count = 0;
+        ModelCluster* clusters = nullptr;
+        int cluster_count = 0;
     public:
         Model() {
             this->p_vbo_ind = 0;
             this->n_vbo_ind = 0;
             this->t_vbo_ind = 0;
+            this->i_vbo_ind = 0;
             this->texture_id = 0;
             this->vertice_count = 0;
+            this->index_count = 0;
+            this->index_type = GL_UNSIGNED_INT;
             this->ambient = nullptr;
             this->specular = nullptr;
             this->diffuse = nullptr;
@@ -34,10 +96,56 @@ class Model {
             this->p_vbo_ind = p_vbo_ind;
             this->n_vbo_ind = n_vbo_ind;
             this->t_vbo_ind = t_vbo_ind;
+            this->i_vbo_ind = 0;
+            this->texture_id = 0;
             this->vertice_count = vertice_count;
+            this->index_count = 0;
+            this->index_type = GL_UNSIGNED_INT;
+        };
+
+        void setTextureID(GLuint id) {this->texture_id = id;};
+        void setIndices(GLuint i_vbo_ind, GLsizei index_count, GLenum index_type) {
+            this->i_vbo_ind = i_vbo_ind;
+            this->index_count = index_count;
+            this->index_type = index_type;
+        };
+
+        void setMode(GLenum mode) {this->mode = mode;};
+
+        void setLODs(ModelLOD* lods, int lod_count) {
+            this->lods = lods;
+            this->lod_count = lod_count;
         };
 
-        void setTextureID(GLuint id) {this->texture_id = texture_id;};
+        void setAttributeTypes(GLenum point_type, GLsizei point_stride, GLenum normal_type, GLsizei normal_stride, GLenum texture_type) {
+            this->point_type = point_type;
+            this->point_stride = point_stride;
+            this->normal_type = normal_type;
+            this->normal_stride = normal_stride;
+            this->texture_type = texture_type;
+        };
+        void setQuantization(const GLfloat centre[3], GLfloat scale) {
+            this->quantized = true;
+            for (int i = 0; i < 3; i++) this->quantization_centre[i] = centre[i];
+            this->quantization_scale = scale;
+        };
+        void setBounds(const GLfloat min[3], const GLfloat max[3], const GLfloat centre[3], GLfloat radius) {
+            this->bounded = true;
+            for (int i = 0; i < 3; i++) {
+                this->bounds_min[i] = min[i];
+                this->bounds_max[i] = max[i];
+                this->sphere_centre[i] = centre[i];
+            }
+            this->sphere_radius = radius;
+        };
+        void setRegions(ModelRegion* regions, int region_count) {
+            this->regions = regions;
+            this->region_count = region_count;
+        };
+        void setClusters(ModelCluster* clusters, int cluster_count) {
+            this->clusters = clusters;
+            this->cluster_count = cluster_count;
+        };
 
         void setAmbient(GLfloat* ambient) {this->ambient = ambient;};
         void setSpecular(GLfloat* specular) {this->specular = specular;};
@@ -47,7 +155,30 @@ class Model {
         GLuint getPVBOInd() {return this->p_vbo_ind;};
         GLuint getNVBOInd() {return this->n_vbo_ind;};
         GLuint getTVBOInd() {return this->t_vbo_ind;};
+        GLuint getIVBOInd() {return this->i_vbo_ind;};
         GLsizei getVerticeCount() {return this->vertice_count;};
+        GLsizei getIndexCount() {return this->index_count;};
+        GLenum getIndexType() {return this->index_type;};
+        GLenum getMode() {return this->mode;};
+        GLenum getPointType() {return this->point_type;};
+        GLsizei getPointStride() {return this->point_stride;};
+        GLenum getNormalType() {return this->normal_type;};
+        GLsizei getNormalStride() {return this->normal_stride;};
+        GLenum getTextureType() {return this->texture_type;};
+        bool isQuantized() {return this->quantized;};
+        const GLfloat* getQuantizationCentre() {return this->quantization_centre;};
+        GLfloat getQuantizationScale() {return this->quantization_scale;};
+        ModelLOD* getLODs() {return this->lods;};
+        int getLODCount() {return this->lod_count;};
+        bool hasBounds() {return this->bounded;};
+        const GLfloat* getBoundsMin() {return this->bounds_min;};
+        const GLfloat* getBoundsMax() {return this->bounds_max;};
+        const GLfloat* getSphereCentre() {return this->sphere_centre;};
+        GLfloat getSphereRadius() {return this->sphere_radius;};
+        ModelRegion* getRegions() {return this->regions;};
+        int getRegionCount() {return this->region_count;};
+        ModelCluster* getClusters() {return this->clusters;};
+        int getClusterCount() {return this->cluster_count;};
 
         GLuint getTextureID() {return this->texture_id;};
 
@@ -58,6 +189,7 @@ class Model {
         GLfloat getShininess() {return this->shininess;};
 
         void loadTexture(string texture_file);
+        void unload();
 };
 
 #endif //MODEL_H
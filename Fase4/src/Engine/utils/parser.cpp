@@ -7,15 +7,24 @@
 #endif
 
 #include <vector>
+#include <map>
 #include <string>
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <cstdio>
 
 #include "model.h"
 #include "group.h"
 #include "lights.h"
 #include "../../lib/tinyxml2.h"
+#include "../../utils/file3d.h"
+#include "../../utils/bounds.h"
+#include "../../Generator/primitives.h"
+#include "../../Generator/bezier.h"
+#include "../../Generator/cleanup.h"
+#include "../../Generator/strips.h"
+#include "../../Generator/parallel.h"
 
 #include "parser.h"
 
@@ -24,6 +33,266 @@
 using namespace tinyxml2;
 using namespace std;
 
+// Function to push the arrays of a model to VBOs, each vertex taking point_size, normal_size and texture_size bytes.
+// Normals, textures and indices are optional
+Model createModelVBOs(GLsizei vertice_count, const void* points, GLsizeiptr point_size, const void* normals, GLsizeiptr normal_size,
+					  const void* textures, GLsizeiptr texture_size, GLsizei index_count, GLenum index_type, const void* indices) {
+	GLuint p_vbo_ind;
+	GLuint n_vbo_ind = 0;
+	GLuint t_vbo_ind = 0;
+	GLuint i_vbo_ind = 0;
+
+	// Push points to VBO
+	glGenBuffers(1, &p_vbo_ind);
+	glBindBuffer(GL_ARRAY_BUFFER, p_vbo_ind);
+	glBufferData(GL_ARRAY_BUFFER, point_size * vertice_count, points, GL_STATIC_DRAW);
+
+	if (normals) {
+		// Push normals to VBO
+		glGenBuffers(1, &n_vbo_ind);
+		glBindBuffer(GL_ARRAY_BUFFER, n_vbo_ind);
+		glBufferData(GL_ARRAY_BUFFER, normal_size * vertice_count, normals, GL_STATIC_DRAW);
+	}
+
+	if (textures) {
+		// Push textures to VBO
+		glGenBuffers(1, &t_vbo_ind);
+		glBindBuffer(GL_ARRAY_BUFFER, t_vbo_ind);
+		glBufferData(GL_ARRAY_BUFFER, texture_size * vertice_count, textures, GL_STATIC_DRAW);
+	}
+
+	Model model = Model(p_vbo_ind, n_vbo_ind, t_vbo_ind, vertice_count);
+
+	if (index_count > 0) {
+		// Push indices to VBO
+		GLsizeiptr index_size = index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+		glGenBuffers(1, &i_vbo_ind);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, i_vbo_ind);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_size * index_count, indices, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		model.setIndices(i_vbo_ind, index_count, index_type);
+	}
+
+	return model;
+}
+
+// Whether OpenGL can restart triangle strips at an index, which it can since version 3.1
+static bool primitiveRestartSupported() {
+#ifdef GL_PRIMITIVE_RESTART
+	return GLEW_VERSION_3_1;
+#else
+	return false;
+#endif
+}
+
+// Whether every index refers to one of vertice_count vertices, as OpenGL doesn't check them.
+// The indices of strips can also be the restart index, the largest of their size
+static bool validIndices(const void* indices, GLsizei index_count, size_t index_size, GLsizei vertice_count, bool strips) {
+	for (GLsizei i = 0; i < index_count; i++) {
+		uint32_t index = index_size == sizeof(uint16_t) ? ((const uint16_t*) indices)[i] : ((const uint32_t*) indices)[i];
+		bool restart = strips && index == (index_size == sizeof(uint16_t) ? 0xFFFFu : 0xFFFFFFFFu);
+		if (index >= (uint32_t) vertice_count && !restart) return false;
+	}
+	return true;
+}
+
+// Function to load a binary .3d file into a VBO. The arrays in the file are handed directly to OpenGL
+Model loadBinary3dFile(string _3dFile, vector<char>& data) {
+	File3DHeader header;
+	if (!decodeFile3DHeader(data.data(), data.size(), &header)) {
+		std::cout << "Invalid binary .3d file: " << _3dFile.c_str() << "\n";
+		return Model();
+	}
+
+	bool b_normals = header.flags & FILE3D_HAS_NORMALS;
+	bool b_textures = header.flags & FILE3D_HAS_TEXTURES;
+	GLsizei vertice_count = (GLsizei) header.vertice_count;
+	GLsizei index_count = (GLsizei) header.index_count;
+
+	bool b_quantized = header.flags & FILE3D_QUANTIZED;
+	void* points = data.data() + header.points_offset;
+	void* normals = b_normals ? data.data() + header.normals_offset : nullptr;
+	void* textures = b_textures ? data.data() + header.textures_offset : nullptr;
+	void* indices = index_count > 0 ? data.data() + header.indices_offset : nullptr;
+
+	// Files are little-endian, so big-endian hosts need to convert them first. Quantized normals are bytes
+	if (!hostIsLittleEndian()) {
+		if (b_quantized) {
+			swapEndianness(points, vertice_count * 4, sizeof(int16_t));
+			if (textures) swapEndianness(textures, vertice_count * 2, sizeof(uint16_t));
+		}
+		else {
+			swapEndianness(points, vertice_count * 3, sizeof(float));
+			if (normals) swapEndianness(normals, vertice_count * 3, sizeof(float));
+			if (textures) swapEndianness(textures, vertice_count * 2, sizeof(float));
+		}
+		if (indices) swapEndianness(indices, index_count, header.index_size);
+	}
+	if (indices && !validIndices(indices, index_count, header.index_size, vertice_count, header.flags & FILE3D_TRIANGLE_STRIPS)) {
+		std::cout << "Invalid indices in file: " << _3dFile.c_str() << "\n";
+		return Model();
+	}
+
+	GLenum index_type = header.index_size == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	GLsizeiptr texture_size = FILE3D_TEXTURE_SIZE(header.flags);
+	GLenum texture_type = GL_FLOAT;
+
+	// Quantized texture coordinates are half floats, converted to floats if OpenGL can't read them
+	vector<float> float_textures;
+	if (b_quantized && textures) {
+#ifdef GL_HALF_FLOAT
+		bool half_floats = GLEW_VERSION_3_0 || GLEW_ARB_half_float_vertex;
+#else
+		bool half_floats = false;
+#endif
+		if (half_floats) {
+			texture_type = GL_HALF_FLOAT;
+		}
+		else {
+			const uint16_t* halfs = (const uint16_t*) textures;
+			float_textures.resize(vertice_count * 2);
+			for (GLsizei i = 0; i < vertice_count * 2; i++) float_textures[i] = halfToFloat(halfs[i]);
+			textures = float_textures.data();
+			texture_size = 2 * sizeof(float);
+		}
+	}
+
+	// Levels of detail, moved along with their indices when strips are converted to triangles
+	vector<File3DLOD> file_lods(header.lod_count);
+	bool valid_lods = header.lod_count == 0 || decodeFile3DLODs(data.data(), &header, file_lods.data());
+
+	// Triangle strips are drawn as they are if OpenGL can restart them, and converted to triangles otherwise.
+	// Each level of detail is converted on its own, as strips never continue into the next one
+	bool b_strips = header.flags & FILE3D_TRIANGLE_STRIPS;
+	vector<unsigned int> triangles;
+	vector<GLushort> short_triangles;
+	if (b_strips && indices && !primitiveRestartSupported()) {
+		bool short_indices = index_type == GL_UNSIGNED_SHORT;
+		vector<unsigned int> strip_indices(index_count);
+		for (GLsizei i = 0; i < index_count; i++) {
+			strip_indices[i] = short_indices ? ((const uint16_t*) indices)[i] : ((const uint32_t*) indices)[i];
+		}
+		unsigned int restart_index = short_indices ? 0xFFFF : MESH_RESTART_INDEX;
+
+		if (header.lod_count == 0 || !valid_lods) {
+			stripsToTriangles(strip_indices.data(), strip_indices.size(), restart_index, &triangles);
+		}
+		else {
+			for (File3DLOD& lod : file_lods) {
+				uint32_t first_index = (uint32_t) triangles.size();
+				stripsToTriangles(&strip_indices[lod.first_index], lod.index_count, restart_index, &triangles);
+				lod.first_index = first_index;
+				lod.index_count = (uint32_t) triangles.size() - first_index;
+			}
+		}
+
+		index_count = (GLsizei) triangles.size();
+		indices = triangles.data();
+		if (short_indices) {
+			short_triangles.assign(triangles.begin(), triangles.end());
+			indices = short_triangles.data();
+		}
+		b_strips = false;
+	}
+
+	Model model = createModelVBOs(vertice_count, points, FILE3D_POINT_SIZE(header.flags), normals, FILE3D_NORMAL_SIZE(header.flags),
+								  textures, texture_size, index_count, index_type, indices);
+	if (b_strips) model.setMode(GL_TRIANGLE_STRIP);
+
+	// Quantized points are 16-bit integers with a padding value, quantized normals bytes with a padding byte
+	if (b_quantized) {
+		model.setAttributeTypes(GL_SHORT, FILE3D_POINT_SIZE(header.flags), GL_BYTE, FILE3D_NORMAL_SIZE(header.flags), texture_type);
+		model.setQuantization(header.quantization_centre, header.quantization_scale);
+	}
+
+	// Bounds computed by the generator, with the boxes of the regions of large models
+	if (header.flags & FILE3D_HAS_BOUNDS) {
+		model.setBounds(header.bounds_min, header.bounds_max, header.sphere_centre, header.sphere_radius);
+
+		vector<File3DRegion> file_regions(header.region_count);
+		if (header.region_count > 0 && decodeFile3DRegions(data.data(), &header, file_regions.data())) {
+			ModelRegion* regions = new ModelRegion[header.region_count];
+			for (uint32_t i = 0; i < header.region_count; i++) {
+				regions[i].first_index = (GLsizei) file_regions[i].first_index;
+				regions[i].index_count = (GLsizei) file_regions[i].index_count;
+				for (int c = 0; c < 3; c++) {
+					regions[i].min[c] = file_regions[i].min[c];
+					regions[i].max[c] = file_regions[i].max[c];
+				}
+			}
+			model.setRegions(regions, (int) header.region_count);
+		}
+		else if (header.region_count > 0) {
+			std::cout << "Invalid regions in file: " << _3dFile.c_str() << "\n";
+		}
+	}
+
+	// Clusters, each with its bounding sphere and normal cone
+	if (header.cluster_count > 0) {
+		vector<File3DCluster> file_clusters(header.cluster_count);
+		if (decodeFile3DClusters(data.data(), &header, file_clusters.data())) {
+			ModelCluster* clusters = new ModelCluster[header.cluster_count];
+			for (uint32_t i = 0; i < header.cluster_count; i++) {
+				clusters[i].first_index = (GLsizei) file_clusters[i].first_index;
+				clusters[i].index_count = (GLsizei) file_clusters[i].index_count;
+				for (int c = 0; c < 3; c++) {
+					clusters[i].centre[c] = file_clusters[i].centre[c];
+					clusters[i].cone_axis[c] = file_clusters[i].cone_axis[c];
+				}
+				clusters[i].radius = file_clusters[i].radius;
+				clusters[i].cone_cutoff = file_clusters[i].cone_cutoff;
+			}
+			model.setClusters(clusters, (int) header.cluster_count);
+		}
+		else {
+			std::cout << "Invalid clusters in file: " << _3dFile.c_str() << "\n";
+		}
+	}
+
+	// Levels of detail
+	if (header.lod_count > 0) {
+		if (!valid_lods) {
+			std::cout << "Invalid levels of detail in file: " << _3dFile.c_str() << "\n";
+			return model;
+		}
+
+		ModelLOD* lods = new ModelLOD[header.lod_count];
+		for (uint32_t i = 0; i < header.lod_count; i++) {
+			lods[i].first_index = (GLsizei) file_lods[i].first_index;
+			lods[i].index_count = (GLsizei) file_lods[i].index_count;
+			lods[i].first_vertex = file_lods[i].first_vertex;
+			lods[i].last_vertex = file_lods[i].first_vertex + file_lods[i].vertice_count - 1;
+			lods[i].error = file_lods[i].error;
+		}
+		model.setLODs(lods, (int) header.lod_count);
+	}
+
+	return model;
+}
+
+// Creates the VBOs of a model from float arrays, computing its bounds. Small models use 16-bit indices
+Model createFloatModel(GLsizei vertice_count, const float* points, const float* normals, const float* textures, const vector<GLuint>& indices) {
+	GLsizei index_count = (GLsizei) indices.size();
+	Model model;
+
+	if (vertice_count <= FILE3D_MAX_SHORT_INDEX + 1) {
+		vector<GLushort> short_indices(indices.begin(), indices.end());
+		model = createModelVBOs(vertice_count, points, 3 * sizeof(float), normals, 3 * sizeof(float),
+								textures, 2 * sizeof(float), index_count, GL_UNSIGNED_SHORT, short_indices.data());
+	}
+	else {
+		model = createModelVBOs(vertice_count, points, 3 * sizeof(float), normals, 3 * sizeof(float),
+								textures, 2 * sizeof(float), index_count, GL_UNSIGNED_INT, indices.data());
+	}
+
+	// Only binary files store their bounds, so they're computed here
+	Bounds bounds = computeBounds(FloatPoints(points, vertice_count));
+	model.setBounds(bounds.min, bounds.max, bounds.centre, bounds.radius);
+
+	return model;
+}
+
 // Function to load a .3d file into a VBO
 Model load3dFile(string _3dFile) {
     string line;
@@ -32,12 +301,32 @@ Model load3dFile(string _3dFile) {
 	vector<float> points;
 	vector<float> normals;
 	vector<float> textures;
+	vector<GLuint> indices;
+
+	// Binary files are detected by their magic number, otherwise the file is parsed as text
+	file.open(_3dFile.c_str(), ios::in | ios::binary);
+	char magic[FILE3D_MAGIC_SIZE];
+	if (file.is_open() && file.read(magic, FILE3D_MAGIC_SIZE) && isBinary3dFile(magic, FILE3D_MAGIC_SIZE)) {
+		file.seekg(0, ios::end);
+		vector<char> data((size_t) file.tellg());
+		file.seekg(0, ios::beg);
+		file.read(data.data(), data.size());
+		file.close();
+
+		return loadBinary3dFile(_3dFile, data);
+	}
+	file.close();
 
 	file.open(_3dFile.c_str(), ios::in);
 
-	// Get number of points in file
+	// Get number of points in file, followed by the number of indices if the model is indexed
+	// and the number of levels of detail if there's more than one
 	getline(file, line);
-	int nr_points = atoi(line.c_str());
+	int nr_points = 0;
+	int nr_indices = 0;
+	int nr_lods = 0;
+	istringstream countsStream(line);
+	countsStream >> nr_points >> nr_indices >> nr_lods;
 
 	// Check if there's normals in the file
 	getline(file, line);
@@ -49,6 +338,21 @@ Model load3dFile(string _3dFile) {
 	bool b_textures;
 	line == "true" ? b_textures = true : b_textures = false;
 
+	// Read levels of detail: first index, index count, first vertex, vertex count and error
+	ModelLOD* lods = nr_lods > 0 ? new ModelLOD[nr_lods] : nullptr;
+	bool empty_lods = false;
+	for (int j = 0; j < nr_lods; j++) {
+		getline(file, line);
+
+		GLuint vertice_count = 0;
+		char comma;
+		istringstream lodStream(line);
+		lodStream >> lods[j].first_index >> comma >> lods[j].index_count >> comma >> lods[j].first_vertex >> comma
+				  >> vertice_count >> comma >> lods[j].error;
+		if (vertice_count == 0) empty_lods = true;
+		lods[j].last_vertex = lods[j].first_vertex + vertice_count - 1;
+	}
+
 	// Read from file
 	if (file.is_open()) {
 		// Read points from file
@@ -91,6 +395,18 @@ Model load3dFile(string _3dFile) {
 			}
 		}
 
+		// Read indices from file, three per line
+		for (int j = 0; j < nr_indices; j += 3) {
+			getline(file, line);
+
+			string token;
+			istringstream tokenStream(line);
+
+			while (getline(tokenStream, token, ',')) {
+				indices.push_back((GLuint) atol(token.c_str()));
+			}
+		}
+
 		file.close();
 	}
 	else {
@@ -98,31 +414,27 @@ Model load3dFile(string _3dFile) {
 	}
 
 	GLsizei vertice_count = (GLsizei) (points.size() / 3);
-
-	GLuint p_vbo_ind;
-	GLuint n_vbo_ind = 0;
-	GLuint t_vbo_ind = 0;
-	
-	// Push points to VBO
-	glGenBuffers(1, &p_vbo_ind);
-	glBindBuffer(GL_ARRAY_BUFFER, p_vbo_ind);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * points.size(), points.data(), GL_STATIC_DRAW);
-
-	if (b_normals) {
-		// Push normals to VBO
-		glGenBuffers(1, &n_vbo_ind);
-		glBindBuffer(GL_ARRAY_BUFFER, n_vbo_ind);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * normals.size(), normals.data(), GL_STATIC_DRAW);
+	GLsizei index_count = (GLsizei) indices.size();
+	if (!validIndices(indices.data(), index_count, sizeof(GLuint), vertice_count, false)) {
+		std::cout << "Invalid indices in file: " << _3dFile.c_str() << "\n";
+		delete[] lods;
+		return Model();
 	}
-
-	if (b_textures) {
-		// Push textures to VBO
-		glGenBuffers(1, &t_vbo_ind);
-		glBindBuffer(GL_ARRAY_BUFFER, t_vbo_ind);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * textures.size(), textures.data(), GL_STATIC_DRAW);
+	Model model = createFloatModel(vertice_count, points.data(), b_normals ? normals.data() : nullptr,
+								   b_textures ? textures.data() : nullptr, indices);
+
+	// Levels of detail that are empty or outside the file are ignored
+	for (int j = 0; j < nr_lods; j++) {
+		if (empty_lods || lods[j].first_index < 0 || lods[j].index_count <= 0 || lods[j].first_index + lods[j].index_count > index_count ||
+			(GLsizei) lods[j].last_vertex >= vertice_count) {
+			std::cout << "Invalid levels of detail in file: " << _3dFile.c_str() << "\n";
+			delete[] lods;
+			return model;
+		}
 	}
+	if (nr_lods > 0) model.setLODs(lods, nr_lods);
 
-	return Model(p_vbo_ind, n_vbo_ind, t_vbo_ind, vertice_count);
+	return model;
 }
 
 // Function to parse a float from an element attribute. If the attribute does not exist, returns the default value
@@ -134,6 +446,102 @@ float parseFloatFromElementAttribute(const XMLElement* element, string name, flo
 	return value;
 }
 
+// Models generated from primitive elements, by primitive and parameters, so identical ones share their VBOs
+static map<string, Model> primitive_models;
+
+// Function to generate the model of a primitive element straight into VBOs, like the generator would write it:
+// <model primitive="sphere" radius="1" slices="64" stacks="32"/>. Returns false if the primitive isn't valid
+bool generatePrimitiveModel(const XMLElement* model_element, string primitive, Model* model) {
+	Mesh mesh;
+	vector<float> params;
+	string patch;
+
+	// Parameters of each primitive, in the order of the generator's arguments
+	if (primitive == "plane") {
+		params = {parseFloatFromElementAttribute(model_element, "size", 1.0f)};
+	}
+	else if (primitive == "box") {
+		params = {parseFloatFromElementAttribute(model_element, "x", 1.0f), parseFloatFromElementAttribute(model_element, "y", 1.0f),
+				  parseFloatFromElementAttribute(model_element, "z", 1.0f), parseFloatFromElementAttribute(model_element, "divisions", 1.0f)};
+	}
+	else if (primitive == "sphere") {
+		params = {parseFloatFromElementAttribute(model_element, "radius", 1.0f), parseFloatFromElementAttribute(model_element, "slices", 32.0f),
+				  parseFloatFromElementAttribute(model_element, "stacks", 32.0f)};
+	}
+	else if (primitive == "icosphere") {
+		params = {parseFloatFromElementAttribute(model_element, "radius", 1.0f), parseFloatFromElementAttribute(model_element, "subdivisions", 3.0f)};
+	}
+	else if (primitive == "cone") {
+		params = {parseFloatFromElementAttribute(model_element, "radius", 1.0f), parseFloatFromElementAttribute(model_element, "height", 2.0f),
+				  parseFloatFromElementAttribute(model_element, "slices", 32.0f), parseFloatFromElementAttribute(model_element, "stacks", 8.0f)};
+	}
+	else if (primitive == "torus") {
+		params = {parseFloatFromElementAttribute(model_element, "inner", 0.5f), parseFloatFromElementAttribute(model_element, "outer", 1.0f),
+				  parseFloatFromElementAttribute(model_element, "slices", 32.0f), parseFloatFromElementAttribute(model_element, "stacks", 32.0f)};
+	}
+	else if (primitive == "bezier") {
+		const XMLAttribute* patch_attribute = model_element->FindAttribute("patch");
+		patch_attribute ? patch = patch_attribute->Value() : patch = "";
+		params = {parseFloatFromElementAttribute(model_element, "tessellation", 8.0f), parseFloatFromElementAttribute(model_element, "tolerance", 0.0f)};
+	}
+	else {
+		std::cout << "Unknown primitive: " << primitive.c_str() << "\n";
+		return false;
+	}
+
+	// Divisions are whole numbers, checked like the generator does, so a scene can't build a shape it would reject
+	auto divisions = [&](size_t i) {return (int) params[i];};
+	bool valid = true;
+	if (primitive == "box") valid = validDivisions("divisions", divisions(3), BOX_MIN_DIVISIONS);
+	else if (primitive == "sphere")
+		valid = validDivisions("slices", divisions(1), SPHERE_MIN_SLICES) && validDivisions("stacks", divisions(2), SPHERE_MIN_STACKS);
+	else if (primitive == "icosphere") valid = validDivisions("subdivisions", divisions(1), 0, ICOSPHERE_MAX_SUBDIVISIONS);
+	else if (primitive == "cone")
+		valid = validDivisions("slices", divisions(2), CONE_MIN_SLICES) && validDivisions("stacks", divisions(3), CONE_MIN_STACKS);
+	else if (primitive == "torus")
+		valid = validDivisions("slices", divisions(2), TORUS_MIN_SLICES) && validDivisions("stacks", divisions(3), TORUS_MIN_STACKS);
+	else if (primitive == "bezier" && params[1] <= 0.0f)
+		valid = validDivisions("tessellation", divisions(0), BEZIER_MIN_TESSELLATION);
+	if (!valid) {
+		std::cout << "Invalid primitive: " << primitive.c_str() << "\n";
+		return false;
+	}
+
+	// Every digit of a parameter changes the model, to_string would keep only 6 decimals
+	string key = primitive + " " + patch;
+	for (float param : params) {
+		char text[32];
+		snprintf(text, sizeof(text), " %.9g", param);
+		key += text;
+	}
+	auto found = primitive_models.find(key);
+	if (found != primitive_models.end()) {
+		*model = found->second;
+		return true;
+	}
+
+	if (primitive == "plane") plane(params[0], &mesh);
+	else if (primitive == "box") box(params[0], params[1], params[2], divisions(3), &mesh);
+	else if (primitive == "sphere") sphere(params[0], divisions(1), divisions(2), &mesh, defaultThreadCount());
+	else if (primitive == "icosphere") icosphere(params[0], divisions(1), &mesh);
+	else if (primitive == "cone") cone(params[0], params[1], divisions(2), divisions(3), &mesh);
+	else if (primitive == "torus") torus(params[0], params[1], divisions(3), divisions(2), &mesh, defaultThreadCount());
+	else if (primitive == "bezier") {
+		PatchFile patch_file;
+		if (!readPatchFile(_PATCHFILESFOLDER + patch, &patch_file)) return false;
+
+		// Bezier surfaces are cleaned up, like the generator does by default
+		if (params[1] > 0.0f) bezierPatchesAdaptive(&patch_file, params[1], &mesh, defaultThreadCount());
+		else bezierPatches(&patch_file, divisions(0), &mesh, defaultThreadCount());
+		cleanupMesh(&mesh);
+	}
+
+	*model = createFloatModel((GLsizei) mesh.getVerticeCount(), mesh.points.data(), mesh.normals.empty() ? nullptr : mesh.normals.data(),
+							  mesh.textures.empty() ? nullptr : mesh.textures.data(), mesh.indices);
+	primitive_models[key] = *model;
+	return true;
+}
+
 // Function to parse a translate element inside a group element
 void parseXMLTranslateElement (XMLElement* translate_element, Group* new_group) {
 	// Trying to get time attribute, so we know if it's a static or dynamic translation
@@ -343,11 +751,20 @@ Group parseXMLGroupElement (XMLElement* main_element) {
 		while (model_element) {
 			Model model;
 
-			// Parse model file attribute
+			// Parse model file attribute, or generate the model of a primitive attribute
 			const XMLAttribute* file_attribute = model_element->FindAttribute("file");
+			const XMLAttribute* primitive_attribute = model_element->FindAttribute("primitive");
+			bool loaded = false;
 			if (file_attribute) {
 				string file = file_attribute->Value();
 				model = load3dFile(_3DFILESFOLDER + file);
+				loaded = true;
+			}
+			else if (primitive_attribute) {
+				loaded = generatePrimitiveModel(model_element, primitive_attribute->Value(), &model);
+			}
+
+			if (loaded) {
 
 				// Get diffuse attributes
 				GLfloat* diffuse = parseDiffuseAttributes(model_element, 0.8);
@@ -379,6 +796,37 @@ Group parseXMLGroupElement (XMLElement* main_element) {
 		}
 	}
 
+	// Trying to get terrain elements, streamed in chunks around the camera
+	XMLElement* terrain_element = main_element->FirstChildElement("terrain");
+	while (terrain_element) {
+		const XMLAttribute* file_attribute = terrain_element->FindAttribute("file");
+		if (file_attribute) {
+			string file = file_attribute->Value();
+			float radius = parseFloatFromElementAttribute(terrain_element, "radius", 0.0f);
+
+			Terrain* terrain = new Terrain();
+			if (terrain->open(_3DFILESFOLDER + file, radius)) {
+				// Material and texture shared by every chunk
+				Model material;
+				material.setDiffuse(parseDiffuseAttributes(terrain_element, 0.8));
+				material.setSpecular(parseSpecularAttributes(terrain_element, 0.0));
+				material.setEmissive(parseEmissiveAttributes(terrain_element, 0.0));
+				material.setAmbient(parseAmbientAttributes(terrain_element, 0.2));
+
+				const XMLAttribute* texture_attribute = terrain_element->FindAttribute("texture");
+				string texture_file;
+				texture_attribute ? texture_file = texture_attribute->Value() : texture_file = "";
+				material.loadTexture(BIN_IMAGE_DIR + texture_file);
+
+				terrain->setMaterial(material);
+				new_group.addTerrain(terrain);
+			}
+			else delete terrain;
+		}
+
+		terrain_element = terrain_element->NextSiblingElement("terrain");
+	}
+
 	// Trying to get group elements
 	XMLElement* group_element = main_element->FirstChildElement("group");
 	while (group_element) {
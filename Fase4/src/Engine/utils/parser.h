@@ -2,7 +2,9 @@
 #define PARSER_H
 
 #define _3DFILESFOLDER "../../files3D/"
+#define _PATCHFILESFOLDER "../../filesPATCH/"
 
+Model loadBinary3dFile(string _3dFile, vector<char>& data);
 int loadXMLFile(string xmlFileString, vector<Group>* groups_vector, vector<Light*>* lights_vector);
 
 #endif //PARSER_H
@@ -0,0 +1,119 @@
+#include <stdlib.h>
+#ifdef __APPLE__
+#include <GLUT/glut.h>
+#else
+#include <GL/glew.h>
+#include <GL/glut.h>
+#endif
+
+#include <math.h>
+#include <algorithm>
+#include <iostream>
+
+#include "terrain.h"
+#include "group.h"
+#include "lights.h"
+#include "parser.h"
+
+using namespace std;
+
+// Reads the header and chunk table of a terrain file, without loading any chunk.
+// A load_radius of 0 loads the chunks within three chunks of the camera
+bool Terrain::open(string fileString, float load_radius) {
+	this->fileString = fileString;
+	this->file.open(fileString, ios::in | ios::binary);
+	if (!this->file.is_open()) {
+		std::cout << "Unable to open file: " << fileString.c_str() << "\n";
+		return false;
+	}
+
+	char header_bytes[FILE3D_TERRAIN_HEADER_SIZE];
+	this->file.read(header_bytes, FILE3D_TERRAIN_HEADER_SIZE);
+	if (!decodeFile3DTerrainHeader(header_bytes, (size_t) this->file.gcount(), &this->header)) {
+		std::cout << "Invalid terrain file: " << fileString.c_str() << "\n";
+		return false;
+	}
+
+	size_t chunk_count = (size_t) this->header.chunks_x * this->header.chunks_z;
+	vector<char> table(chunk_count * FILE3D_TERRAIN_CHUNK_SIZE);
+	this->file.seekg(this->header.chunks_offset);
+	this->file.read(table.data(), table.size());
+	if ((size_t) this->file.gcount() != table.size()) {
+		std::cout << "Invalid terrain file: " << fileString.c_str() << "\n";
+		return false;
+	}
+
+	this->chunks.resize(chunk_count);
+	for (size_t i = 0; i < chunk_count; i++) decodeFile3DTerrainChunk(table.data() + i * FILE3D_TERRAIN_CHUNK_SIZE, &this->chunks[i]);
+	this->models.resize(chunk_count);
+	this->loaded.assign(chunk_count, false);
+	this->load_radius = load_radius > 0.0f ? load_radius : 3.0f * this->header.chunk_size;
+	return true;
+}
+
+// Reads a chunk's .3d file from the terrain file and uploads it
+void Terrain::load(size_t chunk) {
+	File3DTerrainChunk& entry = this->chunks[chunk];
+	uint64_t offset = (uint64_t) entry.offset_low | (uint64_t) entry.offset_high << 32;
+
+	vector<char> data(entry.size);
+	this->file.clear();
+	this->file.seekg((streamoff) offset);
+	this->file.read(data.data(), data.size());
+	if ((size_t) this->file.gcount() != data.size()) {
+		std::cout << "Unable to read chunk " << entry.x << ", " << entry.z << " of file: " << this->fileString.c_str() << "\n";
+		this->loaded[chunk] = true;    // not tried again
+		return;
+	}
+
+	string chunkName = this->fileString + " chunk " + to_string(entry.x) + ", " + to_string(entry.z);
+	Model model = loadBinary3dFile(chunkName, data);
+	model.setAmbient(this->material.getAmbient());
+	model.setDiffuse(this->material.getDiffuse());
+	model.setSpecular(this->material.getSpecular());
+	model.setEmissive(this->material.getEmissive());
+	model.setTextureID(this->material.getTextureID());
+
+	this->models[chunk] = model;
+	this->loaded[chunk] = true;
+}
+
+void Terrain::unload(size_t chunk) {
+	this->models[chunk].unload();
+	this->models[chunk] = Model();
+	this->loaded[chunk] = false;
+}
+
+// Releases the chunks that got too far from the camera (in terrain space) and loads the closest ones
+// within the load radius, at most TERRAIN_LOADS_PER_FRAME of them
+void Terrain::update(const float camera[3]) {
+	vector<pair<float, size_t>> missing;
+
+	for (size_t i = 0; i < this->chunks.size(); i++) {
+		// Distance from the camera to the chunk's bounding box
+		float distance2 = 0.0f;
+		for (int c = 0; c < 3; c++) {
+			float d = max(max(this->chunks[i].min[c] - camera[c], camera[c] - this->chunks[i].max[c]), 0.0f);
+			distance2 += d * d;
+		}
+		float distance = sqrtf(distance2);
+
+		if (this->loaded[i] && distance > this->load_radius * UNLOAD_FACTOR) unload(i);
+		else if (!this->loaded[i] && distance <= this->load_radius) missing.push_back(make_pair(distance, i));
+	}
+
+	sort(missing.begin(), missing.end());
+	for (size_t i = 0; i < missing.size() && i < TERRAIN_LOADS_PER_FRAME; i++) load(missing[i].second);
+}
+
+vector<Model*> Terrain::getLoadedChunks() {
+	vector<Model*> chunks;
+	for (size_t i = 0; i < this->models.size(); i++) {
+		if (this->loaded[i] && this->models[i].getPVBOInd() != 0) chunks.push_back(&this->models[i]);
+	}
+	return chunks;
+}
+
+int Terrain::getLoadedCount() {
+	return (int) count(this->loaded.begin(), this->loaded.end(), true);
+}
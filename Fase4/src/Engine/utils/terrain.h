@@ -0,0 +1,43 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include "model.h"
+#include "../../utils/file3d.h"
+
+using namespace std;
+
+// Largest number of chunks read and uploaded in a single frame, so moving around a terrain doesn't stall it
+#define TERRAIN_LOADS_PER_FRAME 2
+
+// Terrain streamed from a chunked terrain file: only the chunks within load_radius of the camera are kept in
+// VBOs, each one drawn as a model with its own level of detail. Chunks are released once they're further than
+// UNLOAD_FACTOR times that radius, so chunks at the edge aren't loaded and released every frame
+class Terrain {
+    private:
+        string fileString;
+        ifstream file;
+        File3DTerrainHeader header;
+        vector<File3DTerrainChunk> chunks;
+        vector<Model> models;
+        vector<bool> loaded;
+        float load_radius = 0.0f;
+        Model material;     // material and texture of every chunk
+
+        void load(size_t chunk);
+        void unload(size_t chunk);
+    public:
+        static constexpr float UNLOAD_FACTOR = 1.25f;
+
+        bool open(string fileString, float load_radius);
+        void setMaterial(Model material) {this->material = material;};
+
+        void update(const float camera[3]);
+        vector<Model*> getLoadedChunks();
+        int getLoadedCount();
+};
+
+#endif //TERRAIN_H
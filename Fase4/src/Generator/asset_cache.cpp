@@ -0,0 +1,132 @@
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <thread>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "asset_cache.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+AssetCache::AssetCache(string directory, uint64_t size_limit) {
+    if (!directory.empty() && directory.back() != '/') directory += '/';
+    this->directory = directory;
+    this->size_limit = size_limit;
+}
+
+// Two 64-bit hashes of the same bytes, FNV-1a and a multiply-xorshift one, so keys are 128 bits
+class KeyHash {
+    public:
+        uint64_t h1 = 0xcbf29ce484222325ULL;
+        uint64_t h2 = 0x9e3779b97f4a7c15ULL;
+
+        void add(const char* data, size_t size) {
+            for (size_t i = 0; i < size; i++) {
+                uint8_t byte = (uint8_t) data[i];
+                this->h1 = (this->h1 ^ byte) * 0x100000001b3ULL;
+                this->h2 = (this->h2 ^ byte) * 0xff51afd7ed558ccdULL;
+                this->h2 ^= this->h2 >> 29;
+            }
+        };
+        // Each value ends with a zero, so "1" "23" and "12" "3" are different
+        void add(const string& value) {add(value.c_str(), value.size() + 1);};
+};
+
+// Numbers are written the same way however they're given, so "1" and "1.0" are the same input
+static string normalizedInput(const string& input) {
+    char* end;
+    double value = strtod(input.c_str(), &end);
+    if (input.empty() || *end != '\0') return input;
+
+    char text[32];
+    snprintf(text, sizeof(text), "%.9g", value);
+    return text;
+}
+
+// Key of an asset: the generator version, its inputs (shape, parameters and options, not the output file)
+// and the contents of the files it reads. A file that can't be read is part of the key as missing
+string AssetCache::key(const vector<string>& inputs, const vector<string>& inputFiles) {
+    KeyHash hash;
+    hash.add(GENERATOR_VERSION);
+    for (const string& input : inputs) hash.add(normalizedInput(input));
+
+    for (const string& inputFile : inputFiles) {
+        ifstream file(inputFile, ios::in | ios::binary);
+        if (!file.is_open()) {
+            hash.add("missing");
+            continue;
+        }
+
+        char buffer[1 << 16];
+        while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) hash.add(buffer, (size_t) file.gcount());
+        hash.add("", 1);
+    }
+
+    char text[33];
+    snprintf(text, sizeof(text), "%016llx%016llx", (unsigned long long) hash.h1, (unsigned long long) hash.h2);
+    return text;
+}
+
+// Links the cached file of key to outputFile, or copies it if links aren't supported.
+// Returns false if there's no cached file, and the asset has to be generated
+bool AssetCache::fetch(const string& key, const string& outputFile) {
+    string entry = entryFile(key);
+    error_code error;
+
+    bool found = fs::is_regular_file(entry, error);
+    if (found) {
+        fs::remove(outputFile, error);
+        fs::create_hard_link(entry, outputFile, error);
+        if (error) found = fs::copy_file(entry, outputFile, fs::copy_options::overwrite_existing, error);
+    }
+    if (found) fs::last_write_time(entry, fs::file_time_type::clock::now(), error);
+
+    lock_guard<mutex> lock(this->stats_mutex);
+    if (found) this->hits++;
+    else this->misses++;
+    return found;
+}
+
+// Copies a generated file into the cache. The copy is renamed to its entry only when complete,
+// so other generators sharing the cache never see half a file
+void AssetCache::store(const string& key, const string& outputFile) {
+    string entry = entryFile(key);
+    ostringstream temporary;
+    temporary << entry << "." << this_thread::get_id() << ".tmp";
+    error_code error;
+
+    fs::create_directories(this->directory, error);
+    if (!fs::copy_file(outputFile, temporary.str(), fs::copy_options::overwrite_existing, error)) return;
+    fs::rename(temporary.str(), entry, error);
+    if (error) fs::remove(temporary.str(), error);
+}
+
+// Removes the least recently used entries until the cache fits its size limit
+void AssetCache::evict() {
+    vector<pair<fs::file_time_type, fs::path>> entries;
+    uint64_t total = 0;
+    error_code error;
+
+    for (fs::directory_iterator it(this->directory, error), end; !error && it != end; it.increment(error)) {
+        if (!it->is_regular_file(error) || it->path().extension() != ".3d") continue;
+        total += (uint64_t) it->file_size(error);
+        entries.push_back(make_pair(it->last_write_time(error), it->path()));
+    }
+    sort(entries.begin(), entries.end());
+
+    for (size_t i = 0; i < entries.size() && total > this->size_limit; i++) {
+        uint64_t entry_size = (uint64_t) fs::file_size(entries[i].second, error);
+        if (error || !fs::remove(entries[i].second, error)) continue;
+        total -= entry_size;
+        this->evicted++;
+    }
+    this->size = total;
+}
+
+void AssetCache::printStats() {
+    printf("Cache: %u hits, %u misses, %u evicted, %.1f MB of %.1f MB used\n", this->hits, this->misses, this->evicted,
+           this->size / (1024.0 * 1024.0), this->size_limit / (1024.0 * 1024.0));
+}
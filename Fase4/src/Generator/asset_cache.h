@@ -0,0 +1,40 @@
+#ifndef ASSET_CACHE_H
+#define ASSET_CACHE_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <stdint.h>
+
+using namespace std;
+
+// Version of the files written by the generator, part of every cache key.
+// Must change whenever the same arguments give a different .3d file
+#define GENERATOR_VERSION "4.24"
+
+// Default size limit of the cache, in MB
+#define DEFAULT_CACHE_SIZE 512
+
+// Directory of .3d files named after the hash of everything they were generated from, so an asset
+// generated again with the same inputs is linked (or copied) from the cache instead.
+// Entries are touched when used, and the least recently used are removed when the cache is over its limit
+class AssetCache {
+    private:
+        string directory;
+        uint64_t size_limit;
+        mutex stats_mutex;
+        unsigned int hits = 0, misses = 0, evicted = 0;
+        uint64_t size = 0;
+
+        string entryFile(const string& key) {return this->directory + key + ".3d";};
+    public:
+        AssetCache(string directory, uint64_t size_limit);
+
+        string key(const vector<string>& inputs, const vector<string>& inputFiles);
+        bool fetch(const string& key, const string& outputFile);
+        void store(const string& key, const string& outputFile);
+        void evict();
+        void printStats();
+};
+
+#endif //ASSET_CACHE_H
@@ -0,0 +1,659 @@
+#include <vector>
+#include <iostream>
+#include <charconv>
+#include <math.h>
+#include <algorithm>
+
+#include "bezier.h"
+#include "parallel.h"
+#include "mapped_file.h"
+#include "../utils/float_vector.h"
+
+using namespace std;
+
+// Cubic Bernstein polynomials and their derivatives at t
+void bernstein(float t, float* b, float* d) {
+    float s = 1.0f - t;
+
+    b[0] = s * s * s;
+    b[1] = 3.0f * t * s * s;
+    b[2] = 3.0f * t * t * s;
+    b[3] = t * t * t;
+
+    d[0] = -3.0f * s * s;
+    d[1] = 3.0f * s * (s - 2.0f * t);
+    d[2] = 3.0f * t * (2.0f * s - t);
+    d[3] = 3.0f * t * t;
+}
+
+// Precomputes the cubic Bernstein polynomials and their derivatives for every sample of a tessellation level
+BezierBasis::BezierBasis(int tess_level) {
+    this->tess_level = tess_level;
+    this->values.resize((tess_level + 1) * 4);
+    this->derivatives.resize((tess_level + 1) * 4);
+
+    float inc = 1.0 / tess_level;
+    for (int i = 0; i <= tess_level; i++) {
+        bernstein(i * inc, &this->values[i * 4], &this->derivatives[i * 4]);
+    }
+}
+
+// Reduces the 4 rows of control points to 4 points, using the basis b of one parameter
+static inline void reducePatchRows(const float cps[16][3], const float* b, float q[4][3]) {
+    for (int i = 0; i < 4; i++) {
+        for (int c = 0; c < 3; c++) {
+            q[i][c] = b[0] * cps[i*4][c] + b[1] * cps[i*4+1][c] + b[2] * cps[i*4+2][c] + b[3] * cps[i*4+3][c];
+        }
+    }
+}
+
+static inline void combineRows(const float q[4][3], const float* b, float* res) {
+    for (int c = 0; c < 3; c++) {
+        res[c] = b[0] * q[0][c] + b[1] * q[1][c] + b[2] * q[2][c] + b[3] * q[3][c];
+    }
+}
+
+// Normal of the surface given its partial derivatives, oriented like the grid triangles.
+// Returns false if the derivatives don't define a plane (degenerate point of the patch)
+static inline bool surfaceNormal(float* du, float* dv, float* n) {
+    vector_cross(dv, du, n);
+
+    float len2 = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
+    float du2 = du[0] * du[0] + du[1] * du[1] + du[2] * du[2];
+    float dv2 = dv[0] * dv[0] + dv[1] * dv[1] + dv[2] * dv[2];
+    float max2 = du2 > dv2 ? du2 : dv2;
+
+    if (len2 <= 1e-12f * max2 * max2) return false;
+
+    vector_normalize(n);
+    return true;
+}
+
+// Normal of a patch at any (u, v), calculating the basis on the spot
+static bool patchNormalAt(const float cps[16][3], float u, float v, float* n) {
+    float bu[4], du[4], bv[4], dv[4];
+    bernstein(u, bu, du);
+    bernstein(v, bv, dv);
+
+    float q[4][3], r[4][3];
+    reducePatchRows(cps, bv, q);
+    reducePatchRows(cps, dv, r);
+
+    float su[3], sv[3];
+    combineRows(q, du, su);
+    combineRows(r, bu, sv);
+
+    return surfaceNormal(su, sv, n);
+}
+
+// At degenerate points (like the tips of the teapot lid and spout, where a whole row of control
+// points collapses) the normal is taken from samples increasingly further inside the patch
+static void degeneratePatchNormal(const float cps[16][3], float u, float v, float* n) {
+    float offsets[] = {1e-4f, 1e-3f, 1e-2f, 1e-1f};
+
+    for (float offset : offsets) {
+        float u2 = u < 0.5f ? u + offset : u - offset;
+        float v2 = v < 0.5f ? v + offset : v - offset;
+        if (patchNormalAt(cps, u2, v2, n)) return;
+    }
+
+    n[0] = 0.0f; n[1] = 0.0f; n[2] = 0.0f;
+}
+
+// Evaluates the whole (tess_level+1)^2 grid of a patch as a tensor product:
+// for each v, the 4 rows of control points are first reduced to 4 points, which are then
+// combined for each u. No memory is allocated, cps is indexed as cps[row * 4 + column][xyz].
+// If normals isn't null, each grid point normal is calculated from the partial derivatives
+// of the surface, dS/du x dS/dv, using the derivatives basis
+void evaluatePatchGrid(const float cps[16][3], const BezierBasis& basis, float* points, float* normals) {
+    int tess_level = basis.getTessLevel();
+    int points_per_line = tess_level + 1;
+
+    for (int v_ind = 0; v_ind <= tess_level; v_ind++) {
+        // Curve points of each row of control points for this v, and their derivatives in v
+        float q[4][3], r[4][3];
+        reducePatchRows(cps, basis.at(v_ind), q);
+        if (normals) reducePatchRows(cps, basis.derivativeAt(v_ind), r);
+
+        float* p = &points[v_ind * points_per_line * 3];
+        for (int u_ind = 0; u_ind <= tess_level; u_ind++) {
+            combineRows(q, basis.at(u_ind), p);
+            p += 3;
+        }
+
+        if (!normals) continue;
+
+        float* n = &normals[v_ind * points_per_line * 3];
+        for (int u_ind = 0; u_ind <= tess_level; u_ind++) {
+            float su[3], sv[3];
+            combineRows(q, basis.derivativeAt(u_ind), su);
+            combineRows(r, basis.at(u_ind), sv);
+
+            if (!surfaceNormal(su, sv, n))
+                degeneratePatchNormal(cps, (float) u_ind / tess_level, (float) v_ind / tess_level, n);
+            n += 3;
+        }
+    }
+}
+
+// Tessellates a single patch into a grid of (tess_level+1)^2 points.
+// Points and normals are written starting at points/normals, indices starting at indices, and
+// base is the index of the first grid point in the whole mesh
+void tessellatePatch(const float cps[16][3], const BezierBasis& basis, float* points, float* normals, unsigned int* indices, unsigned int base) {
+    int tess_level = basis.getTessLevel();
+    int points_per_line = tess_level + 1;
+
+    evaluatePatchGrid(cps, basis, points, normals);
+
+    // Write triangles correspondent to the grid
+    unsigned int* t = indices;
+    for (int v_ind = 0; v_ind < tess_level; v_ind++) {
+        for (int u_ind = 0; u_ind < tess_level; u_ind++) {
+            unsigned int p0 = base + u_ind   + v_ind     * points_per_line;
+            unsigned int p1 = base + u_ind+1 + v_ind     * points_per_line;
+            unsigned int p2 = base + u_ind   + (v_ind+1) * points_per_line;
+            unsigned int p3 = base + u_ind+1 + (v_ind+1) * points_per_line;
+
+            t[0] = p0; t[1] = p2; t[2] = p1;
+            t[3] = p1; t[4] = p2; t[5] = p3;
+            t += 6;
+        }
+    }
+}
+
+// Reads a patch file mapped in memory: the number of patches, one line of 16 control point indices per patch,
+// the number of control points and one line of x, y, z per control point. Values are separated by commas
+// and spaces. Stops at the first error, which is printed with its line number
+class PatchParser {
+    private:
+        string fileString;
+        const char* p;
+        const char* end;
+        int line = 1;
+
+        void skipSpaces() {
+            while (this->p < this->end && (*this->p == ' ' || *this->p == '\t' || *this->p == '\r')) this->p++;
+        };
+        bool separator() {
+            skipSpaces();
+            if (this->p < this->end && *this->p == ',') this->p++;
+            skipSpaces();
+            return true;
+        };
+    public:
+        PatchParser(string fileString, const char* begin, const char* end) {
+            this->fileString = fileString;
+            this->p = begin;
+            this->end = end;
+        };
+
+        bool fail(string message) {
+            std::cout << this->fileString << ":" << this->line << ": " << message << "\n";
+            return false;
+        };
+        int getLine() {return this->line;};
+
+        bool readIndex(uint32_t* value) {
+            skipSpaces();
+            from_chars_result result = from_chars(this->p, this->end, *value);
+            if (result.ec != errc()) return false;
+            this->p = result.ptr;
+            return true;
+        };
+        bool readFloat(float* value) {
+            skipSpaces();
+            if (this->p < this->end && *this->p == '+') this->p++;
+            from_chars_result result = from_chars(this->p, this->end, *value);
+            if (result.ec != errc()) return false;
+            this->p = result.ptr;
+            return true;
+        };
+        bool readIndices(uint32_t* values, int count) {
+            for (int i = 0; i < count; i++) {
+                if ((i > 0 && !separator()) || !readIndex(&values[i])) return false;
+            }
+            return true;
+        };
+        bool readFloats(float* values, int count) {
+            for (int i = 0; i < count; i++) {
+                if ((i > 0 && !separator()) || !readFloat(&values[i])) return false;
+            }
+            return true;
+        };
+
+        // Ends the current line, false if there's anything else in it
+        bool endLine() {
+            skipSpaces();
+            if (this->p == this->end) return true;
+            if (*this->p != '\n') return false;
+            this->p++;
+            this->line++;
+            return true;
+        };
+        bool atEnd() {
+            while (this->p < this->end && (*this->p == ' ' || *this->p == '\t' || *this->p == '\r' || *this->p == '\n')) {
+                if (*this->p == '\n') this->line++;
+                this->p++;
+            }
+            return this->p == this->end;
+        };
+};
+
+// Reads the patches and the control points of a patch file. Returns false, printing the line of
+// the error, if the file can't be read or isn't a valid patch file
+bool readPatchFile(string patchFile, PatchFile* patch_file) {
+    MappedFile file;
+    if (!file.open(patchFile)) {
+        std::cout << "Unable to open file: " << patchFile.c_str() << "\n";
+        return false;
+    }
+    PatchParser parser(patchFile, file.begin(), file.end());
+
+    uint32_t nr_patches;
+    if (!parser.readIndex(&nr_patches) || !parser.endLine()) return parser.fail("expected the number of patches");
+    // Each patch takes at least 32 bytes, so a wrong count doesn't allocate more than the file holds
+    if (nr_patches > file.getSize() / 32) return parser.fail("more patches than the file can hold");
+
+    vector<int> patch_lines(nr_patches);
+    patch_file->patches.resize((size_t) nr_patches * 16);
+    for (uint32_t i = 0; i < nr_patches; i++) {
+        patch_lines[i] = parser.getLine();
+        if (!parser.readIndices(&patch_file->patches[(size_t) i * 16], 16) || !parser.endLine())
+            return parser.fail("expected 16 control point indices in patch " + to_string(i));
+    }
+
+    uint32_t nr_control_points;
+    if (!parser.readIndex(&nr_control_points) || !parser.endLine()) return parser.fail("expected the number of control points");
+    if (nr_control_points > file.getSize() / 6) return parser.fail("more control points than the file can hold");
+
+    patch_file->control_points.resize((size_t) nr_control_points * 3);
+    for (uint32_t i = 0; i < nr_control_points; i++) {
+        if (!parser.readFloats(&patch_file->control_points[(size_t) i * 3], 3) || !parser.endLine())
+            return parser.fail("expected x, y, z of control point " + to_string(i));
+    }
+    if (!parser.atEnd()) return parser.fail("unexpected data after the control points");
+
+    for (uint32_t i = 0; i < nr_patches; i++) {
+        for (int i_pp = 0; i_pp < 16; i_pp++) {
+            uint32_t index = patch_file->patches[(size_t) i * 16 + i_pp];
+            if (index >= nr_control_points) {
+                std::cout << patchFile << ":" << patch_lines[i] << ": control point " << index << " doesn't exist\n";
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Builds the mesh of the patches of a patch file already read, tessellating each patch with the given level.
+// Patches are independent, so they are split between nr_threads threads, each one writing to the
+// part of the mesh arrays that belongs to its patch. The result doesn't depend on the number of threads
+void bezierPatches(PatchFile* patch_file, int tess_level, Mesh* mesh, int nr_threads) {
+    int nr_patches = (int) patch_file->getPatchCount();
+
+    // Calculate Bezier Surfaces
+    size_t points_per_patch = (tess_level + 1) * (tess_level + 1);
+    size_t indices_per_patch = tess_level * tess_level * 6;
+
+    unsigned int base = mesh->getVerticeCount();
+    size_t indices_base = mesh->indices.size();
+    mesh->points.resize((base + nr_patches * points_per_patch) * 3);
+    mesh->normals.resize((base + nr_patches * points_per_patch) * 3);
+    mesh->indices.resize(indices_base + nr_patches * indices_per_patch);
+
+    // The basis is the same for every patch, so it's only calculated once
+    BezierBasis basis = BezierBasis(tess_level);
+
+    // Processing of each patch
+    parallelFor(nr_patches, nr_threads, [&](int i_p) {
+        float cps[16][3];          // patch control points
+        patch_file->getControlPoints(i_p, cps);
+
+        unsigned int patch_base = base + i_p * points_per_patch;
+        tessellatePatch(cps, basis,
+                        &mesh->points[patch_base * 3],
+                        &mesh->normals[patch_base * 3],
+                        &mesh->indices[indices_base + i_p * indices_per_patch],
+                        patch_base);
+    });
+}
+
+// Builds the mesh described by a patch file, tessellating each patch with the given level
+void bezierTo3DFile(string patchFile, int tess_level, Mesh* mesh, int nr_threads) {
+    PatchFile patch_file;
+
+    if (readPatchFile(patchFile, &patch_file)) bezierPatches(&patch_file, tess_level, mesh, nr_threads);
+}
+
+// Estimates the largest distance between the patches tessellated with tess_level and the real surfaces.
+// The surfaces are evaluated at twice the level: even samples are the grid points, odd ones are the middle
+// of the grid edges and of the quad diagonals, where the triangles are furthest from their corners
+float bezierPatchesError(PatchFile* patch_file, int tess_level) {
+    BezierBasis basis = BezierBasis(2 * tess_level);
+    int points_per_line = 2 * tess_level + 1;
+    vector<float> points(points_per_line * points_per_line * 3);
+    float max_error = 0.0f;
+
+    for (size_t i_p = 0; i_p < patch_file->getPatchCount(); i_p++) {
+        float cps[16][3];
+        patch_file->getControlPoints(i_p, cps);
+        evaluatePatchGrid(cps, basis, points.data());
+
+        for (int v_ind = 0; v_ind < points_per_line; v_ind++) {
+            for (int u_ind = 0; u_ind < points_per_line; u_ind++) {
+                if (u_ind % 2 == 0 && v_ind % 2 == 0) continue;
+
+                // Grid points at both ends of the edge or diagonal this sample is the middle of.
+                // Quads are split along the diagonal from (u+1, v) to (u, v+1)
+                int u_a = u_ind, v_a = v_ind, u_b = u_ind, v_b = v_ind;
+                if (u_ind % 2 == 1 && v_ind % 2 == 1) {u_a++; v_a--; u_b--; v_b++;}
+                else if (u_ind % 2 == 1) {u_a--; u_b++;}
+                else {v_a--; v_b++;}
+
+                float* p = &points[(v_ind * points_per_line + u_ind) * 3];
+                float* a = &points[(v_a * points_per_line + u_a) * 3];
+                float* b = &points[(v_b * points_per_line + u_b) * 3];
+
+                float d[3] = {p[0] - (a[0] + b[0]) / 2, p[1] - (a[1] + b[1]) / 2, p[2] - (a[2] + b[2]) / 2};
+                float error = sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+                if (error > max_error) max_error = error;
+            }
+        }
+    }
+
+    return max_error;
+}
+
+// Largest subdivision of an edge or of the inside of a patch in adaptive tessellation
+#define MAX_ADAPTIVE_LEVEL 64
+// Part of the tolerance given to the chords of the boundary curves and of the rows and columns inside,
+// the rest is left for the triangles that cross them
+#define EDGE_TOLERANCE 0.5f
+#define INNER_TOLERANCE 0.75f
+
+// Subdivisions of a patch in adaptive tessellation: one per boundary curve, in the order v=0, u=1, v=1, u=0
+// (going around the patch), and inside the patch in u and v
+class PatchLevels {
+    public:
+        int edges[4];
+        int inner_u, inner_v;
+
+        bool isQuad() const {
+            return inner_u == 1 && inner_v == 1 && edges[0] == 1 && edges[1] == 1 && edges[2] == 1 && edges[3] == 1;
+        };
+        unsigned int verticeCount() const {
+            if (isQuad()) return 4;
+            return edges[0] + edges[1] + edges[2] + edges[3] + (inner_u - 1) * (inner_v - 1);
+        };
+        unsigned int triangleCount() const {
+            if (isQuad()) return 2;
+            return 2 * (inner_u - 2) * (inner_v - 2) + edges[0] + edges[1] + edges[2] + edges[3] + 2 * (inner_u - 2) + 2 * (inner_v - 2);
+        };
+};
+
+// Control points of each boundary curve of a patch, in the direction it's walked around the patch
+static const int patch_edges[4][4] = {{0, 4, 8, 12}, {12, 13, 14, 15}, {15, 11, 7, 3}, {3, 2, 1, 0}};
+
+// The same curve is shared by two patches, possibly walked in opposite directions. Curves are always
+// evaluated in the direction with the smallest first point, so both patches get the exact same points
+static bool isCanonicalCurve(const float cps[16][3], const int edge[4]) {
+    for (int i = 0; i < 4; i++) {
+        for (int c = 0; c < 3; c++) {
+            if (cps[edge[i]][c] != cps[edge[3 - i]][c]) return cps[edge[i]][c] < cps[edge[3 - i]][c];
+        }
+    }
+    return true;
+}
+
+// Segments needed so the chords of a cubic curve stay within tolerance of it. The distance between a curve
+// and its chord is at most max|B''| / 8 times the squared parameter step, and |B''| is at most 6 times
+// the largest second difference of the control points
+static int curveLevel(const float* p0, const float* p1, const float* p2, const float* p3, float tolerance) {
+    float d1[3], d2[3];
+    for (int c = 0; c < 3; c++) {
+        d1[c] = p0[c] - 2.0f * p1[c] + p2[c];
+        d2[c] = p1[c] - 2.0f * p2[c] + p3[c];
+    }
+    float second = 6.0f * sqrtf(max(d1[0] * d1[0] + d1[1] * d1[1] + d1[2] * d1[2], d2[0] * d2[0] + d2[1] * d2[1] + d2[2] * d2[2]));
+
+    int level = (int) ceilf(sqrtf(second / (8.0f * tolerance)));
+    return level < 1 ? 1 : level > MAX_ADAPTIVE_LEVEL ? MAX_ADAPTIVE_LEVEL : level;
+}
+
+static PatchLevels patchLevels(const float cps[16][3], float tolerance) {
+    PatchLevels levels;
+
+    for (int e = 0; e < 4; e++) {
+        const int* edge = patch_edges[e];
+        if (isCanonicalCurve(cps, edge)) levels.edges[e] = curveLevel(cps[edge[0]], cps[edge[1]], cps[edge[2]], cps[edge[3]], tolerance * EDGE_TOLERANCE);
+        else levels.edges[e] = curveLevel(cps[edge[3]], cps[edge[2]], cps[edge[1]], cps[edge[0]], tolerance * EDGE_TOLERANCE);
+    }
+
+    // Inside, the most curved row of control points decides the level in u, the most curved column in v
+    levels.inner_u = 1;
+    levels.inner_v = 1;
+    for (int i = 0; i < 4; i++) {
+        levels.inner_u = max(levels.inner_u, curveLevel(cps[i], cps[4 + i], cps[8 + i], cps[12 + i], tolerance * INNER_TOLERANCE));
+        levels.inner_v = max(levels.inner_v, curveLevel(cps[i * 4], cps[i * 4 + 1], cps[i * 4 + 2], cps[i * 4 + 3], tolerance * INNER_TOLERANCE));
+    }
+
+    // Patches with any subdivision are built from an inner grid with at least one point
+    if (!levels.isQuad()) {
+        levels.inner_u = max(levels.inner_u, 2);
+        levels.inner_v = max(levels.inner_v, 2);
+    }
+    return levels;
+}
+
+static void patchPointAt(const float cps[16][3], float u, float v, float* p) {
+    float bu[4], du[4], bv[4], dv[4];
+    bernstein(u, bu, du);
+    bernstein(v, bv, dv);
+
+    float q[4][3];
+    reducePatchRows(cps, bv, q);
+    combineRows(q, bu, p);
+}
+
+static void curvePointAt(const float* p0, const float* p1, const float* p2, const float* p3, float t, float* p) {
+    float b[4], d[4];
+    bernstein(t, b, d);
+    for (int c = 0; c < 3; c++) p[c] = b[0] * p0[c] + b[1] * p1[c] + b[2] * p2[c] + b[3] * p3[c];
+}
+
+// Point i of the level segments of a boundary curve, walking around the patch
+static void edgePointAt(const float cps[16][3], int e, int level, int i, float* p) {
+    const int* edge = patch_edges[e];
+    if (isCanonicalCurve(cps, edge)) curvePointAt(cps[edge[0]], cps[edge[1]], cps[edge[2]], cps[edge[3]], (float) i / level, p);
+    else curvePointAt(cps[edge[3]], cps[edge[2]], cps[edge[1]], cps[edge[0]], (float) (level - i) / level, p);
+}
+
+// Largest distance between the middle of the edges of the triangles and the surface at the middle of their parameters.
+// A boundary curve collapsed to a point has every parameter along it at the same point, so a point there takes the
+// parameter along the curve from the other end of the edge
+static float patchTrianglesError(const float cps[16][3], const vector<float>& points, const vector<float>& params,
+                                 const vector<unsigned int>& indices) {
+    bool collapsed[4];
+    for (int e = 0; e < 4; e++) {
+        const int* edge = patch_edges[e];
+        collapsed[e] = true;
+        for (int i = 1; i < 4; i++) {
+            for (int c = 0; c < 3; c++) collapsed[e] = collapsed[e] && cps[edge[i]][c] == cps[edge[0]][c];
+        }
+    }
+    auto freeParameter = [&](const float* param) {
+        if ((param[1] == 0.0f && collapsed[0]) || (param[1] == 1.0f && collapsed[2])) return 0;
+        if ((param[0] == 1.0f && collapsed[1]) || (param[0] == 0.0f && collapsed[3])) return 1;
+        return -1;
+    };
+
+    float max_error = 0.0f;
+    for (size_t t = 0; t < indices.size(); t += 3) {
+        for (int corner = 0; corner < 3; corner++) {
+            unsigned int a = indices[t + corner], b = indices[t + (corner + 1) % 3];
+            float pa[2] = {params[a * 2], params[a * 2 + 1]}, pb[2] = {params[b * 2], params[b * 2 + 1]};
+            int free_a = freeParameter(pa), free_b = freeParameter(pb);
+            if (free_a >= 0 && free_b < 0) pa[free_a] = pb[free_a];
+            if (free_b >= 0 && free_a < 0) pb[free_b] = pa[free_b];
+
+            float p[3];
+            patchPointAt(cps, (pa[0] + pb[0]) / 2, (pa[1] + pb[1]) / 2, p);
+
+            float d[3];
+            for (int c = 0; c < 3; c++) d[c] = p[c] - (points[a * 3 + c] + points[b * 3 + c]) / 2;
+            max_error = max(max_error, sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]));
+        }
+    }
+
+    return max_error;
+}
+
+// Tessellation of a single patch, indices starting at 0
+class PatchMesh {
+    public:
+        vector<float> points, normals;
+        vector<unsigned int> indices;
+        float error = 0.0f;
+};
+
+// Tessellates a patch with its own levels. The boundary points come first, going around the patch, then
+// the inner grid. Each boundary is joined to the side of the inner grid next to it by a strip of triangles,
+// so patches only share the boundary points, which are the same for both patches of an edge
+static void tessellateAdaptivePatch(const float cps[16][3], const PatchLevels& levels, PatchMesh* patch_mesh) {
+    vector<float> params;       // u, v of each point
+    vector<float>& points = patch_mesh->points;
+    vector<unsigned int>& triangles = patch_mesh->indices;
+    points.assign(levels.verticeCount() * 3, 0.0f);
+    triangles.clear();
+    triangles.reserve(levels.triangleCount() * 3);
+
+    auto addTriangle = [&](unsigned int a, unsigned int b, unsigned int c) {
+        // Same orientation as the uniform grid, clockwise in (u, v)
+        float area = (params[b * 2] - params[a * 2]) * (params[c * 2 + 1] - params[a * 2 + 1]) -
+                     (params[b * 2 + 1] - params[a * 2 + 1]) * (params[c * 2] - params[a * 2]);
+        if (area > 0.0f) swap(b, c);
+        triangles.push_back(a);
+        triangles.push_back(b);
+        triangles.push_back(c);
+    };
+
+    // Boundary points, each edge starting at its first corner
+    const float corners[4][2] = {{0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}};
+    unsigned int edge_start[4];
+    unsigned int count = 0;
+    for (int e = 0; e < 4; e++) {
+        edge_start[e] = count;
+        const float* from = corners[e];
+        const float* to = corners[(e + 1) % 4];
+        for (int i = 0; i < levels.edges[e]; i++) {
+            float t = (float) i / levels.edges[e];
+            params.push_back(from[0] + (to[0] - from[0]) * t);
+            params.push_back(from[1] + (to[1] - from[1]) * t);
+            edgePointAt(cps, e, levels.edges[e], i, &points[count * 3]);
+            count++;
+        }
+    }
+
+    if (levels.isQuad()) {
+        addTriangle(0, 3, 1);
+        addTriangle(1, 3, 2);
+    }
+    else {
+        // Inner grid, without the points on the boundary
+        int nu = levels.inner_u, nv = levels.inner_v;
+        unsigned int inner = count;
+        auto innerPoint = [&](int i, int j) {return inner + (unsigned int) ((j - 1) * (nu - 1) + (i - 1));};
+        for (int j = 1; j < nv; j++) {
+            for (int i = 1; i < nu; i++) {
+                params.push_back((float) i / nu);
+                params.push_back((float) j / nv);
+                patchPointAt(cps, (float) i / nu, (float) j / nv, &points[count * 3]);
+                count++;
+            }
+        }
+
+        for (int j = 1; j < nv - 1; j++) {
+            for (int i = 1; i < nu - 1; i++) {
+                unsigned int p0 = innerPoint(i, j), p1 = innerPoint(i + 1, j), p2 = innerPoint(i, j + 1), p3 = innerPoint(i + 1, j + 1);
+                addTriangle(p0, p2, p1);
+                addTriangle(p1, p2, p3);
+            }
+        }
+
+        // Strips between each boundary and the inner grid side next to it, walked in the same direction.
+        // The next triangle advances on whichever side has its next point closer
+        for (int e = 0; e < 4; e++) {
+            vector<unsigned int> side;
+            int n = e % 2 == 0 ? nu : nv;
+            for (int k = 1; k < n; k++) {
+                if (e == 0) side.push_back(innerPoint(k, 1));
+                else if (e == 1) side.push_back(innerPoint(nu - 1, k));
+                else if (e == 2) side.push_back(innerPoint(nu - k, nv - 1));
+                else side.push_back(innerPoint(1, nv - k));
+            }
+
+            int level = levels.edges[e];
+            auto boundaryPoint = [&](int i) {return i == level ? edge_start[(e + 1) % 4] : edge_start[e] + i;};
+            int i = 0, j = 0, last = (int) side.size() - 1;
+            while (i < level || j < last) {
+                if (j == last || (i < level && (float) (i + 1) / level <= (float) (j + 2) / n)) {
+                    addTriangle(boundaryPoint(i), boundaryPoint(i + 1), side[j]);
+                    i++;
+                }
+                else {
+                    addTriangle(boundaryPoint(i), side[j + 1], side[j]);
+                    j++;
+                }
+            }
+        }
+    }
+
+    patch_mesh->normals.resize(count * 3);
+    for (unsigned int v = 0; v < count; v++) {
+        if (!patchNormalAt(cps, params[v * 2], params[v * 2 + 1], &patch_mesh->normals[v * 3]))
+            degeneratePatchNormal(cps, params[v * 2], params[v * 2 + 1], &patch_mesh->normals[v * 3]);
+    }
+
+    patch_mesh->error = patchTrianglesError(cps, points, params, triangles);
+}
+
+// The curvature bounds of the inside ignore the twist of the patch and the strips along the boundaries,
+// so the inner grid is refined a little at a time while the tessellation is still too far from the surface.
+// Boundary levels only depend on their curve and never change, so neighbours still agree
+static void tessellateWithinTolerance(const float cps[16][3], float tolerance, PatchMesh* patch_mesh) {
+    PatchLevels levels = patchLevels(cps, tolerance);
+    tessellateAdaptivePatch(cps, levels, patch_mesh);
+
+    for (int i = 0; i < 16 && patch_mesh->error > tolerance; i++) {
+        if (levels.inner_u == MAX_ADAPTIVE_LEVEL && levels.inner_v == MAX_ADAPTIVE_LEVEL) break;
+
+        levels.inner_u = min(MAX_ADAPTIVE_LEVEL, max(levels.inner_u + 1, (int) ceilf(levels.inner_u * 1.1f)));
+        levels.inner_v = min(MAX_ADAPTIVE_LEVEL, max(levels.inner_v + 1, (int) ceilf(levels.inner_v * 1.1f)));
+        tessellateAdaptivePatch(cps, levels, patch_mesh);
+    }
+}
+
+// Builds the mesh of the patches of a patch file already read, each patch and each of its edges subdivided
+// just enough to stay within tolerance of the surface. Edges shared by two patches get the same subdivision
+// from both, so there's no cracks between patches. Returns the error of the mesh
+float bezierPatchesAdaptive(PatchFile* patch_file, float tolerance, Mesh* mesh, int nr_threads) {
+    int nr_patches = (int) patch_file->getPatchCount();
+    vector<PatchMesh> patch_meshes(nr_patches);
+
+    parallelFor(nr_patches, nr_threads, [&](int i_p) {
+        float cps[16][3];
+        patch_file->getControlPoints(i_p, cps);
+        tessellateWithinTolerance(cps, tolerance, &patch_meshes[i_p]);
+    });
+
+    float max_error = 0.0f;
+    for (PatchMesh& patch_mesh : patch_meshes) {
+        unsigned int base = mesh->getVerticeCount();
+        mesh->points.insert(mesh->points.end(), patch_mesh.points.begin(), patch_mesh.points.end());
+        mesh->normals.insert(mesh->normals.end(), patch_mesh.normals.begin(), patch_mesh.normals.end());
+        for (unsigned int index : patch_mesh.indices) mesh->indices.push_back(base + index);
+        max_error = max(max_error, patch_mesh.error);
+    }
+    return max_error;
+}
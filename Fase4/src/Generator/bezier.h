@@ -0,0 +1,49 @@
+#ifndef BEZIER_H
+#define BEZIER_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "../utils/mesh.h"
+
+using namespace std;
+
+// Cubic Bernstein basis and its derivatives evaluated at the tess_level+1 samples of [0, 1]
+class BezierBasis {
+    private:
+        int tess_level;
+        vector<float> values;       // 4 per sample
+        vector<float> derivatives;  // 4 per sample
+    public:
+        BezierBasis(int tess_level);
+        int getTessLevel() const {return this->tess_level;};
+        const float* at(int sample) const {return &this->values[sample * 4];};
+        const float* derivativeAt(int sample) const {return &this->derivatives[sample * 4];};
+};
+
+void evaluatePatchGrid(const float cps[16][3], const BezierBasis& basis, float* points, float* normals = nullptr);
+
+// Patches and control points read from a patch file, each in one contiguous array
+class PatchFile {
+    public:
+        vector<uint32_t> patches;       // 16 control point indices per patch
+        vector<float> control_points;   // x, y, z of each control point
+
+        size_t getPatchCount() const {return this->patches.size() / 16;};
+        void getControlPoints(size_t patch, float cps[16][3]) const {
+            const uint32_t* indices = &this->patches[patch * 16];
+            for (int i = 0; i < 16; i++) {
+                for (int c = 0; c < 3; c++) cps[i][c] = this->control_points[indices[i] * 3 + c];
+            }
+        };
+};
+
+bool readPatchFile(string patchFile, PatchFile* patch_file);
+void bezierPatches(PatchFile* patch_file, int tess_level, Mesh* mesh, int nr_threads);
+float bezierPatchesError(PatchFile* patch_file, int tess_level);
+float bezierPatchesAdaptive(PatchFile* patch_file, float tolerance, Mesh* mesh, int nr_threads);
+
+void bezierTo3DFile(string patchFile, int tess_level, Mesh* mesh, int nr_threads);
+
+#endif //BEZIER_H
@@ -0,0 +1,165 @@
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "cleanup.h"
+
+using namespace std;
+
+// Cross product of the edges of triangle (a, b, c), twice its area times its normal
+static void faceCross(const float* points, unsigned int a, unsigned int b, unsigned int c, double* cross) {
+    double ab[3], ac[3];
+    for (int k = 0; k < 3; k++) {
+        ab[k] = (double) points[b * 3 + k] - points[a * 3 + k];
+        ac[k] = (double) points[c * 3 + k] - points[a * 3 + k];
+    }
+    cross[0] = ab[1] * ac[2] - ab[2] * ac[1];
+    cross[1] = ab[2] * ac[0] - ab[0] * ac[2];
+    cross[2] = ab[0] * ac[1] - ab[1] * ac[0];
+}
+
+static bool degenerateTriangle(const float* points, unsigned int a, unsigned int b, unsigned int c) {
+    if (a == b || b == c || c == a) return true;
+
+    double cross[3];
+    faceCross(points, a, b, c, cross);
+
+    double longest = 0.0;
+    unsigned int corners[3] = {a, b, c};
+    for (int e = 0; e < 3; e++) {
+        const float* p = &points[corners[e] * 3];
+        const float* q = &points[corners[(e + 1) % 3] * 3];
+        double length = 0.0;
+        for (int k = 0; k < 3; k++) length += ((double) q[k] - p[k]) * ((double) q[k] - p[k]);
+        longest = max(longest, length);
+    }
+
+    // Also true if any point isn't a number, as every comparison with NaN is false
+    double area = sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+    return !(area > CLEANUP_AREA_EPSILON * longest);
+}
+
+static bool invalidNormal(const float* n) {
+    if (!isfinite(n[0]) || !isfinite(n[1]) || !isfinite(n[2])) return true;
+    return sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) < CLEANUP_NORMAL_EPSILON;
+}
+
+// Bits of a point, with -0 the same as 0, to find the vertices at the same point
+static uint64_t pointKey(const float* p) {
+    uint64_t key = 0xcbf29ce484222325ULL;
+    for (int k = 0; k < 3; k++) {
+        float value = p[k] == 0.0f ? 0.0f : p[k];
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        key = (key ^ bits) * 0x100000001b3ULL;
+    }
+    return key;
+}
+
+// Replaces the invalid normals of the vertices first_vertex to first_vertex + vertice_count with the sum of the
+// (area weighted) normals of the triangles around their point. Returns how many were replaced
+static unsigned int repairNormals(Mesh* mesh, unsigned int first_vertex, unsigned int vertice_count,
+                                  unsigned int first_index, unsigned int index_count) {
+    float* normals = mesh->normals.data();
+    vector<unsigned int> invalid;
+    for (unsigned int v = first_vertex; v < first_vertex + vertice_count; v++) {
+        if (invalidNormal(&normals[v * 3])) invalid.push_back(v);
+    }
+    if (invalid.empty()) return 0;
+
+    unordered_map<uint64_t, unsigned int> point_ids;
+    vector<unsigned int> vertex_point(vertice_count);
+    for (unsigned int v = 0; v < vertice_count; v++) {
+        auto found = point_ids.emplace(pointKey(&mesh->points[(first_vertex + v) * 3]), (unsigned int) point_ids.size());
+        vertex_point[v] = found.first->second;
+    }
+
+    vector<double> sums(point_ids.size() * 3, 0.0);
+    for (unsigned int i = first_index; i < first_index + index_count; i += 3) {
+        const unsigned int* t = &mesh->indices[i];
+        double cross[3];
+        faceCross(mesh->points.data(), t[0], t[1], t[2], cross);
+        for (int corner = 0; corner < 3; corner++) {
+            double* sum = &sums[vertex_point[t[corner] - first_vertex] * 3];
+            for (int k = 0; k < 3; k++) sum[k] += cross[k];
+        }
+    }
+
+    for (unsigned int v : invalid) {
+        const double* sum = &sums[vertex_point[v - first_vertex] * 3];
+        double length = sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+        float* n = &normals[v * 3];
+
+        // A point without any triangle around it keeps a valid normal at least
+        if (length > 0.0) for (int k = 0; k < 3; k++) n[k] = (float) (sum[k] / length);
+        else {
+            n[0] = 0.0f; n[1] = 1.0f; n[2] = 0.0f;
+        }
+    }
+    return (unsigned int) invalid.size();
+}
+
+CleanupStats cleanupMesh(Mesh* mesh) {
+    CleanupStats stats;
+    bool normals = !mesh->normals.empty();
+    bool textures = !mesh->textures.empty();
+
+    vector<MeshLOD> lods = mesh->lods;
+    if (lods.empty()) {
+        MeshLOD whole;
+        whole.index_count = (unsigned int) mesh->indices.size();
+        whole.vertice_count = mesh->getVerticeCount();
+        lods.push_back(whole);
+    }
+
+    Mesh cleaned;
+    vector<unsigned int> remap(mesh->getVerticeCount());
+    for (MeshLOD& lod : lods) {
+        MeshLOD cleaned_lod = lod;
+        cleaned_lod.first_index = (unsigned int) cleaned.indices.size();
+        cleaned_lod.first_vertex = cleaned.getVerticeCount();
+
+        // Vertices are kept in the same order, numbered as they are found used
+        vector<bool> used(lod.vertice_count, false);
+        vector<unsigned int> kept;
+        for (unsigned int i = lod.first_index; i < lod.first_index + lod.index_count; i += 3) {
+            const unsigned int* t = &mesh->indices[i];
+            if (degenerateTriangle(mesh->points.data(), t[0], t[1], t[2])) {
+                stats.removed_triangles++;
+                continue;
+            }
+            for (int corner = 0; corner < 3; corner++) used[t[corner] - lod.first_vertex] = true;
+            kept.push_back(i);
+        }
+
+        for (unsigned int v = 0; v < lod.vertice_count; v++) {
+            unsigned int old = lod.first_vertex + v;
+            if (!used[v]) {
+                stats.removed_vertices++;
+                continue;
+            }
+            remap[old] = cleaned.getVerticeCount();
+            cleaned.points.insert(cleaned.points.end(), &mesh->points[old * 3], &mesh->points[old * 3 + 3]);
+            if (normals) cleaned.normals.insert(cleaned.normals.end(), &mesh->normals[old * 3], &mesh->normals[old * 3 + 3]);
+            if (textures) cleaned.textures.insert(cleaned.textures.end(), &mesh->textures[old * 2], &mesh->textures[old * 2 + 2]);
+        }
+
+        for (unsigned int i : kept) {
+            for (int corner = 0; corner < 3; corner++) cleaned.indices.push_back(remap[mesh->indices[i + corner]]);
+        }
+
+        cleaned_lod.index_count = (unsigned int) cleaned.indices.size() - cleaned_lod.first_index;
+        cleaned_lod.vertice_count = cleaned.getVerticeCount() - cleaned_lod.first_vertex;
+        if (normals) {
+            stats.repaired_normals += repairNormals(&cleaned, cleaned_lod.first_vertex, cleaned_lod.vertice_count,
+                                                    cleaned_lod.first_index, cleaned_lod.index_count);
+        }
+        if (!mesh->lods.empty()) cleaned.lods.push_back(cleaned_lod);
+    }
+
+    *mesh = move(cleaned);
+    return stats;
+}
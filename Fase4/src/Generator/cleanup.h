@@ -0,0 +1,24 @@
+#ifndef CLEANUP_H
+#define CLEANUP_H
+
+#include "../utils/mesh.h"
+
+// Triangles whose cross product is smaller than this fraction of their longest edge squared have no area
+#define CLEANUP_AREA_EPSILON 1e-6f
+// Normals shorter than this can't be normalized
+#define CLEANUP_NORMAL_EPSILON 1e-6f
+
+// What the cleanup of a mesh changed
+class CleanupStats {
+    public:
+        unsigned int removed_triangles = 0;
+        unsigned int removed_vertices = 0;
+        unsigned int repaired_normals = 0;
+};
+
+// Removes the triangles of each level of detail with no area (or with points that aren't numbers) and the
+// vertices no triangle uses anymore, and replaces the normals that are zero or not numbers with the average
+// of the faces around every vertex at the same point. Clusters are dropped, as they are built after the cleanup
+CleanupStats cleanupMesh(Mesh* mesh);
+
+#endif //CLEANUP_H
@@ -1,73 +1,42 @@
 #include <vector>
+#include <memory>
 #include <map>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
 #include <string.h>
+#include <stdio.h>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 
 #include "primitives.h"
+#include "bezier.h"
+#include "parallel.h"
+#include "mesh_writer.h"
+#include "mesh_reader.h"
+#include "simplify.h"
+#include "optimize.h"
+#include "meshlets.h"
+#include "strips.h"
+#include "terrain.h"
+#include "cleanup.h"
+#include "asset_cache.h"
 #include "../utils/ponto.h"
 #include "../utils/float_vector.h"
-#include "../lib/Matrix.tpp"
+#include "../utils/mesh.h"
 
 #define _3DFILESFOLDER "../../files3D/"
 #define PATCHFILESFOLDER "../../filesPATCH/"
+#define HEIGHTMAPFILESFOLDER "../../filesHEIGHTMAP/"
+// Finest uniform Bezier tessellation compared with adaptive tessellation
+#define MAX_UNIFORM_LEVEL 256
 
 using namespace std;
 
-void writePointsToFile(vector<Ponto> points, vector<Ponto>* normals, vector<float>* textures, string fileString) {
-    ofstream file;
-
-    // Write number of points to file
-    file.open(fileString, ios::out | ios::trunc);
-    file << points.size() << "\n";
-
-    // Write true or false indicating if there's normals associated with the points
-    normals ? file << "true\n" : file << "false\n";
-
-    // Write true or false indicating if there's textures coordinates associated with the points
-    textures ? file << "true\n" : file << "false\n";
-
-    // Write vertexes to file
-    for(Ponto p : points) {
-        float px = p.getX();
-        float py = p.getY();
-        float pz = p.getZ();
-
-        string line = to_string(px) + ", " + to_string(py) + ", " + to_string(pz) + "\n";
-        file << line;
-    }
-
-    // If defined, write vertexes normals to file
-    if (normals) {
-        for(Ponto n : *normals) {
-            float nx = n.getX();
-            float ny = n.getY();
-            float nz = n.getZ();
-
-            string line = to_string(nx) + ", " + to_string(ny) + ", " + to_string(nz) + "\n";
-            file << line;
-        }
-    }
-
-    // If defined, write vertexes texture coordinates to file
-    if (textures) {
-        vector<float> ts = *textures;
-        for (int i = 0; i < ts.size(); i+=2) {
-            float tx = ts[i];
-            float ty = ts[i+1];
-
-            string line = to_string(tx) + ", " + to_string(ty) + "\n";
-            file << line;
-        }
-    }
-
-    file.close();
-}
-
 void generatorHelpMenu() {
 	cout << "┌───────────────────────────────────────GENERATOR HELP───────────────────────────────────────┐" << endl;
-	cout << "│   Usage: ./generator [SHAPE]... [OUTPUT FILE]                                              │" << endl;
+	cout << "│   Usage: ./generator [SHAPE]... [OUTPUT FILE] <optional>[OPTIONS]                          │" << endl;
 	cout << "│   Generates a .3d file, ready to be readen by the engine                                   │" << endl;
 	cout << "│                                                                                            │" << endl;
 	cout << "│   SHAPE                                                                                    │" << endl;
@@ -80,243 +49,674 @@ void generatorHelpMenu() {
     cout << "│      sphere [RADIUS] [SLICES] [STACKS]                                                     │" << endl;
     cout << "│          Creates a sphere with given radius, divided in given slices and stacks.           │" << endl;
     cout << "│                                                                                            │" << endl;
+    cout << "│      icosphere [RADIUS] [SUBDIVISIONS]                                                     │" << endl;
+    cout << "│          Creates a sphere from an icosahedron subdivided given times, with even triangles. │" << endl;
+    cout << "│      icosphere [RADIUS] --tolerance [ERROR]                                                │" << endl;
+    cout << "│          Subdivides just enough to stay within ERROR of the sphere, and prints the         │" << endl;
+    cout << "│          triangles of the sphere with the same error.                                      │" << endl;
+    cout << "│                                                                                            │" << endl;
     cout << "│      cone [RADIUS] [HEIGHT] [SLICES] [STACKS]                                              │" << endl;
     cout << "│          Creates a cone with given radius and height, divided in given slices and stacks.  │" << endl;
     cout << "│                                                                                            │" << endl;
     cout << "│      torus [INNER_RADIUS] [OUTER_RADIUS] [SLICES] [STACKS]                                 │" << endl;
     cout << "│          Creates a torus with given radiuses, divided in given slices and stacks.          │" << endl;
+    cout << "│                                                                                            │" << endl;
+    cout << "│      --bezier [PATCH_FILE] [TESSELLATION_LEVEL]                                            │" << endl;
+    cout << "│          Creates the Bezier surfaces described by a patch file, with given tessellation.   │" << endl;
+    cout << "│      --bezier [PATCH_FILE] --tolerance [ERROR]                                             │" << endl;
+    cout << "│          Subdivides each patch and edge just enough to stay within ERROR of the surface,   │" << endl;
+    cout << "│          without cracks, and prints the triangles saved over a uniform tessellation.       │" << endl;
+    cout << "│                                                                                            │" << endl;
+    cout << "│   Usage: ./generator --manifest [MANIFEST FILE] <optional>[OPTIONS]                        │" << endl;
+    cout << "│   Generates every .3d file listed in the manifest, one per line with the arguments above.  │" << endl;
+    cout << "│   Assets are generated in parallel, and their triangle counts and timings are printed.     │" << endl;
+    cout << "│                                                                                            │" << endl;
+    cout << "│   Usage: ./generator --simplify [INPUT FILE] [RATIO] [OUTPUT FILE] <optional>[OPTIONS]     │" << endl;
+    cout << "│   Simplifies a .3d file to about RATIO of its triangles (0.25 keeps a quarter of them),    │" << endl;
+    cout << "│   keeping its normals and texture seams, and prints the error of the simplified model.     │" << endl;
+    cout << "│                                                                                            │" << endl;
+    cout << "│   Usage: ./generator --terrain [HEIGHTMAP] [SIZE] [HEIGHT] [CHUNK] [LEVELS] [OUTPUT FILE]  │" << endl;
+    cout << "│   Creates a terrain SIZE wide and HEIGHT high from a .pgm or raw heightmap, split into     │" << endl;
+    cout << "│   chunks of CHUNK x CHUNK cells with LEVELS levels of detail each, in a single file.       │" << endl;
+    cout << "│                                                                                            │" << endl;
+    cout << "│   OPTIONS                                                                                  │" << endl;
+    cout << "│      --binary                                                                              │" << endl;
+    cout << "│          Writes a binary .3d file instead of a text one, faster to load by the engine.     │" << endl;
+    cout << "│      -j [THREADS]                                                                          │" << endl;
+    cout << "│          Uses up to THREADS threads to generate the model, 0 uses every available core.    │" << endl;
+    cout << "│      --quantize                                                                            │" << endl;
+    cout << "│          Writes a binary .3d file with 16-bit points, 8-bit normals and half float texture │" << endl;
+    cout << "│          coordinates, half the size of a regular binary file.                              │" << endl;
+    cout << "│      --optimize                                                                            │" << endl;
+    cout << "│          Reorders the triangles for the vertex cache and less overdraw, printing the       │" << endl;
+    cout << "│          average transforms per triangle (ACMR) and per vertex (ATVR) before and after.    │" << endl;
+    cout << "│      --meshlets                                                                            │" << endl;
+    cout << "│          Writes a binary .3d file split into clusters of up to 64 vertices and 124         │" << endl;
+    cout << "│          triangles, each with its bounding sphere and normal cone for culling.             │" << endl;
+    cout << "│      --strips                                                                              │" << endl;
+    cout << "│          Writes a binary .3d file with triangle strips joined by primitive restart         │" << endl;
+    cout << "│          indices, about half the indices of a list of triangles.                           │" << endl;
+    cout << "│      --cleanup                                                                             │" << endl;
+    cout << "│          Removes triangles with no area and the vertices left unused, and repairs normals  │" << endl;
+    cout << "│          that are zero or NaN from the faces around them. On by default for Bezier         │" << endl;
+    cout << "│          surfaces, --no-cleanup turns it off.                                              │" << endl;
+    cout << "│      --cache [DIRECTORY]                                                                   │" << endl;
+    cout << "│          Keeps the generated files in DIRECTORY, and links them again when generated with  │" << endl;
+    cout << "│          the same shape, parameters, options and patch file instead of generating them.    │" << endl;
+    cout << "│      --cache-size [MB]                                                                     │" << endl;
+    cout << "│          Size limit of the cache, removing the least recently used files (default 512).    │" << endl;
+    cout << "│      --lods [LEVELS]                                                                       │" << endl;
+    cout << "│          Writes several levels of detail in one file, replacing the shape divisions.       │" << endl;
+    cout << "│          LEVELS is a list like 64,32,16 or 128x32,64x16 (slices x stacks).                 │" << endl;
 	cout << "└────────────────────────────────────────────────────────────────────────────────────────────┘" << endl;
 }
 
-// Function that calculates the normal in p1, given two other points, following the right hand rule
-Ponto calculate_normal(Ponto p1, Ponto p2, Ponto p3) {
-	Ponto v1 = vector_sub_ponto(p2, p1);
-	Ponto v2 = vector_sub_ponto(p3, p1);
-
-	Ponto n = vector_cross_ponto(v1, v2);
+// Options that change how models are generated and written
+class GeneratorOptions {
+    public:
+        bool binary = false;
+        int nr_threads = 1;
+        vector<pair<int, int>> lods;    // divisions (slices and stacks) of each level of detail
+        bool optimize = false;
+        bool meshlets = false;
+        bool strips = false;            // ignored with meshlets, whose ranges of triangles can't be strips
+        bool cleanup = false;           // removes degenerate triangles and repairs normals of any shape
+        bool no_cleanup = false;        // keeps Bezier surfaces as they're tessellated
+        bool quantize = false;
+        float tolerance = 0.0f;         // adaptive Bezier tessellation or icosphere error, 0 for a uniform level
+        string cache_directory;         // asset cache, not used if empty
+        uint64_t cache_size = (uint64_t) DEFAULT_CACHE_SIZE << 20;
+};
+
+// Parses a list of levels of detail like 64,32,16 or 128x32,64x16 (slices x stacks).
+// A single number is used for both. The list replaces lods, so a manifest line's --lods replaces the global one.
+// Returns false, leaving lods as they were, if the list isn't valid
+bool parseLODs(string list, vector<pair<int, int>>* lods) {
+    vector<pair<int, int>> parsed;
+    string token;
+    istringstream tokenStream(list);
+
+    while (getline(tokenStream, token, ',')) {
+        size_t x = token.find('x');
+        int slices = atoi(token.substr(0, x).c_str());
+        int stacks = x == string::npos ? slices : atoi(token.substr(x + 1).c_str());
+        if (slices < 1 || stacks < 1) return false;
+
+        parsed.push_back(make_pair(slices, stacks));
+    }
+    if (parsed.empty()) return false;
 
-	return vector_normalize_ponto(n);
+    *lods = parsed;
+    return true;
 }
 
-void bezierTo3DFile(string patchFile, int tess_level, vector<Ponto>* ps, vector<Ponto>* ns) {
-    string line;
-    ifstream file;
+// Removes the options from the arguments list, storing them in options
+vector<string> parseOptions(vector<string> args, GeneratorOptions* options) {
+    vector<string> remaining;
+
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == "--binary") options->binary = true;
+        else if (args[i] == "-j" && i + 1 < args.size()) options->nr_threads = atoi(args[++i].c_str());
+        else if (args[i].compare(0, 2, "-j") == 0 && args[i].size() > 2) options->nr_threads = atoi(args[i].c_str() + 2);
+        else if (args[i] == "--optimize") options->optimize = true;
+        else if (args[i] == "--meshlets") options->meshlets = options->binary = true;
+        else if (args[i] == "--strips") options->strips = options->binary = true;
+        else if (args[i] == "--quantize") options->quantize = true;
+        else if (args[i] == "--cleanup") options->cleanup = true;
+        else if (args[i] == "--no-cleanup") options->no_cleanup = true;
+        else if (args[i] == "--cache" && i + 1 < args.size()) options->cache_directory = args[++i];
+        else if (args[i] == "--cache-size" && i + 1 < args.size()) options->cache_size = (uint64_t) (atof(args[++i].c_str()) * (1 << 20));
+        else if (args[i] == "--tolerance" && i + 1 < args.size()) options->tolerance = (float) atof(args[++i].c_str());
+        else if (args[i] == "--lods" && i + 1 < args.size() && parseLODs(args[i + 1], &options->lods)) i++;
+        else remaining.push_back(args[i]);
+    }
+    if (options->nr_threads < 1) options->nr_threads = defaultThreadCount();
+
+    return remaining;
+}
 
-    map<int, vector<int>> patches;
-    vector<Ponto> control_points;
-    int nr_patches, nr_control_points;
+// Patch files already read, so assets made from the same patch file only read it once.
+// Files that couldn't be read are kept as null, so their error is only printed once
+class PatchFileCache {
+    private:
+        mutex files_mutex;
+        map<string, unique_ptr<PatchFile>> files;
+    public:
+        PatchFile* get(string patchFile) {
+            lock_guard<mutex> lock(this->files_mutex);
+
+            auto it = this->files.find(patchFile);
+            if (it == this->files.end()) {
+                unique_ptr<PatchFile> patch_file(new PatchFile());
+                if (!readPatchFile(patchFile, patch_file.get())) patch_file.reset();
+                it = this->files.emplace(patchFile, move(patch_file)).first;
+            }
+            return it->second.get();
+        };
+};
+
+// Compares an adaptive Bezier tessellation with the coarsest uniform tessellation that's as close to the surface
+void printAdaptiveSavings(PatchFile* patch_file, unsigned int nr_triangles, float error) {
+    int low = 1, high = MAX_UNIFORM_LEVEL;
+    if (bezierPatchesError(patch_file, high) > error) {
+        printf("Adaptive tessellation: %u triangles, error %g\n", nr_triangles, error);
+        return;
+    }
+    while (low < high) {
+        int level = (low + high) / 2;
+        if (bezierPatchesError(patch_file, level) <= error) high = level;
+        else low = level + 1;
+    }
 
-    // Parsing of patch file
-	file.open(patchFile.c_str(), ios::in);
-    if (file.is_open()) {
-        // Patches parsing
-        getline(file, line);
-        nr_patches = atoi(line.c_str());
+    unsigned int uniform_triangles = (unsigned int) patch_file->getPatchCount() * 2 * high * high;
+    printf("Adaptive tessellation: %u triangles, error %g; uniform level %d: %u triangles (%.1f%% saved)\n",
+           nr_triangles, error, high, uniform_triangles, 100.0 * (1.0 - (double) nr_triangles / uniform_triangles));
+}
 
-        for (int i = 0; i < nr_patches; i++) {
-            getline(file, line);
-            vector<int> patch;
+void printCleanupStats(CleanupStats stats) {
+    printf("Cleanup: %u degenerate triangles and %u unused vertices removed, %u normals repaired\n",
+           stats.removed_triangles, stats.removed_vertices, stats.repaired_normals);
+}
 
-            string token;
-            istringstream tokenStream(line);
+// Prints the triangles of an icosphere and of the UV sphere with the fewest triangles within the same error
+void printIcosphereSavings(float radius, int subdivisions, unsigned int nr_triangles, float error) {
+    int slices, stacks;
+    if (!sphereDivisions(radius, error, &slices, &stacks)) {
+        printf("Icosphere subdivided %d times: %u triangles, error %g\n", subdivisions, nr_triangles, error);
+        return;
+    }
 
-    		while (getline(tokenStream, token, ',')) {
-				int index = atoi(token.c_str());
-                patch.push_back(index);
-			}
+    unsigned int sphere_triangles = (unsigned int) slices * (2 * stacks - 2);
+    printf("Icosphere subdivided %d times: %u triangles, error %g; sphere %d x %d: %u triangles (%.1f%% saved)\n",
+           subdivisions, nr_triangles, error, slices, stacks, sphere_triangles, 100.0 * (1.0 - (double) nr_triangles / sphere_triangles));
+}
 
-            patches[i] = patch;
+// Builds the shape described by args (shape name, parameters and output file), giving it to sink.
+// Sphere and torus are streamed to the sink as they're generated, the other shapes (and every shape that is
+// cleaned up) are built first.
+// If error isn't null, it's set to the largest distance between the triangles and the real surface.
+// Returns false, without using the sink, if args don't describe a valid shape
+bool generateShape(vector<string>& args, GeneratorOptions& options, PatchFileCache* patch_cache, MeshSink* sink, float* error = nullptr) {
+    float shape_error = 0.0f;
+    int argc = (int) args.size();
+    string shape = argc > 0 ? args[0] : "";
+    bool bezier = shape == "--bezier" || shape == "bezier";
+    bool cleanup = options.cleanup || (bezier && !options.no_cleanup);
+    Mesh mesh;
+
+    if (argc == 3 && shape == "plane") {
+        float size = atof(args[1].c_str());
+        plane(size, &mesh);
+    }
+    else if ((argc == 5 || argc == 6) && shape == "box") {
+        float dimX = atof(args[1].c_str());
+        float dimY = atof(args[2].c_str());
+        float dimZ = atof(args[3].c_str());
+        int divisions = 1;
+        if (argc == 6) divisions = atoi(args[4].c_str());
+        if (!validDivisions("divisions", divisions, BOX_MIN_DIVISIONS)) return false;
+        box(dimX, dimY, dimZ, divisions, &mesh);
+    }
+    else if (argc == 6 && shape == "cone") {
+        float radius = atof(args[1].c_str());
+        float height = atof(args[2].c_str());
+        int slices = atoi(args[3].c_str());
+        int stacks = atoi(args[4].c_str());
+        if (!validDivisions("slices", slices, CONE_MIN_SLICES) || !validDivisions("stacks", stacks, CONE_MIN_STACKS)) return false;
+
+        cone(radius, height, slices, stacks, &mesh);
+        shape_error = coneError(radius, slices);
+    }
+    else if (argc == 5 && shape == "sphere") {
+        float radius = atof(args[1].c_str());
+        int slices = atoi(args[2].c_str());
+        int stacks = atoi(args[3].c_str());
+        if (!validDivisions("slices", slices, SPHERE_MIN_SLICES) || !validDivisions("stacks", stacks, SPHERE_MIN_STACKS)) return false;
+
+        shape_error = sphereError(radius, slices, stacks);
+        if (cleanup) sphere(radius, slices, stacks, &mesh, options.nr_threads);
+        else {
+            if (error) *error = shape_error;
+            sphere(radius, slices, stacks, sink, options.nr_threads);
+            return true;
+        }
+    }
+    else if ((argc == 4 || (argc == 3 && options.tolerance > 0.0f)) && shape == "icosphere") {
+        float radius = atof(args[1].c_str());
+        int subdivisions = argc == 4 ? atoi(args[2].c_str()) : icosphereSubdivisions(radius, options.tolerance);
+        if (!validDivisions("subdivisions", subdivisions, 0, ICOSPHERE_MAX_SUBDIVISIONS)) return false;
+
+        icosphere(radius, subdivisions, &mesh);
+        if (error || argc == 3) shape_error = icosphereError(radius, subdivisions);
+        if (argc == 3) printIcosphereSavings(radius, subdivisions, mesh.getTriangleCount(), shape_error);
+    }
+    else if (argc == 6 && shape == "torus") {
+        float innerRadius = atof(args[1].c_str());
+        float outerRadius = atof(args[2].c_str());
+        int slices = atoi(args[4].c_str());
+        int stacks = atoi(args[3].c_str());
+        if (!validDivisions("slices", slices, TORUS_MIN_SLICES) || !validDivisions("stacks", stacks, TORUS_MIN_STACKS)) return false;
+
+        shape_error = torusError(innerRadius, outerRadius, slices, stacks);
+        if (cleanup) torus(innerRadius, outerRadius, slices, stacks, &mesh, options.nr_threads);
+        else {
+            if (error) *error = shape_error;
+            torus(innerRadius, outerRadius, slices, stacks, sink, options.nr_threads);
+            return true;
         }
+    }
+    else if (argc == 4 && bezier) {
+        string patchFileString = PATCHFILESFOLDER + args[1];
+        int tess_level = atoi(args[2].c_str());
+        if (!validDivisions("tessellation level", tess_level, BEZIER_MIN_TESSELLATION)) return false;
+
+        PatchFile* patch_file = patch_cache->get(patchFileString);
+        if (!patch_file) return false;
+        bezierPatches(patch_file, tess_level, &mesh, options.nr_threads);
+        if (error) shape_error = bezierPatchesError(patch_file, tess_level);
+    }
+    else if (argc == 3 && bezier && options.tolerance > 0.0f) {
+        string patchFileString = PATCHFILESFOLDER + args[1];
 
+        PatchFile* patch_file = patch_cache->get(patchFileString);
+        if (!patch_file) return false;
+        shape_error = bezierPatchesAdaptive(patch_file, options.tolerance, &mesh, options.nr_threads);
+        printAdaptiveSavings(patch_file, mesh.getTriangleCount(), shape_error);
+    }
+    else {
+        return false;
+    }
 
-        // Control points parsing
-        getline(file, line);
-        nr_control_points = atoi(line.c_str());
+    if (cleanup) printCleanupStats(cleanupMesh(&mesh));
+    if (error) *error = shape_error;
+    mesh.writeTo(sink);
+    return true;
+}
 
-        for (int i = 0; i < nr_control_points; i++) {
-            getline(file, line);
-            Ponto point = Ponto(line);
+// Builds every level of detail of a shape into a single mesh, from the finest to the coarsest.
+// args are the shape arguments without the divisions, which are taken from each level:
+// slices and stacks for sphere, cone and torus, slices only for box divisions, icosphere subdivisions and
+// Bezier tessellation
+bool generateLODs(vector<string>& args, GeneratorOptions& options, PatchFileCache* patch_cache, MeshSink* sink) {
+    vector<pair<int, int>> lods = options.lods;
+    string shape = args.empty() ? "" : args[0];
+    Mesh mesh;
+
+    sort(lods.begin(), lods.end(), [](pair<int, int> a, pair<int, int> b) {
+        return a.first * a.second > b.first * b.second;
+    });
+
+    for (pair<int, int>& lod : lods) {
+        vector<string> divisions;
+        if (shape == "sphere" || shape == "cone") divisions = {to_string(lod.first), to_string(lod.second)};
+        else if (shape == "torus") divisions = {to_string(lod.second), to_string(lod.first)};
+        else if (shape == "box" || shape == "icosphere" || shape == "--bezier" || shape == "bezier") divisions = {to_string(lod.first)};
+        else return false;
+
+        vector<string> lod_args = args;
+        lod_args.insert(lod_args.end() - 1, divisions.begin(), divisions.end());
+
+        MeshLOD mesh_lod;
+        mesh_lod.first_index = (unsigned int) mesh.indices.size();
+        mesh_lod.first_vertex = mesh.getVerticeCount();
+
+        MeshBuilder builder = MeshBuilder(&mesh);
+        if (!generateShape(lod_args, options, patch_cache, &builder, &mesh_lod.error)) return false;
+
+        mesh_lod.index_count = (unsigned int) mesh.indices.size() - mesh_lod.first_index;
+        mesh_lod.vertice_count = mesh.getVerticeCount() - mesh_lod.first_vertex;
+        mesh.lods.push_back(mesh_lod);
+    }
 
-            control_points.push_back(point);
-        }
+    mesh.writeTo(sink);
+    return true;
+}
+
+// The output file is always the last argument of a shape
+string shapeFile(vector<string>& args) {
+    return _3DFILESFOLDER + (args.empty() ? string() : args.back());
+}
 
-        file.close();
+// Everything that changes the file generated from args, for the asset cache: the shape and its parameters,
+// without the output file, and the options that change what's written
+vector<string> cacheInputs(vector<string>& args, GeneratorOptions& options) {
+    vector<string> inputs(args.begin(), args.empty() ? args.end() : args.end() - 1);
+
+    if (options.binary) inputs.push_back("--binary");
+    if (options.quantize) inputs.push_back("--quantize");
+    if (options.optimize) inputs.push_back("--optimize");
+    if (options.meshlets) inputs.push_back("--meshlets");
+    if (options.strips) inputs.push_back("--strips");
+    if (options.cleanup) inputs.push_back("--cleanup");
+    if (options.no_cleanup) inputs.push_back("--no-cleanup");
+    // Every digit of the tolerance changes the output, to_string would keep only 6 decimals
+    if (options.tolerance > 0.0f) {
+        char tolerance[32];
+        snprintf(tolerance, sizeof(tolerance), "%.9g", options.tolerance);
+        inputs.push_back("--tolerance");
+        inputs.push_back(tolerance);
     }
-	else {
-		std::cout << "Unable to open file: " << patchFile.c_str() << "\n";
-	}
+    if (!options.lods.empty()) inputs.push_back("--lods");
+    for (pair<int, int>& lod : options.lods) inputs.push_back(to_string(lod.first) + "x" + to_string(lod.second));
 
+    return inputs;
+}
 
-    // Calculate Bezier Surfaces
-    vector<Ponto> result_points;
-    vector<Ponto> result_normals;
+// Files read to generate args, whose contents are part of the cache key
+vector<string> cacheInputFiles(vector<string>& args) {
+    if (args.size() > 2 && (args[0] == "--bezier" || args[0] == "bezier")) return {PATCHFILESFOLDER + args[1]};
+    return {};
+}
 
-    // Processing of each patch
-    for (int i_p = 0; i_p < nr_patches; i_p++) {
-        vector<int> patch = patches[i_p];
-        vector<Ponto> cps;          // patch control points
-        vector<Ponto> grid_points;  // points obtained from control points
+// Stages a mesh goes through before it's written, as chosen by the options: optimization first, then the
+// split into clusters or the conversion to strips
+class MeshPipeline {
+    public:
+        MeshletBuilder meshlets;
+        MeshStripifier strips;
+        MeshOptimizer optimizer;
+        MeshSink* sink;
+
+        MeshPipeline(MeshSink* writer, GeneratorOptions& options) : meshlets(writer), strips(writer),
+                optimizer(options.meshlets ? (MeshSink*) &meshlets : options.strips ? (MeshSink*) &strips : writer) {
+            this->sink = options.optimize ? &this->optimizer : this->optimizer.getSink();
+        };
+};
+
+// Result of generating one asset of a manifest
+class ManifestAsset {
+    public:
+        vector<string> args;
+        string fileString;
+        bool valid = false;
+        bool written = false;
+        unsigned int nr_triangles = 0;
+        unsigned int nr_vertices = 0;
+        double time_ms = 0.0;
+        bool optimized = false;
+        bool clustered = false;
+        bool stripped = false;
+        bool cached = false;
+        CacheStats before, after;
+        MeshletStats meshlets;
+        StripStats strips;
+};
+
+void printCacheStats(CacheStats before, CacheStats after) {
+    printf("ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", before.acmr, after.acmr, before.atvr, after.atvr);
+}
 
-        // Get control points for this patch
-        for (int i_pp = 0; i_pp < patch.size(); i_pp++) {
-            cps.push_back(control_points[patch[i_pp]]);
-        }
+void printMeshletStats(MeshletStats stats) {
+    printf("%u meshlets, %.1f vertices and %.1f triangles per meshlet\n", stats.count, stats.vertices, stats.triangles);
+}
 
-        // Initialize matrices to calculate bezier surface points
-        Matrix<float> m = {{-1.0f,  3.0f, -3.0f,  1.0f},
-                           { 3.0f, -6.0f,  3.0f,  0.0f},
-                           {-3.0f,  3.0f,  0.0f,  0.0f},
-                           { 1.0f,  0.0f,  0.0f,  0.0f}};
-
-        Matrix<float> m_px = {{cps[0].getX(), cps[1].getX(), cps[2].getX(), cps[3].getX()},
-                              {cps[4].getX(), cps[5].getX(), cps[6].getX(), cps[7].getX()},
-                              {cps[8].getX(), cps[9].getX(), cps[10].getX(), cps[11].getX()},
-                              {cps[12].getX(), cps[13].getX(), cps[14].getX(), cps[15].getX()}};
-
-        Matrix<float> m_py = {{cps[0].getY(), cps[1].getY(), cps[2].getY(), cps[3].getY()},
-                              {cps[4].getY(), cps[5].getY(), cps[6].getY(), cps[7].getY()},
-                              {cps[8].getY(), cps[9].getY(), cps[10].getY(), cps[11].getY()},
-                              {cps[12].getY(), cps[13].getY(), cps[14].getY(), cps[15].getY()}};
-
-        Matrix<float> m_pz = {{cps[0].getZ(), cps[1].getZ(), cps[2].getZ(), cps[3].getZ()},
-                              {cps[4].getZ(), cps[5].getZ(), cps[6].getZ(), cps[7].getZ()},
-                              {cps[8].getZ(), cps[9].getZ(), cps[10].getZ(), cps[11].getZ()},
-                              {cps[12].getZ(), cps[13].getZ(), cps[14].getZ(), cps[15].getZ()}};
-
-        Matrix<float> m_x = m * m_px * m;
-        Matrix<float> m_y = m * m_py * m ;
-        Matrix<float> m_z = m * m_pz * m;
-        
-
-        // Give values to u and v to calculate grid points
-        float inc = 1.0 / tess_level;
-        for (float v = 0.0; v <= 1.0; v += inc) {
-            for (float u = 0.0; u <= 1.0; u += inc) {
-                Matrix<float> m_u = {{u*u*u, u*u, u, 1.0f}};
-
-                Matrix<float> m_v = {{v*v*v},
-                                     {v*v},
-                                     {v},
-                                     {1.0f}};
-                
-                float x_value = (m_u * m_x * m_v)[0][0];
-                float y_value = (m_u * m_y * m_v)[0][0];
-                float z_value = (m_u * m_z * m_v)[0][0];
-
-                grid_points.push_back(Ponto(x_value, y_value, z_value));
-            }
-        }
+void printStripStats(StripStats stats) {
+    printf("%u strips, %u indices instead of %u (%.1f%% saved)\n", stats.strips, stats.indices_after, stats.indices_before,
+           stats.indices_before > 0 ? 100.0 * (1.0 - (double) stats.indices_after / stats.indices_before) : 0.0);
+}
+
+// Generates every asset listed in a manifest file, one per line with the same arguments as the command line.
+// Empty lines and lines starting with # are ignored. Assets are independent, so they're generated in parallel
+int generateManifest(string manifestFile, GeneratorOptions& options) {
+    ifstream file;
+    string line;
+    vector<ManifestAsset> assets;
 
+    file.open(manifestFile.c_str(), ios::in);
+    if (!file.is_open()) {
+        std::cout << "Unable to open file: " << manifestFile.c_str() << "\n";
+        return 1;
+    }
 
-        // Write triangles correspondent to the grid
-        for (int v_ind = 0; v_ind < tess_level; v_ind++) {
-            for (int u_ind = 0; u_ind < tess_level; u_ind++) {
-                int points_per_line = tess_level + 1;
-                Ponto p0 = grid_points[u_ind   + v_ind     * points_per_line];
-                Ponto p1 = grid_points[u_ind+1 + v_ind     * points_per_line];
-                Ponto p2 = grid_points[u_ind   + (v_ind+1) * points_per_line];
-                Ponto p3 = grid_points[u_ind+1 + (v_ind+1) * points_per_line];
+    while (getline(file, line)) {
+        ManifestAsset asset;
+        string token;
+        istringstream tokenStream(line);
 
-                result_points.push_back(p0); result_points.push_back(p2); result_points.push_back(p1);
-                result_points.push_back(p1); result_points.push_back(p2); result_points.push_back(p3);
+        while (tokenStream >> token) asset.args.push_back(token);
+        if (asset.args.empty() || asset.args[0][0] == '#') continue;
 
-                result_normals.push_back(calculate_normal(p0, p2, p1));
-                result_normals.push_back(calculate_normal(p2, p1, p0));
-                result_normals.push_back(calculate_normal(p1, p0, p2));
+        assets.push_back(asset);
+    }
+    file.close();
 
-                result_normals.push_back(calculate_normal(p1, p2, p3));
-                result_normals.push_back(calculate_normal(p2, p3, p1));
-                result_normals.push_back(calculate_normal(p3, p1, p2));
+    // Threads are shared between assets first, whatever is left is used inside each asset
+    int nr_assets = (int) assets.size();
+    int inner_threads = nr_assets > 0 && options.nr_threads > nr_assets ? options.nr_threads / nr_assets : 1;
+    PatchFileCache patch_cache;
+    AssetCache asset_cache(options.cache_directory, options.cache_size);
+
+    auto start = chrono::steady_clock::now();
+
+    parallelFor(nr_assets, options.nr_threads, [&](int i) {
+        ManifestAsset& asset = assets[i];
+        GeneratorOptions asset_options = options;
+        asset_options.nr_threads = inner_threads;
+        vector<string> args = parseOptions(asset.args, &asset_options);
+
+        asset.fileString = shapeFile(args);
+        auto asset_start = chrono::steady_clock::now();
+
+        string key;
+        if (!asset_options.cache_directory.empty()) {
+            key = asset_cache.key(cacheInputs(args, asset_options), cacheInputFiles(args));
+            if (asset_cache.fetch(key, asset.fileString)) {
+                asset.valid = asset.written = asset.cached = true;
+                asset.time_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - asset_start).count();
+                return;
             }
         }
 
+        unique_ptr<MeshFileWriter> writer = openMeshWriter(asset.fileString, asset_options.binary, asset_options.quantize);
+        MeshPipeline pipeline(writer.get(), asset_options);
+
+        if (asset_options.lods.empty()) asset.valid = generateShape(args, asset_options, &patch_cache, pipeline.sink);
+        else asset.valid = generateLODs(args, asset_options, &patch_cache, pipeline.sink);
+        if (!asset.valid) return;
+        asset.written = !writer->hasFailed();
+        asset.optimized = asset_options.optimize;
+        asset.before = pipeline.optimizer.getStatsBefore();
+        asset.after = pipeline.optimizer.getStatsAfter();
+        asset.clustered = asset_options.meshlets;
+        asset.meshlets = pipeline.meshlets.getStats();
+        asset.stripped = asset_options.strips && !asset_options.meshlets;
+        asset.strips = pipeline.strips.getStats();
+
+        asset.nr_triangles = writer->getTriangleCount();
+        asset.nr_vertices = writer->getVerticeCount();
+        asset.time_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - asset_start).count();
+
+        if (!key.empty() && asset.written) asset_cache.store(key, asset.fileString);
+    });
+
+    double total_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    // Report each asset in the manifest order
+    int nr_invalid = 0;
+    for (ManifestAsset& asset : assets) {
+        if (!asset.valid) {
+            string line = asset.args[0];
+            for (size_t i = 1; i < asset.args.size(); i++) line += " " + asset.args[i];
+            std::cout << "Invalid asset: " << line << "\n";
+            nr_invalid++;
+            continue;
+        }
+        if (!asset.written) {
+            nr_invalid++;
+            continue;
+        }
+
+        if (asset.cached) {
+            printf("%-40s %31s %10.2f ms\n", asset.fileString.c_str(), "cached", asset.time_ms);
+            continue;
+        }
+        printf("%-40s %10u triangles %10u vertices %10.2f ms%s",
+               asset.fileString.c_str(), asset.nr_triangles, asset.nr_vertices, asset.time_ms, asset.optimized ? "   " : "\n");
+        if (asset.optimized) printCacheStats(asset.before, asset.after);
+        if (asset.clustered) {
+            printf("%-40s ", "");
+            printMeshletStats(asset.meshlets);
+        }
+        if (asset.stripped) {
+            printf("%-40s ", "");
+            printStripStats(asset.strips);
+        }
+    }
+    printf("%d assets generated in %.2f ms using %d threads\n", nr_assets - nr_invalid, total_ms, options.nr_threads);
+    if (!options.cache_directory.empty()) {
+        asset_cache.evict();
+        asset_cache.printStats();
     }
 
-    *ps = result_points;
-    *ns = result_normals;
+    return nr_invalid > 0 ? 1 : 0;
 }
 
-int main(int argc, char** argv) {
-
-    vector<Ponto> points;
-    vector<Ponto> normals;
-    vector<float> textures;
-    string fileString;
-
-    if (argc == 2 && strcmp(argv[1], "--help") == 0) {
-        generatorHelpMenu();
+// Simplifies a .3d file to ratio of its triangles. Files with levels of detail are simplified from the finest one
+int simplifyFile(string inputFile, float ratio, string outputFile, GeneratorOptions& options) {
+    Mesh mesh;
+    if (ratio <= 0.0f || ratio > 1.0f) {
+        std::cout << "Invalid input!\n";
+        return 1;
     }
-    else if (argc == 4 && strcmp(argv[1], "plane") == 0) {
-        float size = atof(argv[2]);
-        points = plane(size);
-
-        fileString = argv[3];
-        fileString = _3DFILESFOLDER + fileString;
+    if (!readMeshFile(_3DFILESFOLDER + inputFile, &mesh)) return 1;
 
-        writePointsToFile(points, nullptr, nullptr, fileString);
+    if (!mesh.lods.empty()) {
+        MeshLOD finest = mesh.lods[0];
+        mesh.indices.erase(mesh.indices.begin() + finest.first_index + finest.index_count, mesh.indices.end());
+        mesh.indices.erase(mesh.indices.begin(), mesh.indices.begin() + finest.first_index);
+        mesh.lods.clear();
     }
-    else if (argc >= 6 && strcmp(argv[1], "box") == 0) {
-        int i = 2;
-        float dimX = atof(argv[i++]); // i=2
-        float dimY = atof(argv[i++]); // i=3
-        float dimZ = atof(argv[i++]); // i=4
-        int divisions = 1;
-        if (argc == 7) divisions = atoi(argv[i++]); // i=5
-        points = box(dimX, dimY, dimZ, divisions);
 
-        fileString = argv[i]; // i=5 or 6
-        fileString = _3DFILESFOLDER + fileString;
+    Mesh simplified;
+    float error = simplifyMesh(&mesh, ratio, &simplified);
 
-        writePointsToFile(points, nullptr, nullptr, fileString);
-    }
-    else if (argc == 7 && strcmp(argv[1], "cone") == 0) {
-        float radius = atof(argv[2]);
-        float height = atof(argv[3]);
-        int slices = atoi(argv[4]);
-        int stacks = atoi(argv[5]);
-
-        points = cone(radius, height, slices, stacks);
+    unique_ptr<MeshFileWriter> writer = openMeshWriter(_3DFILESFOLDER + outputFile, options.binary, options.quantize);
+    MeshPipeline pipeline(writer.get(), options);
+    simplified.writeTo(pipeline.sink);
+    if (writer->hasFailed()) return 1;
 
-        fileString = argv[6];
-        fileString = _3DFILESFOLDER + fileString;
+    printf("%u triangles simplified to %u triangles, error %g\n", mesh.getTriangleCount(), simplified.getTriangleCount(), error);
+    if (options.optimize) printCacheStats(pipeline.optimizer.getStatsBefore(), pipeline.optimizer.getStatsAfter());
+    if (options.meshlets) printMeshletStats(pipeline.meshlets.getStats());
+    else if (options.strips) printStripStats(pipeline.strips.getStats());
+    return 0;
+}
 
-        writePointsToFile(points, nullptr, nullptr, fileString);
+// Generates a terrain from a heightmap. Each chunk is written to a .3d file of its own, in parallel, and the
+// files are then gathered in the terrain file. Skirts hang twice the largest error of the coarsest level of
+// the chunk and its neighbours, enough to cover the gap between any two of their levels
+int generateTerrain(vector<string>& args, GeneratorOptions& options) {
+    TerrainParameters parameters;
+    parameters.size = (float) atof(args[2].c_str());
+    parameters.height = (float) atof(args[3].c_str());
+    parameters.chunk_cells = atoi(args[4].c_str());
+    parameters.lod_count = atoi(args[5].c_str());
+    if (parameters.size <= 0.0f || parameters.chunk_cells < 1 || parameters.lod_count < 1) {
+        std::cout << "Invalid input!\n";
+        return 1;
     }
-    else if (argc == 6 && strcmp(argv[1], "sphere") == 0) {
-        float radius = atof(argv[2]);
-        int slices = atoi(argv[3]);
-        int stacks = atoi(argv[4]);
+    while (parameters.lod_count > 1 && (1 << (parameters.lod_count - 1)) > parameters.chunk_cells) parameters.lod_count--;
+
+    Heightmap heightmap;
+    if (!readHeightmap(HEIGHTMAPFILESFOLDER + args[1], &heightmap)) return 1;
+
+    auto start = chrono::steady_clock::now();
+    int chunks_x = terrainChunksX(heightmap, parameters), chunks_z = terrainChunksZ(heightmap, parameters);
+    int nr_chunks = chunks_x * chunks_z;
+
+    vector<float> coarsest_errors(nr_chunks);
+    parallelFor(nr_chunks, options.nr_threads, [&](int i) {
+        coarsest_errors[i] = terrainChunkError(heightmap, parameters, i % chunks_x, i / chunks_x, parameters.lod_count - 1);
+    });
+
+    string fileString = _3DFILESFOLDER + args[6];
+    vector<string> chunkFiles(nr_chunks);
+    vector<unsigned int> nr_triangles(nr_chunks, 0);
+    vector<bool> written(nr_chunks, false);
+    parallelFor(nr_chunks, options.nr_threads, [&](int i) {
+        int x = i % chunks_x, z = i / chunks_x;
+        float error = coarsest_errors[i];
+        if (x > 0) error = max(error, coarsest_errors[i - 1]);
+        if (x + 1 < chunks_x) error = max(error, coarsest_errors[i + 1]);
+        if (z > 0) error = max(error, coarsest_errors[i - chunks_x]);
+        if (z + 1 < chunks_z) error = max(error, coarsest_errors[i + chunks_x]);
+        float skirt_depth = 2.0f * error + 0.05f * parameters.size / (heightmap.width - 1);
+
+        Mesh mesh;
+        terrainChunk(heightmap, parameters, x, z, skirt_depth, &mesh);
+
+        chunkFiles[i] = fileString + "." + to_string(i) + ".tmp";
+        unique_ptr<MeshFileWriter> writer = openMeshWriter(chunkFiles[i], true, options.quantize);
+        MeshPipeline pipeline(writer.get(), options);
+        mesh.writeTo(pipeline.sink);
+        written[i] = !writer->hasFailed();
+        nr_triangles[i] = mesh.lods[0].index_count / 3;
+    });
+
+    bool valid = find(written.begin(), written.end(), false) == written.end() &&
+                 writeTerrainFile(fileString, heightmap, parameters, chunkFiles);
+    for (string& chunkFile : chunkFiles) remove(chunkFile.c_str());
+    if (!valid) return 1;
+
+    unsigned int total_triangles = 0;
+    for (unsigned int chunk_triangles : nr_triangles) total_triangles += chunk_triangles;
+    double time_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    printf("%d x %d chunks, %d levels of detail, %u triangles at the finest level, %.2f ms\n",
+           chunks_x, chunks_z, parameters.lod_count, total_triangles, time_ms);
+    return 0;
+}
 
-        sphere(radius, slices, stacks, &points, &normals, &textures);
+int main(int argc, char** argv) {
 
-        fileString = argv[5];
-        fileString = _3DFILESFOLDER + fileString;
+    // Parse options, removing them from the arguments list
+    GeneratorOptions options;
+    vector<string> args = parseOptions(vector<string>(argv + 1, argv + argc), &options);
 
-        writePointsToFile(points, &normals, &textures, fileString);
+    if (args.size() == 1 && args[0] == "--help") {
+        generatorHelpMenu();
     }
-    else if (argc == 7 && strcmp(argv[1], "torus") == 0) {
-        float innerRadius = atof(argv[2]);
-        float outerRadius = atof(argv[3]);
-        int slices = atoi(argv[5]);
-        int stacks = atoi(argv[4]);
-
-        torus(innerRadius, outerRadius, slices, stacks, &points, &normals, &textures);
+    else if (args.size() == 2 && args[0] == "--manifest") {
+        return generateManifest(args[1], options);
+    }
+    else if (args.size() == 4 && args[0] == "--simplify") {
+        return simplifyFile(args[1], (float) atof(args[2].c_str()), args[3], options);
+    }
+    else if (args.size() == 7 && args[0] == "--terrain") {
+        return generateTerrain(args, options);
+    }
+    else {
+        AssetCache asset_cache(options.cache_directory, options.cache_size);
+        string key;
+        if (!options.cache_directory.empty()) {
+            key = asset_cache.key(cacheInputs(args, options), cacheInputFiles(args));
+            if (asset_cache.fetch(key, shapeFile(args))) {
+                asset_cache.evict();
+                asset_cache.printStats();
+                return 0;
+            }
+        }
 
-        fileString = argv[6];
-        fileString = _3DFILESFOLDER + fileString;
+        PatchFileCache patch_cache;
+        unique_ptr<MeshFileWriter> writer = openMeshWriter(shapeFile(args), options.binary, options.quantize);
+        MeshPipeline pipeline(writer.get(), options);
 
-        writePointsToFile(points, &normals, &textures, fileString);
-    }
-    else if (argc == 5 && strcmp(argv[1], "--bezier") == 0) {
-        string patchFileString = argv[2];
-        int tess_level = atoi(argv[3]);
-        string _3dFileString = argv[4];
-        
-        patchFileString = PATCHFILESFOLDER + patchFileString;
-        bezierTo3DFile(patchFileString, tess_level, &points, &normals);
-        
-        _3dFileString = _3DFILESFOLDER + _3dFileString;
-        writePointsToFile(points, &normals, nullptr, _3dFileString);
+        bool valid = options.lods.empty() ? generateShape(args, options, &patch_cache, pipeline.sink)
+                                          : generateLODs(args, options, &patch_cache, pipeline.sink);
+        if (!valid) {
+            std::cout << "Invalid input!\n";
+            return 1;
+        }
+        if (writer->hasFailed()) return 1;
+        if (options.optimize) printCacheStats(pipeline.optimizer.getStatsBefore(), pipeline.optimizer.getStatsAfter());
+        if (options.meshlets) printMeshletStats(pipeline.meshlets.getStats());
+        else if (options.strips) printStripStats(pipeline.strips.getStats());
+
+        if (!key.empty()) {
+            asset_cache.store(key, shapeFile(args));
+            asset_cache.evict();
+            asset_cache.printStats();
+        }
     }
 
+    return 0;
 }
@@ -0,0 +1,605 @@
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cmath>
+#include <string.h>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <functional>
+
+#if defined(__linux__)
+#include <stdlib.h>
+#elif !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+#include "bezier.h"
+#include "primitives.h"
+#include "mesh_writer.h"
+#include "asset_cache.h"
+#include "../utils/file3d.h"
+#include "../utils/float_vector.h"
+#include "../utils/ponto.h"
+#include "../lib/Matrix.tpp"
+
+#define PATCHFILESFOLDER "../../filesPATCH/"
+
+using namespace std;
+
+// Keeps the compiler from optimizing away results that are never used
+volatile float bench_sink;
+
+double elapsedSeconds(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Previous evaluation of a patch grid, kept as a reference: one matrix product chain per
+// coordinate and per sample, every matrix allocated on the heap
+void evaluatePatchGridMatrix(const float cps[16][3], int tess_level, float* points) {
+    Matrix<float> m = {{-1.0f,  3.0f, -3.0f,  1.0f},
+                       { 3.0f, -6.0f,  3.0f,  0.0f},
+                       {-3.0f,  3.0f,  0.0f,  0.0f},
+                       { 1.0f,  0.0f,  0.0f,  0.0f}};
+
+    auto coordinateMatrix = [&](int c) {
+        Matrix<float> m_c = {{cps[0][c], cps[1][c], cps[2][c], cps[3][c]},
+                             {cps[4][c], cps[5][c], cps[6][c], cps[7][c]},
+                             {cps[8][c], cps[9][c], cps[10][c], cps[11][c]},
+                             {cps[12][c], cps[13][c], cps[14][c], cps[15][c]}};
+        return m * m_c * m;
+    };
+    Matrix<float> m_p[3] = {coordinateMatrix(0), coordinateMatrix(1), coordinateMatrix(2)};
+
+    float inc = 1.0 / tess_level;
+    for (int v_ind = 0; v_ind <= tess_level; v_ind++) {
+        for (int u_ind = 0; u_ind <= tess_level; u_ind++) {
+            float u = u_ind * inc;
+            float v = v_ind * inc;
+
+            Matrix<float> m_u = {{u*u*u, u*u, u, 1.0f}};
+            Matrix<float> m_v = {{v*v*v}, {v*v}, {v}, {1.0f}};
+
+            float* p = &points[(u_ind + v_ind * (tess_level + 1)) * 3];
+            for (int c = 0; c < 3; c++) p[c] = (m_u * m_p[c] * m_v)[0][0];
+        }
+    }
+}
+
+// Compares the matrix based Bezier evaluation with the precomputed basis one
+void benchBezierEvaluation(string patchFile) {
+    PatchFile patch_file;
+    if (!readPatchFile(patchFile, &patch_file)) return;
+    size_t nr_patches = patch_file.getPatchCount();
+
+    vector<float> cps(nr_patches * 16 * 3);
+    for (size_t i_p = 0; i_p < nr_patches; i_p++) patch_file.getControlPoints(i_p, (float (*)[3]) &cps[i_p * 48]);
+
+    cout << "Bezier grid evaluation (" << nr_patches << " patches)" << endl;
+
+    int levels[] = {8, 32, 128};
+    for (int tess_level : levels) {
+        size_t points_per_patch = (tess_level + 1) * (tess_level + 1);
+        vector<float> matrix_points(points_per_patch * 3);
+        vector<float> basis_points(points_per_patch * 3);
+
+        // Run each version for at least a fraction of a second
+        int matrix_runs = 0;
+        auto start = chrono::steady_clock::now();
+        do {
+            for (size_t i_p = 0; i_p < nr_patches; i_p++)
+                evaluatePatchGridMatrix((const float (*)[3]) &cps[i_p * 48], tess_level, matrix_points.data());
+            matrix_runs++;
+        } while (elapsedSeconds(start) < 0.5);
+        double matrix_time = elapsedSeconds(start) / matrix_runs;
+        bench_sink = matrix_points[0];
+
+        int basis_runs = 0;
+        float max_diff = 0.0f;
+        start = chrono::steady_clock::now();
+        do {
+            BezierBasis basis = BezierBasis(tess_level);
+            for (size_t i_p = 0; i_p < nr_patches; i_p++)
+                evaluatePatchGrid((const float (*)[3]) &cps[i_p * 48], basis, basis_points.data());
+            basis_runs++;
+        } while (elapsedSeconds(start) < 0.5);
+        double basis_time = elapsedSeconds(start) / basis_runs;
+        bench_sink = basis_points[0];
+
+        // Both versions must give the same points, apart from rounding
+        for (size_t i = 0; i < basis_points.size(); i++)
+            max_diff = fmax(max_diff, fabs(basis_points[i] - matrix_points[i]));
+
+        double nr_points = (double) points_per_patch * nr_patches;
+        cout << "  level " << tess_level
+             << ": matrix " << nr_points / matrix_time / 1e6 << " Mpoints/s"
+             << ", basis " << nr_points / basis_time / 1e6 << " Mpoints/s"
+             << ", speedup " << matrix_time / basis_time << "x"
+             << ", max difference " << max_diff << endl;
+    }
+}
+
+// Previous sphere, torus and cone, kept as a reference: every vertex calls sin and cos again
+void sphereTrigPerVertex(float raio, int nrSlices, int nrStacks, Mesh* mesh) {
+    float defaultAngleFatia = (2 * M_PI) / nrSlices;
+    float defaultAngleStack = M_PI / nrStacks;
+    int pontosPorFatia = nrStacks + 1;
+
+    for (int fatiaNr = 0; fatiaNr <= nrSlices; fatiaNr++) {
+        float anguloFatia = fatiaNr * defaultAngleFatia;
+
+        for (int nrCamada = 0; nrCamada <= nrStacks; nrCamada++) {
+            float anguloStack = - M_PI_2 + nrCamada * defaultAngleStack;
+
+            Ponto p = Ponto(raio * cos(anguloStack) * sin(anguloFatia), raio * sin(anguloStack), raio * cos(anguloStack) * cos(anguloFatia));
+            if (nrCamada == 0) p = Ponto(0.0f, -raio, 0.0f);
+            if (nrCamada == nrStacks) p = Ponto(0.0f, raio, 0.0f);
+
+            mesh->addPoint(p);
+            mesh->addNormal(vector_normalize_ponto(p));
+            mesh->addTexture( (float) fatiaNr / nrSlices, (float) nrCamada / nrStacks );
+        }
+    }
+
+    for (int fatiaNr = 0; fatiaNr < nrSlices; fatiaNr++) {
+        unsigned int fatia = fatiaNr * pontosPorFatia;
+        unsigned int proxFatia = fatia + pontosPorFatia;
+
+        mesh->addTriangle(fatia, proxFatia + 1, fatia + 1);
+        for (int nrCamada = 1; nrCamada < nrStacks - 1; nrCamada++) {
+            mesh->addTriangle(fatia + nrCamada, proxFatia + nrCamada, fatia + nrCamada + 1);
+            mesh->addTriangle(proxFatia + nrCamada, proxFatia + nrCamada + 1, fatia + nrCamada + 1);
+        }
+        mesh->addTriangle(fatia + nrStacks - 1, proxFatia + nrStacks - 1, fatia + nrStacks);
+    }
+}
+
+void torusTrigPerVertex(float innerRadius, float outerRadius, int slices, int stacks, Mesh* mesh) {
+    float sliceAngle = (2 * M_PI) / slices;
+    float stackAngle = (2 * M_PI) / stacks;
+    int pointsPerSlice = stacks + 1;
+
+    for (int i = 0; i <= slices; i++) {
+        float alpha = i * sliceAngle;
+        Ponto center = Ponto(cos(alpha) * outerRadius, 0.0, sin(alpha) * outerRadius);
+
+        for (int j = 0; j <= stacks; j++) {
+            float beta = j * stackAngle;
+
+            Ponto p = Ponto(cos(alpha) * (innerRadius * sin(beta) + outerRadius),
+                            -cos(beta) * innerRadius,
+                            sin(alpha) * (innerRadius * sin(beta) + outerRadius));
+
+            mesh->addPoint(p);
+            mesh->addNormal(vector_normalize_ponto(vector_sub_ponto(p, center)));
+            mesh->addTexture( (float) j / stacks, (float) i / slices );
+        }
+    }
+
+    for (int i = 0; i < slices; i++) {
+        for (int j = 0; j < stacks; j++) {
+            unsigned int p1 = i * pointsPerSlice + j;
+            unsigned int p2 = i * pointsPerSlice + j + 1;
+            unsigned int p3 = (i+1) * pointsPerSlice + j + 1;
+            unsigned int p4 = (i+1) * pointsPerSlice + j;
+
+            mesh->addTriangle(p1, p2, p3);
+            mesh->addTriangle(p1, p3, p4);
+        }
+    }
+}
+
+void coneTrigPerVertex(float raioBase, float alturaCone, int nrSlices, int nrStacks, Mesh* mesh) {
+    float defaultAngleFatia = (2 * M_PI) / nrSlices;
+    float alturaStack = alturaCone / nrStacks;
+    float mudancaRaioStack = raioBase / nrStacks;
+
+    unsigned int centro = mesh->addPoint(Ponto(0.0f, 0.0f, 0.0f));
+    for (int fatiaNr = 0; fatiaNr < nrSlices; fatiaNr++) {
+        float angulo = fatiaNr * defaultAngleFatia;
+        mesh->addPoint(Ponto(raioBase * cos(angulo), 0.0f, raioBase * sin(angulo)));
+    }
+    for (int fatiaNr = 0; fatiaNr < nrSlices; fatiaNr++) {
+        mesh->addTriangle(centro, centro + 1 + fatiaNr, centro + 1 + (fatiaNr + 1) % nrSlices);
+    }
+
+    unsigned int base = mesh->getVerticeCount();
+    for (int nrCamada = 0; nrCamada < nrStacks; nrCamada++) {
+        float altura = nrCamada * alturaStack;
+        float raio = raioBase - nrCamada * mudancaRaioStack;
+
+        for (int fatiaNr = 0; fatiaNr < nrSlices; fatiaNr++) {
+            float angulo = fatiaNr * defaultAngleFatia;
+            mesh->addPoint(Ponto(raio * cos(angulo), altura, raio * sin(angulo)));
+        }
+    }
+    unsigned int topo = mesh->addPoint(Ponto(0.0f, alturaCone, 0.0f));
+
+    for (int fatiaNr = 0; fatiaNr < nrSlices; fatiaNr++) {
+        unsigned int proxFatia = (fatiaNr + 1) % nrSlices;
+
+        for (int nrCamada = 0; nrCamada < nrStacks - 1; nrCamada++) {
+            unsigned int camada = base + nrCamada * nrSlices;
+            unsigned int proxCamada = camada + nrSlices;
+
+            mesh->addTriangle(proxCamada + proxFatia, camada + proxFatia, camada + fatiaNr);
+            mesh->addTriangle(proxCamada + fatiaNr, proxCamada + proxFatia, camada + fatiaNr);
+        }
+        unsigned int ultimaCamada = base + (nrStacks - 1) * nrSlices;
+        mesh->addTriangle(ultimaCamada + proxFatia, ultimaCamada + fatiaNr, topo);
+    }
+}
+
+// Largest difference between two arrays, relative to the largest absolute value in the first one
+float maxRelativeDifference(vector<float>& a, vector<float>& b) {
+    float max_diff = 0.0f, max_value = 0.0f;
+
+    for (size_t i = 0; i < a.size() && i < b.size(); i++) {
+        max_diff = fmax(max_diff, fabs(a[i] - b[i]));
+        max_value = fmax(max_value, fabs(a[i]));
+    }
+    return max_value > 0.0f ? max_diff / max_value : max_diff;
+}
+
+// Compares the primitives using sine and cosine tables with the previous ones, for numeric tolerance and speed
+void benchPrimitiveTrig() {
+    int stacks = 100;
+    int slices_list[] = {1000, 4000, 10000};
+
+    cout << "Primitives with trig tables (" << stacks << " stacks)" << endl;
+
+    for (int slices : slices_list) {
+        for (int shape = 0; shape < 3; shape++) {
+            Mesh previous, tables;
+
+            auto start = chrono::steady_clock::now();
+            if (shape == 0) sphereTrigPerVertex(1.0f, slices, stacks, &previous);
+            if (shape == 1) torusTrigPerVertex(0.5f, 2.0f, slices, stacks, &previous);
+            if (shape == 2) coneTrigPerVertex(1.0f, 2.0f, slices, stacks, &previous);
+            double previous_time = elapsedSeconds(start);
+
+            start = chrono::steady_clock::now();
+            if (shape == 0) sphere(1.0f, slices, stacks, &tables);
+            if (shape == 1) torus(0.5f, 2.0f, slices, stacks, &tables);
+            if (shape == 2) cone(1.0f, 2.0f, slices, stacks, &tables);
+            double tables_time = elapsedSeconds(start);
+
+            bool same_topology = previous.indices == tables.indices && previous.points.size() == tables.points.size();
+
+            cout << "  " << (shape == 0 ? "sphere" : shape == 1 ? "torus " : "cone  ") << " " << slices << " slices"
+                 << ": previous " << previous_time * 1e3 << " ms"
+                 << ", tables " << tables_time * 1e3 << " ms"
+                 << ", speedup " << previous_time / tables_time << "x"
+                 << ", points difference " << maxRelativeDifference(previous.points, tables.points)
+                 << ", normals difference " << maxRelativeDifference(previous.normals, tables.normals)
+                 << (same_topology ? "" : ", DIFFERENT TOPOLOGY") << endl;
+        }
+    }
+}
+
+// Previous text writer, kept as a reference: the whole mesh is built first and every line is a temporary string
+void writeTextFileToString(Mesh* mesh, string fileString) {
+    ofstream file;
+    file.open(fileString, ios::out | ios::trunc);
+    file << mesh->getVerticeCount() << " " << mesh->indices.size() << "\n";
+    !mesh->normals.empty() ? file << "true\n" : file << "false\n";
+    !mesh->textures.empty() ? file << "true\n" : file << "false\n";
+
+    vector<float>& ps = mesh->points;
+    for (size_t i = 0; i < ps.size(); i += 3) file << to_string(ps[i]) + ", " + to_string(ps[i+1]) + ", " + to_string(ps[i+2]) + "\n";
+    vector<float>& ns = mesh->normals;
+    for (size_t i = 0; i < ns.size(); i += 3) file << to_string(ns[i]) + ", " + to_string(ns[i+1]) + ", " + to_string(ns[i+2]) + "\n";
+    vector<float>& ts = mesh->textures;
+    for (size_t i = 0; i < ts.size(); i += 2) file << to_string(ts[i]) + ", " + to_string(ts[i+1]) + "\n";
+    vector<unsigned int>& is = mesh->indices;
+    for (size_t i = 0; i < is.size(); i += 3) file << to_string(is[i]) + ", " + to_string(is[i+1]) + ", " + to_string(is[i+2]) + "\n";
+
+    file.close();
+}
+
+// Previous binary writer, kept as a reference: the whole mesh is built first and the indices are copied to narrow them
+void writeBinaryFileCopying(Mesh* mesh, string fileString) {
+    uint32_t vertice_count = mesh->getVerticeCount();
+
+    File3DHeader header = {};
+    header.version = FILE3D_VERSION;
+    header.header_size = sizeof(File3DHeader);
+    header.flags = FILE3D_HAS_NORMALS | FILE3D_HAS_TEXTURES;
+    header.vertice_count = vertice_count;
+    header.points_offset = FILE3D_HEADER_SIZE;
+    header.normals_offset = header.points_offset + vertice_count * 3 * sizeof(float);
+    header.textures_offset = header.normals_offset + vertice_count * 3 * sizeof(float);
+    header.index_count = (uint32_t) mesh->indices.size();
+    header.index_size = vertice_count <= FILE3D_MAX_SHORT_INDEX + 1 ? sizeof(uint16_t) : sizeof(uint32_t);
+    header.indices_offset = header.textures_offset + vertice_count * 2 * sizeof(float);
+
+    char header_bytes[FILE3D_HEADER_SIZE];
+    encodeFile3DHeader(&header, header_bytes);
+
+    ofstream file;
+    file.open(fileString, ios::out | ios::trunc | ios::binary);
+    file.write(header_bytes, FILE3D_HEADER_SIZE);
+    file.write((const char*) mesh->points.data(), mesh->points.size() * sizeof(float));
+    file.write((const char*) mesh->normals.data(), mesh->normals.size() * sizeof(float));
+    file.write((const char*) mesh->textures.data(), mesh->textures.size() * sizeof(float));
+    if (header.index_size == sizeof(uint16_t)) {
+        vector<uint16_t> short_indices(mesh->indices.begin(), mesh->indices.end());
+        file.write((const char*) short_indices.data(), short_indices.size() * sizeof(uint16_t));
+    }
+    else {
+        vector<uint32_t> int_indices(mesh->indices.begin(), mesh->indices.end());
+        file.write((const char*) int_indices.data(), int_indices.size() * sizeof(uint32_t));
+    }
+    file.close();
+}
+
+double fileSizeMB(string fileString) {
+    ifstream file(fileString, ios::in | ios::binary | ios::ate);
+    return file.tellg() / 1e6;
+}
+
+// Compares building a sphere and writing it with the previous writers against streaming it to the mesh writers
+void benchMeshWriters(int divisions) {
+    string fileString = "generator_bench.3d";
+
+    cout << "Writing a " << divisions << "x" << divisions << " sphere" << endl;
+
+    for (int binary = 0; binary <= 1; binary++) {
+        auto start = chrono::steady_clock::now();
+        Mesh mesh;
+        sphere(1.0f, divisions, divisions, &mesh);
+        if (binary) writeBinaryFileCopying(&mesh, fileString);
+        else writeTextFileToString(&mesh, fileString);
+        double previous_time = elapsedSeconds(start);
+        double previous_size = fileSizeMB(fileString);
+
+        start = chrono::steady_clock::now();
+        unique_ptr<MeshFileWriter> writer = openMeshWriter(fileString, binary);
+        sphere(1.0f, divisions, divisions, writer.get());
+        double stream_time = elapsedSeconds(start);
+        double stream_size = fileSizeMB(fileString);
+
+        cout << "  " << (binary ? "binary" : "text  ")
+             << ": previous " << previous_size / previous_time << " MB/s (" << previous_size << " MB)"
+             << ", streamed " << stream_size / stream_time << " MB/s (" << stream_size << " MB)"
+             << ", speedup " << previous_time / stream_time << "x" << endl;
+    }
+
+    remove(fileString.c_str());
+}
+
+// Sink that only counts what it receives, to time the generation alone
+class CountingSink : public MeshSink {
+    public:
+        size_t floats = 0;
+        size_t indices_count = 0;
+
+        void begin(unsigned int, unsigned int, bool, bool) {};
+        void points(const float* values, size_t count) {this->floats += count; bench_sink = values[0];};
+        void normals(const float* values, size_t count) {this->floats += count; bench_sink = values[0];};
+        void textures(const float* values, size_t count) {this->floats += count; bench_sink = values[0];};
+        void indices(const unsigned int* values, size_t count) {this->indices_count += count; bench_sink = values[0];};
+        void end() {};
+};
+
+// Generation speed of very large spheres and toruses, streamed so that only the generation is measured
+void benchLargeMeshes(int divisions) {
+    const char* isa = "generic";
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    if (__builtin_cpu_supports("avx2")) isa = "avx2";
+    else if (__builtin_cpu_supports("sse4.2")) isa = "sse4.2";
+#endif
+
+    cout << "Large meshes (" << divisions << "x" << divisions << ", row kernels for " << isa << ")" << endl;
+
+    for (int shape = 0; shape < 2; shape++) {
+        CountingSink sink;
+
+        auto start = chrono::steady_clock::now();
+        if (shape == 0) sphere(1.0f, divisions, divisions, &sink);
+        else torus(0.5f, 2.0f, divisions, divisions, &sink);
+        double time = elapsedSeconds(start);
+
+        double nr_triangles = sink.indices_count / 3.0;
+        cout << "  " << (shape == 0 ? "sphere" : "torus ") << ": " << nr_triangles / 1e6 << "M triangles in " << time << " s"
+             << ", " << nr_triangles / time / 1e6 << " Mtriangles/s"
+             << ", " << (sink.floats * sizeof(float) + sink.indices_count * sizeof(unsigned int)) / time / 1e9 << " GB/s" << endl;
+    }
+}
+
+// Resets the peak memory of the process, so each benchmark reports its own. Only possible on Linux,
+// elsewhere the peak is the largest of every benchmark run so far
+void resetPeakRSS() {
+#if defined(__linux__)
+    FILE* file = fopen("/proc/self/clear_refs", "w");
+    if (file) {
+        fputs("5", file);
+        fclose(file);
+    }
+#endif
+}
+
+// Peak resident set size of the process in KB, 0 if it can't be measured
+long peakRSSKB() {
+#if defined(__linux__)
+    FILE* file = fopen("/proc/self/status", "r");
+    if (!file) return 0;
+
+    char line[256];
+    long peak = 0;
+    while (fgets(line, sizeof(line), file)) {
+        if (strncmp(line, "VmHWM:", 6) == 0) peak = atol(line + 6);
+    }
+    fclose(file);
+    return peak;
+#elif defined(_WIN32)
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024;    // bytes on macOS
+#endif
+}
+
+// Timings of one shape with one set of parameters. Generation builds the mesh in memory,
+// serialization writes that mesh to a text and to a binary file
+class BenchResult {
+    public:
+        string shape;
+        string params;
+        unsigned int nr_vertices = 0;
+        unsigned int nr_triangles = 0;
+        double generate_time = 0.0;
+        double text_bytes = 0.0, text_time = 0.0;
+        double binary_bytes = 0.0, binary_time = 0.0;
+        long peak_rss_kb = 0;
+};
+
+// Best time of running f, repeated for at least a fraction of a second
+double bestTime(function<void()> f) {
+    double best = 0.0;
+    auto start = chrono::steady_clock::now();
+    int runs = 0;
+
+    do {
+        auto run_start = chrono::steady_clock::now();
+        f();
+        double time = elapsedSeconds(run_start);
+        if (runs == 0 || time < best) best = time;
+        runs++;
+    } while (elapsedSeconds(start) < 0.3);
+
+    return best;
+}
+
+BenchResult benchShape(string shape, string params, function<void(Mesh*)> generate) {
+    string fileString = "generator_bench.3d";
+    BenchResult result;
+    result.shape = shape;
+    result.params = params;
+
+    resetPeakRSS();
+
+    result.generate_time = bestTime([&]() {
+        Mesh mesh;
+        generate(&mesh);
+        bench_sink = mesh.points.empty() ? 0.0f : mesh.points[0];
+    });
+
+    Mesh mesh;
+    generate(&mesh);
+    result.nr_vertices = mesh.getVerticeCount();
+    result.nr_triangles = mesh.getTriangleCount();
+
+    for (int binary = 0; binary <= 1; binary++) {
+        double time = bestTime([&]() {
+            unique_ptr<MeshFileWriter> writer = openMeshWriter(fileString, binary);
+            mesh.writeTo(writer.get());
+        });
+        double bytes = fileSizeMB(fileString) * 1e6;
+
+        if (binary) {
+            result.binary_time = time;
+            result.binary_bytes = bytes;
+        }
+        else {
+            result.text_time = time;
+            result.text_bytes = bytes;
+        }
+    }
+    remove(fileString.c_str());
+
+    result.peak_rss_kb = peakRSSKB();
+    return result;
+}
+
+// Every primitive and the Bezier patches across a sweep of their divisions
+vector<BenchResult> benchSuite(string patchFile) {
+    vector<BenchResult> results;
+    int divisions[] = {16, 64, 256, 1024};
+    int tess_levels[] = {4, 16, 64};
+
+    results.push_back(benchShape("plane", "1", [](Mesh* mesh) {plane(1.0f, mesh);}));
+    for (int d : divisions) {
+        results.push_back(benchShape("box", "1 1 1 " + to_string(d / 4), [&](Mesh* mesh) {box(1.0f, 1.0f, 1.0f, d / 4, mesh);}));
+    }
+    for (int d : divisions) {
+        results.push_back(benchShape("cone", "1 2 " + to_string(d) + " " + to_string(d), [&](Mesh* mesh) {cone(1.0f, 2.0f, d, d, mesh);}));
+    }
+    for (int d : divisions) {
+        results.push_back(benchShape("sphere", "1 " + to_string(d) + " " + to_string(d), [&](Mesh* mesh) {sphere(1.0f, d, d, mesh);}));
+    }
+    for (int d : divisions) {
+        results.push_back(benchShape("torus", "0.5 2 " + to_string(d) + " " + to_string(d), [&](Mesh* mesh) {torus(0.5f, 2.0f, d, d, mesh);}));
+    }
+    // The largest sphere and torus again with several threads, the speedup over the same shape with one
+    for (int nr_threads : {2, 4, 8}) {
+        results.push_back(benchShape("sphere", "1 1024 1024 -j" + to_string(nr_threads), [&](Mesh* mesh) {sphere(1.0f, 1024, 1024, mesh, nr_threads);}));
+        results.push_back(benchShape("torus", "0.5 2 1024 1024 -j" + to_string(nr_threads), [&](Mesh* mesh) {torus(0.5f, 2.0f, 1024, 1024, mesh, nr_threads);}));
+    }
+    for (int tess_level : tess_levels) {
+        results.push_back(benchShape("bezier", to_string(tess_level), [&](Mesh* mesh) {bezierTo3DFile(patchFile, tess_level, mesh, 1);}));
+    }
+
+    cout << "Generator suite (vertices/s of generation, MB/s of serialization, peak RSS)" << endl;
+    for (BenchResult& result : results) {
+        printf("  %-7s %-19s %9u vertices  %8.2f Mvertices/s  text %8.1f MB/s  binary %8.1f MB/s  %8ld KB\n",
+               result.shape.c_str(), result.params.c_str(), result.nr_vertices,
+               result.nr_vertices / result.generate_time / 1e6,
+               result.text_bytes / result.text_time / 1e6, result.binary_bytes / result.binary_time / 1e6,
+               result.peak_rss_kb);
+    }
+
+    return results;
+}
+
+// One object per benchmark, times in seconds and rates per second, to compare runs of different commits
+void writeBenchJSON(vector<BenchResult>& results, string jsonFile) {
+    FILE* file = fopen(jsonFile.c_str(), "w");
+    if (!file) {
+        cout << "Unable to open file: " << jsonFile << "\n";
+        return;
+    }
+
+    fprintf(file, "{\n  \"generator_version\": \"%s\",\n  \"results\": [\n", GENERATOR_VERSION);
+    for (size_t i = 0; i < results.size(); i++) {
+        BenchResult& r = results[i];
+        fprintf(file, "    {\"shape\": \"%s\", \"params\": \"%s\", \"vertices\": %u, \"triangles\": %u, "
+                      "\"generate_s\": %.9g, \"vertices_per_s\": %.9g, "
+                      "\"text_bytes\": %.0f, \"text_write_s\": %.9g, \"text_bytes_per_s\": %.9g, "
+                      "\"binary_bytes\": %.0f, \"binary_write_s\": %.9g, \"binary_bytes_per_s\": %.9g, "
+                      "\"peak_rss_kb\": %ld}%s\n",
+                r.shape.c_str(), r.params.c_str(), r.nr_vertices, r.nr_triangles,
+                r.generate_time, r.nr_vertices / r.generate_time,
+                r.text_bytes, r.text_time, r.text_bytes / r.text_time,
+                r.binary_bytes, r.binary_time, r.binary_bytes / r.binary_time,
+                r.peak_rss_kb, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+}
+
+// Runs the suite, and the comparisons with the previous versions of the generator with --compare
+int main(int argc, char** argv) {
+    string patchFile = "teapot.patch";
+    string jsonFile;
+    bool compare = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) jsonFile = argv[++i];
+        else if (strcmp(argv[i], "--compare") == 0) compare = true;
+        else patchFile = argv[i];
+    }
+
+    vector<BenchResult> results = benchSuite(PATCHFILESFOLDER + patchFile);
+    if (!jsonFile.empty()) writeBenchJSON(results, jsonFile);
+
+    if (compare) {
+        benchBezierEvaluation(PATCHFILESFOLDER + patchFile);
+        benchMeshWriters(1024);
+        benchPrimitiveTrig();
+        benchLargeMeshes(7072);
+    }
+
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include "kernels.h"
+
+KERNEL_CLONES
+void sphereRow(float radius, float sin_slice, float cos_slice, const float* __restrict sin_stack, const float* __restrict cos_stack, int count, float* __restrict points) {
+    for (int j = 0; j < count; j++) {
+        points[j*3]   = radius * cos_stack[j] * sin_slice;
+        points[j*3+1] = radius * sin_stack[j];
+        points[j*3+2] = radius * cos_stack[j] * cos_slice;
+    }
+}
+
+KERNEL_CLONES
+void torusPointsRow(float inner_radius, float outer_radius, float sin_slice, float cos_slice, const float* __restrict sin_stack, const float* __restrict cos_stack, int count, float* __restrict points) {
+    for (int j = 0; j < count; j++) {
+        float distance = inner_radius * sin_stack[j] + outer_radius;   // to the torus axis
+        points[j*3]   = cos_slice * distance;
+        points[j*3+1] = -cos_stack[j] * inner_radius;
+        points[j*3+2] = sin_slice * distance;
+    }
+}
+
+KERNEL_CLONES
+void torusNormalsRow(float sin_slice, float cos_slice, const float* __restrict sin_stack, const float* __restrict cos_stack, int count, float* __restrict normals) {
+    for (int j = 0; j < count; j++) {
+        normals[j*3]   = cos_slice * sin_stack[j];
+        normals[j*3+1] = -cos_stack[j];
+        normals[j*3+2] = sin_slice * sin_stack[j];
+    }
+}
+
+KERNEL_CLONES
+void ringRow(float radius, float y, const float* __restrict sins, const float* __restrict coss, int count, float* __restrict points) {
+    for (int j = 0; j < count; j++) {
+        points[j*3]   = radius * coss[j];
+        points[j*3+1] = y;
+        points[j*3+2] = radius * sins[j];
+    }
+}
+
+KERNEL_CLONES
+void lineRow(const float start[3], const float step[3], int count, float* __restrict points) {
+    float x = start[0], y = start[1], z = start[2];
+    float dx = step[0], dy = step[1], dz = step[2];
+
+    for (int j = 0; j < count; j++) {
+        points[j*3]   = x + j * dx;
+        points[j*3+1] = y + j * dy;
+        points[j*3+2] = z + j * dz;
+    }
+}
+
+KERNEL_CLONES
+void texturesRowFixedU(float u, const float* __restrict vs, int count, float* __restrict textures) {
+    for (int j = 0; j < count; j++) {
+        textures[j*2]   = u;
+        textures[j*2+1] = vs[j];
+    }
+}
+
+KERNEL_CLONES
+void texturesRowFixedV(const float* __restrict us, float v, int count, float* __restrict textures) {
+    for (int j = 0; j < count; j++) {
+        textures[j*2]   = us[j];
+        textures[j*2+1] = v;
+    }
+}
+
+KERNEL_CLONES
+void quadRowIndices(const unsigned int start[6], unsigned int stride, int count, unsigned int* __restrict indices) {
+    unsigned int s0 = start[0], s1 = start[1], s2 = start[2], s3 = start[3], s4 = start[4], s5 = start[5];
+
+    for (int j = 0; j < count; j++) {
+        unsigned int offset = j * stride;
+        indices[j*6]   = s0 + offset;
+        indices[j*6+1] = s1 + offset;
+        indices[j*6+2] = s2 + offset;
+        indices[j*6+3] = s3 + offset;
+        indices[j*6+4] = s4 + offset;
+        indices[j*6+5] = s5 + offset;
+    }
+}
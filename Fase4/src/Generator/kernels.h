@@ -0,0 +1,36 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+// Row kernels used by the primitives.
+// Each one fills a whole row of a grid from structure-of-arrays inputs (one array per component), with no
+// branches or aliasing in the loop, so the compiler vectorizes them. Outputs are interleaved like the .3d files
+// (xyz for points and normals, uv for textures, 3 indices per triangle).
+// On x86 with GCC or Clang they're also built for AVX2 and SSE4.2, the version for the running CPU is chosen
+// when the program starts, and the generic build is the fallback everywhere else
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__linux__)
+#define KERNEL_CLONES __attribute__((target_clones("avx2", "sse4.2", "default")))
+#else
+#define KERNEL_CLONES
+#endif
+
+// Points radius * (cos_stack * sin_slice, sin_stack, cos_stack * cos_slice) of one sphere slice
+void sphereRow(float radius, float sin_slice, float cos_slice, const float* sin_stack, const float* cos_stack, int count, float* points);
+
+// Points and normals of one torus slice, the normal points away from the circle at the middle of the tube
+void torusPointsRow(float inner_radius, float outer_radius, float sin_slice, float cos_slice, const float* sin_stack, const float* cos_stack, int count, float* points);
+void torusNormalsRow(float sin_slice, float cos_slice, const float* sin_stack, const float* cos_stack, int count, float* normals);
+
+// Points (radius * cos, y, radius * sin) of a horizontal circle
+void ringRow(float radius, float y, const float* sins, const float* coss, int count, float* points);
+
+// Points start + j * step of a straight line
+void lineRow(const float start[3], const float step[3], int count, float* points);
+
+// Texture coordinates with a fixed u or a fixed v
+void texturesRowFixedU(float u, const float* vs, int count, float* textures);
+void texturesRowFixedV(const float* us, float v, int count, float* textures);
+
+// Two triangles for each of count quads in a row, the i-th index of quad j being start[i] + j * stride
+void quadRowIndices(const unsigned int start[6], unsigned int stride, int count, unsigned int* indices);
+
+#endif //KERNELS_H
@@ -0,0 +1,84 @@
+#include <fstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "mapped_file.h"
+
+using namespace std;
+
+// Maps the file, falling back to reading it. Returns false if the file can't be read
+bool MappedFile::open(string fileString) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileString.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER file_size;
+        HANDLE mapping = GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0 ?
+                         CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+        const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+        if (view) {
+            this->file_handle = file;
+            this->mapping_handle = mapping;
+            this->bytes = (const char*) view;
+            this->size = (size_t) file_size.QuadPart;
+            this->mapped = true;
+            return true;
+        }
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+    }
+#else
+    int fd = ::open(fileString.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat file_stat;
+        void* view = MAP_FAILED;
+        if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0)
+            view = mmap(nullptr, (size_t) file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+
+        if (view != MAP_FAILED) {
+            madvise(view, (size_t) file_stat.st_size, MADV_SEQUENTIAL);
+            this->bytes = (const char*) view;
+            this->size = (size_t) file_stat.st_size;
+            this->mapped = true;
+            return true;
+        }
+    }
+#endif
+
+    // Empty files and files that can't be mapped are read instead
+    ifstream file(fileString, ios::in | ios::binary | ios::ate);
+    if (!file.is_open()) return false;
+
+    this->buffer.resize((size_t) file.tellg());
+    file.seekg(0);
+    file.read(this->buffer.data(), (streamsize) this->buffer.size());
+    this->bytes = this->buffer.data();
+    this->size = this->buffer.size();
+    return true;
+}
+
+void MappedFile::close() {
+    if (this->mapped) {
+#ifdef _WIN32
+        UnmapViewOfFile(this->bytes);
+        CloseHandle((HANDLE) this->mapping_handle);
+        CloseHandle((HANDLE) this->file_handle);
+#else
+        munmap((void*) this->bytes, this->size);
+#endif
+    }
+
+    this->bytes = nullptr;
+    this->size = 0;
+    this->buffer.clear();
+    this->mapped = false;
+}
@@ -0,0 +1,34 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Read-only view of a whole file, memory-mapped where the system allows it and read into memory otherwise
+class MappedFile {
+    private:
+        const char* bytes = nullptr;
+        size_t size = 0;
+        vector<char> buffer;        // contents when the file couldn't be mapped
+        bool mapped = false;
+#ifdef _WIN32
+        void* file_handle = nullptr;
+        void* mapping_handle = nullptr;
+#endif
+
+    public:
+        MappedFile() {};
+        ~MappedFile() {close();};
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool open(string fileString);
+        void close();
+        const char* begin() const {return this->bytes;};
+        const char* end() const {return this->bytes + this->size;};
+        size_t getSize() const {return this->size;};
+};
+
+#endif //MAPPED_FILE_H
@@ -0,0 +1,236 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mesh_reader.h"
+#include "strips.h"
+#include "../utils/file3d.h"
+
+using namespace std;
+
+// Copies count little-endian floats or indices from a binary .3d file
+static void copyLE(const char* data, size_t count, size_t value_size, void* out) {
+    memcpy(out, data, count * value_size);
+    if (!hostIsLittleEndian()) swapEndianness(out, count, value_size);
+}
+
+// Expands quantized points, normals and texture coordinates back to floats
+static void readQuantizedAttributes(vector<char>& data, const File3DHeader* header, Mesh* mesh) {
+    size_t count = header->vertice_count;
+
+    vector<int16_t> points(count * 4);
+    copyLE(data.data() + header->points_offset, count * 4, sizeof(int16_t), points.data());
+    mesh->points.resize(count * 3);
+    for (size_t v = 0; v < count; v++) {
+        for (int i = 0; i < 3; i++)
+            mesh->points[v * 3 + i] = header->quantization_centre[i] + points[v * 4 + i] * header->quantization_scale;
+    }
+
+    if (header->flags & FILE3D_HAS_NORMALS) {
+        const int8_t* normals = (const int8_t*) (data.data() + header->normals_offset);
+        mesh->normals.resize(count * 3);
+        for (size_t v = 0; v < count; v++) {
+            for (int i = 0; i < 3; i++)
+                mesh->normals[v * 3 + i] = (float) normals[v * 4 + i] / FILE3D_MAX_QUANTIZED_NORMAL;
+        }
+    }
+
+    if (header->flags & FILE3D_HAS_TEXTURES) {
+        vector<uint16_t> textures(count * 2);
+        copyLE(data.data() + header->textures_offset, count * 2, sizeof(uint16_t), textures.data());
+        mesh->textures.resize(count * 2);
+        for (size_t i = 0; i < count * 2; i++) mesh->textures[i] = halfToFloat(textures[i]);
+    }
+}
+
+static bool readBinaryMesh(vector<char>& data, Mesh* mesh) {
+    File3DHeader header;
+    if (!decodeFile3DHeader(data.data(), data.size(), &header)) return false;
+
+    size_t count = header.vertice_count;
+    if (header.flags & FILE3D_QUANTIZED) {
+        readQuantizedAttributes(data, &header, mesh);
+    }
+    else {
+        mesh->points.resize(count * 3);
+        copyLE(data.data() + header.points_offset, count * 3, sizeof(float), mesh->points.data());
+        if (header.flags & FILE3D_HAS_NORMALS) {
+            mesh->normals.resize(count * 3);
+            copyLE(data.data() + header.normals_offset, count * 3, sizeof(float), mesh->normals.data());
+        }
+        if (header.flags & FILE3D_HAS_TEXTURES) {
+            mesh->textures.resize(count * 2);
+            copyLE(data.data() + header.textures_offset, count * 2, sizeof(float), mesh->textures.data());
+        }
+    }
+
+    if (header.index_size == sizeof(uint16_t)) {
+        vector<uint16_t> short_indices(header.index_count);
+        copyLE(data.data() + header.indices_offset, header.index_count, sizeof(uint16_t), short_indices.data());
+        mesh->indices.assign(short_indices.begin(), short_indices.end());
+    }
+    else {
+        mesh->indices.resize(header.index_count);
+        copyLE(data.data() + header.indices_offset, header.index_count, sizeof(uint32_t), mesh->indices.data());
+    }
+
+    // Restart indices are the largest of their size, 0xFFFF for 16-bit indices
+    if (header.flags & FILE3D_TRIANGLE_STRIPS && header.index_size == sizeof(uint16_t)) {
+        for (unsigned int& index : mesh->indices) {
+            if (index == 0xFFFF) index = MESH_RESTART_INDEX;
+        }
+    }
+
+    if (header.lod_count > 0) {
+        vector<File3DLOD> lods(header.lod_count);
+        if (!decodeFile3DLODs(data.data(), &header, lods.data())) return false;
+
+        for (File3DLOD& lod : lods) {
+            MeshLOD mesh_lod;
+            mesh_lod.first_index = lod.first_index;
+            mesh_lod.index_count = lod.index_count;
+            mesh_lod.first_vertex = lod.first_vertex;
+            mesh_lod.vertice_count = lod.vertice_count;
+            mesh_lod.error = lod.error;
+            mesh->lods.push_back(mesh_lod);
+        }
+    }
+
+    // Strips are read back as triangles, each level of detail on its own
+    if (header.flags & FILE3D_TRIANGLE_STRIPS) {
+        vector<MeshLOD> lods = mesh->lods;
+        if (lods.empty()) {
+            MeshLOD whole;
+            whole.index_count = (unsigned int) mesh->indices.size();
+            lods.push_back(whole);
+        }
+
+        vector<unsigned int> triangles;
+        for (MeshLOD& lod : lods) {
+            if ((size_t) lod.first_index + lod.index_count > mesh->indices.size()) return false;
+            unsigned int first_index = (unsigned int) triangles.size();
+            stripsToTriangles(&mesh->indices[lod.first_index], lod.index_count, MESH_RESTART_INDEX, &triangles);
+            lod.first_index = first_index;
+            lod.index_count = (unsigned int) triangles.size() - first_index;
+        }
+        if (!mesh->lods.empty()) mesh->lods = lods;
+        mesh->indices.swap(triangles);
+    }
+
+    return true;
+}
+
+// Reads count lines of values separated by commas
+static bool readValues(istream& file, size_t count, vector<float>& values) {
+    string line;
+    values.reserve(values.size() + count);
+
+    while (values.size() < count && getline(file, line)) {
+        const char* text = line.c_str();
+        char* end;
+        for (float value = strtof(text, &end); end != text; value = strtof(text, &end)) {
+            values.push_back(value);
+            text = end;
+            while (*text == ',' || *text == ' ') text++;
+        }
+    }
+
+    return values.size() == count;
+}
+
+// Reads count indices, three per line
+static bool readIndices(istream& file, size_t count, vector<unsigned int>& indices) {
+    string line;
+    indices.reserve(indices.size() + count);
+
+    while (indices.size() < count && getline(file, line)) {
+        const char* text = line.c_str();
+        char* end;
+        for (unsigned long index = strtoul(text, &end, 10); end != text; index = strtoul(text, &end, 10)) {
+            indices.push_back((unsigned int) index);
+            text = end;
+            while (*text == ',' || *text == ' ') text++;
+        }
+    }
+
+    return indices.size() == count;
+}
+
+static bool readTextMesh(istream& file, Mesh* mesh) {
+    string line;
+
+    // Number of points, number of indices and number of levels of detail, the last two are optional
+    unsigned int nr_points = 0, nr_indices = 0, nr_lods = 0;
+    if (!getline(file, line)) return false;
+    istringstream countsStream(line);
+    if (!(countsStream >> nr_points)) return false;
+    countsStream >> nr_indices >> nr_lods;
+
+    getline(file, line);
+    bool b_normals = line == "true";
+    getline(file, line);
+    bool b_textures = line == "true";
+
+    for (unsigned int i = 0; i < nr_lods; i++) {
+        MeshLOD lod;
+        char comma;
+        if (!getline(file, line)) return false;
+        istringstream lodStream(line);
+        lodStream >> lod.first_index >> comma >> lod.index_count >> comma >> lod.first_vertex >> comma
+                  >> lod.vertice_count >> comma >> lod.error;
+        if (lod.index_count == 0 || lod.vertice_count == 0 || lod.first_index + lod.index_count > nr_indices ||
+            lod.first_vertex + lod.vertice_count > nr_points)
+            return false;
+        mesh->lods.push_back(lod);
+    }
+
+    if (!readValues(file, (size_t) nr_points * 3, mesh->points)) return false;
+    if (b_normals && !readValues(file, (size_t) nr_points * 3, mesh->normals)) return false;
+    if (b_textures && !readValues(file, (size_t) nr_points * 2, mesh->textures)) return false;
+
+    return readIndices(file, nr_indices, mesh->indices);
+}
+
+bool readMeshFile(string fileString, Mesh* mesh) {
+    ifstream file(fileString, ios::in | ios::binary);
+    if (!file.is_open()) {
+        std::cout << "Unable to open file: " << fileString.c_str() << "\n";
+        return false;
+    }
+
+    file.seekg(0, ios::end);
+    vector<char> data((size_t) file.tellg());
+    file.seekg(0, ios::beg);
+    file.read(data.data(), data.size());
+    file.close();
+
+    bool valid;
+    if (isBinary3dFile(data.data(), data.size())) {
+        valid = readBinaryMesh(data, mesh);
+    }
+    else {
+        istringstream text(string(data.begin(), data.end()));
+        valid = readTextMesh(text, mesh);
+    }
+
+    // Every index must refer to an existing vertex
+    for (size_t i = 0; valid && i < mesh->indices.size(); i++) {
+        if (mesh->indices[i] >= mesh->getVerticeCount()) valid = false;
+    }
+
+    if (!valid) {
+        std::cout << "Invalid .3d file: " << fileString.c_str() << "\n";
+        return false;
+    }
+
+    // Independent triangles
+    if (mesh->indices.empty()) {
+        mesh->indices.resize(mesh->getVerticeCount());
+        for (unsigned int i = 0; i < mesh->getVerticeCount(); i++) mesh->indices[i] = i;
+    }
+
+    return true;
+}
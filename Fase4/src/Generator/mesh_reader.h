@@ -0,0 +1,14 @@
+#ifndef MESH_READER_H
+#define MESH_READER_H
+
+#include <string>
+
+#include "../utils/mesh.h"
+
+using namespace std;
+
+// Reads a text or binary .3d file into a mesh, levels of detail included.
+// Files without indices (independent triangles) get one index per vertex
+bool readMeshFile(string fileString, Mesh* mesh);
+
+#endif //MESH_READER_H
@@ -0,0 +1,461 @@
+#include <iostream>
+#include <charconv>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+
+#include "mesh_writer.h"
+#include "mapped_file.h"
+#include "meshlets.h"
+
+using namespace std;
+
+bool MeshFileWriter::open(bool binary) {
+    this->used = 0;
+
+    // The old file may be linked from the asset cache, so it's replaced instead of written over
+    remove(this->fileString.c_str());
+    this->file.open(this->fileString, binary ? ios::out | ios::trunc | ios::binary : ios::out | ios::trunc);
+
+    if (!this->file.is_open()) {
+        std::cout << "Unable to open file: " << this->fileString.c_str() << "\n";
+        this->failed = true;
+        return false;
+    }
+    return true;
+}
+
+void MeshFileWriter::flush() {
+    if (this->used > 0 && this->file.is_open()) this->file.write(this->buffer, this->used);
+    this->used = 0;
+}
+
+void MeshFileWriter::put(const char* data, size_t size) {
+    if (this->used + size > sizeof(this->buffer)) {
+        flush();
+        if (size > sizeof(this->buffer)) {
+            if (this->file.is_open()) this->file.write(data, size);
+            return;
+        }
+    }
+
+    memcpy(this->buffer + this->used, data, size);
+    this->used += size;
+}
+
+void MeshFileWriter::end() {
+    flush();
+    if (!this->file.is_open()) return;
+
+    if (!this->file.good()) {
+        std::cout << "Unable to write file: " << this->fileString.c_str() << "\n";
+        this->failed = true;
+    }
+    this->file.close();
+}
+
+
+void TextMeshWriter::begin(unsigned int vertice_count, unsigned int index_count, bool normals, bool textures) {
+    this->vertice_count = vertice_count;
+    this->index_count = index_count;
+    this->column = 0;
+    open(false);
+
+    // Number of points followed by the number of indices and, if there's more than one, the number
+    // of levels of detail. Then true or false indicating if there's normals and texture coordinates
+    // associated with the points
+    string header = to_string(vertice_count) + " " + to_string(index_count);
+    if (!this->lods.empty()) header += " " + to_string(this->lods.size());
+    header += "\n";
+    header += normals ? "true\n" : "false\n";
+    header += textures ? "true\n" : "false\n";
+
+    // Each level of detail in a line: first index, index count, first vertex, vertex count and error
+    char error[32];
+    for (MeshLOD& lod : this->lods) {
+        char* error_end = to_chars(error, error + sizeof(error), lod.error).ptr;
+        header += to_string(lod.first_index) + ", " + to_string(lod.index_count) + ", " +
+                  to_string(lod.first_vertex) + ", " + to_string(lod.vertice_count) + ", " + string(error, error_end) + "\n";
+    }
+
+    put(header.data(), header.size());
+}
+
+// Ends the current value, with a new line after the last value of a vertex or triangle
+void TextMeshWriter::putLine(int values_per_line) {
+    if (++this->column == values_per_line) {
+        put("\n", 1);
+        this->column = 0;
+    }
+    else {
+        put(", ", 2);
+    }
+}
+
+void TextMeshWriter::putFloats(const float* values, size_t count, int values_per_line) {
+    char text[32];
+
+    for (size_t i = 0; i < count; i++) {
+        char* text_end = to_chars(text, text + sizeof(text), values[i]).ptr;
+        put(text, text_end - text);
+        putLine(values_per_line);
+    }
+}
+
+void TextMeshWriter::indices(const unsigned int* values, size_t count) {
+    char text[16];
+
+    for (size_t i = 0; i < count; i++) {
+        char* text_end = to_chars(text, text + sizeof(text), values[i]).ptr;
+        put(text, text_end - text);
+        putLine(3);
+    }
+}
+
+
+void BinaryMeshWriter::begin(unsigned int vertice_count, unsigned int index_count, bool normals, bool textures) {
+    this->vertice_count = vertice_count;
+    this->index_count = index_count;
+    open(true);
+
+    this->column = 0;
+    this->strip_length = 0;
+    this->strip_triangles = 0;
+    this->pending_points.clear();
+    planRegions();
+
+    // Arrays are written right after the header, the levels of detail, the regions and the clusters, in the order
+    // points, normals, textures, indices
+    File3DHeader& header = this->header;
+    header = {};
+    header.version = FILE3D_VERSION;
+    header.header_size = sizeof(File3DHeader);
+    header.flags = (normals ? FILE3D_HAS_NORMALS : 0) | (textures ? FILE3D_HAS_TEXTURES : 0) |
+                   (this->quantize ? FILE3D_QUANTIZED : 0) | (this->strips ? FILE3D_TRIANGLE_STRIPS : 0) | FILE3D_HAS_BOUNDS;
+    header.vertice_count = vertice_count;
+    header.lod_count = (uint32_t) this->lods.size();
+    header.lods_offset = header.lod_count ? FILE3D_HEADER_SIZE : 0;
+    uint32_t regions_offset = FILE3D_HEADER_SIZE + header.lod_count * FILE3D_LOD_SIZE;
+    header.region_count = (uint32_t) this->regions.size();
+    header.regions_offset = header.region_count ? regions_offset : 0;
+    uint32_t clusters_offset = regions_offset + header.region_count * FILE3D_REGION_SIZE;
+    header.cluster_count = (uint32_t) this->clusters.size();
+    header.clusters_offset = header.cluster_count ? clusters_offset : 0;
+    uint64_t offset = clusters_offset + header.cluster_count * FILE3D_CLUSTER_SIZE;
+    header.points_offset = (uint32_t) offset;
+    offset += (uint64_t) vertice_count * FILE3D_POINT_SIZE(header.flags);
+    header.normals_offset = normals ? (uint32_t) offset : 0;
+    if (normals) offset += (uint64_t) vertice_count * FILE3D_NORMAL_SIZE(header.flags);
+    header.textures_offset = textures ? (uint32_t) offset : 0;
+    if (textures) offset += (uint64_t) vertice_count * FILE3D_TEXTURE_SIZE(header.flags);
+    header.quantization_scale = 1.0f;
+    header.index_count = index_count;
+    header.index_size = vertice_count <= FILE3D_MAX_SHORT_INDEX + 1 ? sizeof(uint16_t) : sizeof(uint32_t);
+    header.indices_offset = header.index_count ? (uint32_t) offset : 0;
+
+    // The offsets can't point past 4 GiB, so larger meshes aren't written instead of being written with broken offsets
+    if (offset + (uint64_t) index_count * header.index_size > FILE3D_MAX_FILE_SIZE) {
+        std::cout << "Mesh too large for a binary .3d file (over 4 GiB): " << this->fileString.c_str() << "\n";
+        this->failed = true;
+        this->file.close();
+        remove(this->fileString.c_str());
+        return;
+    }
+
+    this->short_indices = header.index_size == sizeof(uint16_t);
+
+    char header_bytes[FILE3D_HEADER_SIZE];
+    encodeFile3DHeader(&header, header_bytes);
+    put(header_bytes, FILE3D_HEADER_SIZE);
+
+    for (MeshLOD& lod : this->lods) {
+        File3DLOD file_lod = {lod.first_index, lod.index_count, lod.first_vertex, lod.vertice_count, lod.error};
+        char lod_bytes[FILE3D_LOD_SIZE];
+        encodeFile3DLOD(&file_lod, lod_bytes);
+        put(lod_bytes, FILE3D_LOD_SIZE);
+    }
+
+    // Regions are only known once the points are written, so they're written again at the end
+    for (File3DRegion& region : this->regions) {
+        char region_bytes[FILE3D_REGION_SIZE];
+        encodeFile3DRegion(&region, region_bytes);
+        put(region_bytes, FILE3D_REGION_SIZE);
+    }
+
+    for (MeshCluster& cluster : this->clusters) {
+        char cluster_bytes[FILE3D_CLUSTER_SIZE];
+        encodeCluster(cluster, cluster_bytes);
+        put(cluster_bytes, FILE3D_CLUSTER_SIZE);
+    }
+}
+
+void BinaryMeshWriter::encodeCluster(const MeshCluster& cluster, char* out) {
+    File3DCluster file_cluster = {cluster.first_index, cluster.index_count,
+                                  {cluster.centre[0], cluster.centre[1], cluster.centre[2]}, cluster.radius,
+                                  {cluster.cone_axis[0], cluster.cone_axis[1], cluster.cone_axis[2]}, cluster.cone_cutoff};
+    encodeFile3DCluster(&file_cluster, out);
+}
+
+// Splits each level of detail (or the whole mesh) of large meshes into regions of REGION_TRIANGLES triangles,
+// unless the mesh is already split into clusters
+void BinaryMeshWriter::planRegions() {
+    this->regions.clear();
+    if (this->index_count / 3 <= REGION_THRESHOLD || !this->clusters.empty() || this->strips) return;
+
+    vector<pair<unsigned int, unsigned int>> ranges;
+    for (MeshLOD& lod : this->lods) ranges.push_back(make_pair(lod.first_index, lod.index_count));
+    if (ranges.empty()) ranges.push_back(make_pair(0u, this->index_count));
+
+    for (auto& range : ranges) {
+        for (unsigned int first = 0; first < range.second; first += REGION_TRIANGLES * 3) {
+            File3DRegion region = {};
+            region.first_index = range.first + first;
+            region.index_count = range.second - first < REGION_TRIANGLES * 3 ? range.second - first : REGION_TRIANGLES * 3;
+            this->regions.push_back(region);
+        }
+    }
+}
+
+// Writes values in little-endian order, swapping them inside the buffer on big-endian hosts
+void BinaryMeshWriter::putLE(const void* values, size_t count, size_t value_size) {
+    if (hostIsLittleEndian()) {
+        put((const char*) values, count * value_size);
+        return;
+    }
+
+    const char* bytes = (const char*) values;
+    for (size_t i = 0; i < count; i++) {
+        if (this->used + value_size > sizeof(this->buffer)) flush();
+
+        char* out = this->buffer + this->used;
+        for (size_t b = 0; b < value_size; b++) out[b] = bytes[i * value_size + value_size - 1 - b];
+        this->used += value_size;
+    }
+}
+
+void BinaryMeshWriter::points(const float* values, size_t count) {
+    if (!this->file.is_open()) return;
+    if (this->quantize) this->pending_points.insert(this->pending_points.end(), values, values + count);
+    else putLE(values, count, sizeof(float));
+}
+
+// Points are quantized relative to the centre of their bounding box, with the same scale in every axis
+// so normals keep their direction
+void BinaryMeshWriter::putQuantizedPoints() {
+    float min[3] = {0.0f, 0.0f, 0.0f}, max[3] = {0.0f, 0.0f, 0.0f};
+    for (size_t i = 0; i < this->pending_points.size(); i++) {
+        float value = this->pending_points[i];
+        if (i < 3 || value < min[i % 3]) min[i % 3] = value;
+        if (i < 3 || value > max[i % 3]) max[i % 3] = value;
+    }
+
+    float extent = 0.0f;
+    for (int i = 0; i < 3; i++) {
+        this->header.quantization_centre[i] = (min[i] + max[i]) * 0.5f;
+        if ((max[i] - min[i]) * 0.5f > extent) extent = (max[i] - min[i]) * 0.5f;
+    }
+    float scale = extent > 0.0f ? extent / FILE3D_MAX_QUANTIZED_POINT : 1.0f;
+    this->header.quantization_scale = scale;
+
+    int16_t block[1024];
+    for (size_t i = 0; i < this->pending_points.size(); i += 768) {
+        size_t block_count = 0;
+        for (size_t j = i; j < i + 768 && j < this->pending_points.size(); j += 3) {
+            for (int k = 0; k < 3; k++) {
+                float q = roundf((this->pending_points[j + k] - this->header.quantization_centre[k]) / scale);
+                block[block_count++] = (int16_t) (q > FILE3D_MAX_QUANTIZED_POINT ? FILE3D_MAX_QUANTIZED_POINT :
+                                                  q < -FILE3D_MAX_QUANTIZED_POINT ? -FILE3D_MAX_QUANTIZED_POINT : q);
+            }
+            block[block_count++] = 0;
+        }
+        putLE(block, block_count, sizeof(int16_t));
+    }
+
+    this->pending_points.clear();
+    this->pending_points.shrink_to_fit();
+}
+
+// Each normal component as a signed byte, the fourth byte keeps the normals aligned
+void BinaryMeshWriter::putQuantizedNormals(const float* values, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        float q = roundf(values[i] * FILE3D_MAX_QUANTIZED_NORMAL);
+        char byte = (char) (int8_t) (q > FILE3D_MAX_QUANTIZED_NORMAL ? FILE3D_MAX_QUANTIZED_NORMAL :
+                                     q < -FILE3D_MAX_QUANTIZED_NORMAL ? -FILE3D_MAX_QUANTIZED_NORMAL : q);
+        put(&byte, 1);
+        if (++this->column == 3) {
+            put("", 1);
+            this->column = 0;
+        }
+    }
+}
+
+void BinaryMeshWriter::putHalfs(const float* values, size_t count) {
+    uint16_t block[1024];
+    for (size_t i = 0; i < count; i += 1024) {
+        size_t block_count = count - i < 1024 ? count - i : 1024;
+        for (size_t j = 0; j < block_count; j++) block[j] = floatToHalf(values[i + j]);
+        putLE(block, block_count, sizeof(uint16_t));
+    }
+}
+
+void BinaryMeshWriter::normals(const float* values, size_t count) {
+    if (!this->quantize) {
+        putLE(values, count, sizeof(float));
+        return;
+    }
+    if (!this->pending_points.empty()) putQuantizedPoints();
+    putQuantizedNormals(values, count);
+}
+
+void BinaryMeshWriter::textures(const float* values, size_t count) {
+    if (!this->quantize) {
+        putLE(values, count, sizeof(float));
+        return;
+    }
+    if (!this->pending_points.empty()) putQuantizedPoints();
+    putHalfs(values, count);
+}
+
+// Indices are written with 16 bits if every vertex fits, converted a block at a time
+void BinaryMeshWriter::indices(const unsigned int* values, size_t count) {
+    if (!this->pending_points.empty()) putQuantizedPoints();
+
+    // Each strip index after the first two adds a triangle
+    for (size_t i = 0; this->strips && i < count; i++) {
+        if (values[i] == MESH_RESTART_INDEX) this->strip_length = 0;
+        else if (++this->strip_length >= 3) this->strip_triangles++;
+    }
+
+    if (!this->short_indices) {
+        putLE(values, count, sizeof(uint32_t));
+        return;
+    }
+
+    uint16_t block[1024];
+    for (size_t i = 0; i < count; i += 1024) {
+        size_t block_count = count - i < 1024 ? count - i : 1024;
+        for (size_t j = 0; j < block_count; j++) block[j] = (uint16_t) values[i + j];    // restart indices become 0xFFFF
+        putLE(block, block_count, sizeof(uint16_t));
+    }
+}
+
+
+// Points of a written binary file, read in place and dequantized if they're quantized
+class FilePoints : public PointSource {
+    private:
+        const char* data;
+        const File3DHeader* header;
+    public:
+        FilePoints(const char* data, const File3DHeader* header) {
+            this->data = data + header->points_offset;
+            this->header = header;
+        };
+        size_t getCount() const {return this->header->vertice_count;};
+        void get(size_t i, float p[3]) const {
+            if (this->header->flags & FILE3D_QUANTIZED) {
+                const unsigned char* in = (const unsigned char*) this->data + i * FILE3D_POINT_SIZE(this->header->flags);
+                for (int c = 0; c < 3; c++) {
+                    int16_t q = (int16_t) (in[c * 2] | in[c * 2 + 1] << 8);
+                    p[c] = this->header->quantization_centre[c] + q * this->header->quantization_scale;
+                }
+            }
+            else {
+                const char* in = this->data + i * FILE3D_POINT_SIZE(this->header->flags);
+                for (int c = 0; c < 3; c++) {
+                    uint32_t bits = (uint32_t) (unsigned char) in[c * 4] | (uint32_t) (unsigned char) in[c * 4 + 1] << 8 |
+                                    (uint32_t) (unsigned char) in[c * 4 + 2] << 16 | (uint32_t) (unsigned char) in[c * 4 + 3] << 24;
+                    memcpy(&p[c], &bits, sizeof(float));
+                }
+            }
+        };
+};
+
+// Reads the file back to compute the bounding box and sphere of its points and the boxes of its regions.
+// Quantized points moved a little, so the spheres and cones of the clusters are computed again from them
+void BinaryMeshWriter::putBounds() {
+    MappedFile mapped;
+    if (!mapped.open(this->fileString) || mapped.getSize() < this->header.indices_offset + (uint64_t) this->index_count * this->header.index_size)
+        return;
+
+    FilePoints points(mapped.begin(), &this->header);
+    Bounds bounds = computeBounds(points);
+    for (int c = 0; c < 3; c++) {
+        this->header.bounds_min[c] = bounds.min[c];
+        this->header.bounds_max[c] = bounds.max[c];
+        this->header.sphere_centre[c] = bounds.centre[c];
+    }
+    this->header.sphere_radius = bounds.radius;
+
+    const unsigned char* indices = (const unsigned char*) mapped.begin() + this->header.indices_offset;
+    auto indexAt = [&](uint32_t i) {
+        const unsigned char* in = indices + (size_t) i * this->header.index_size;
+        return this->short_indices ? (uint32_t) (in[0] | in[1] << 8) :
+               (uint32_t) in[0] | (uint32_t) in[1] << 8 | (uint32_t) in[2] << 16 | (uint32_t) in[3] << 24;
+    };
+
+    for (File3DRegion& region : this->regions) {
+        for (uint32_t i = region.first_index; i < region.first_index + region.index_count; i++) {
+            uint32_t index = indexAt(i);
+            if (index >= this->vertice_count) continue;
+
+            float p[3];
+            points.get(index, p);
+            for (int c = 0; c < 3; c++) {
+                if (i == region.first_index || p[c] < region.min[c]) region.min[c] = p[c];
+                if (i == region.first_index || p[c] > region.max[c]) region.max[c] = p[c];
+            }
+        }
+    }
+
+    if (!this->quantize) return;
+    vector<unsigned int> cluster_indices;
+    for (MeshCluster& cluster : this->clusters) {
+        cluster_indices.clear();
+        for (uint32_t i = cluster.first_index; i < cluster.first_index + cluster.index_count; i++) {
+            uint32_t index = indexAt(i);
+            cluster_indices.push_back(index < this->vertice_count ? index : 0);
+        }
+        clusterBounds(points, cluster_indices.data(), cluster.index_count, &cluster);
+    }
+}
+
+// Writes the header again, now with the quantization and bounds of the points, the regions and the clusters
+void BinaryMeshWriter::end() {
+    if (!this->pending_points.empty()) putQuantizedPoints();
+    flush();
+
+    if (this->file.is_open()) {
+        this->file.flush();
+        putBounds();
+
+        char header_bytes[FILE3D_HEADER_SIZE];
+        encodeFile3DHeader(&this->header, header_bytes);
+        this->file.seekp(0);
+        this->file.write(header_bytes, FILE3D_HEADER_SIZE);
+
+        if (!this->regions.empty()) {
+            this->file.seekp(this->header.regions_offset);
+            for (File3DRegion& region : this->regions) {
+                char region_bytes[FILE3D_REGION_SIZE];
+                encodeFile3DRegion(&region, region_bytes);
+                this->file.write(region_bytes, FILE3D_REGION_SIZE);
+            }
+        }
+        if (!this->clusters.empty()) {
+            this->file.seekp(this->header.clusters_offset);
+            for (MeshCluster& cluster : this->clusters) {
+                char cluster_bytes[FILE3D_CLUSTER_SIZE];
+                encodeCluster(cluster, cluster_bytes);
+                this->file.write(cluster_bytes, FILE3D_CLUSTER_SIZE);
+            }
+        }
+    }
+
+    MeshFileWriter::end();
+}
+
+
+unique_ptr<MeshFileWriter> openMeshWriter(string fileString, bool binary, bool quantize) {
+    if (binary || quantize) return unique_ptr<MeshFileWriter>(new BinaryMeshWriter(fileString, quantize));
+    return unique_ptr<MeshFileWriter>(new TextMeshWriter(fileString));
+}
@@ -0,0 +1,105 @@
+#ifndef MESH_WRITER_H
+#define MESH_WRITER_H
+
+#include <string>
+#include <memory>
+#include <fstream>
+#include <vector>
+
+#include "../utils/mesh.h"
+#include "../utils/file3d.h"
+
+using namespace std;
+
+// Meshes with more triangles than this get the bounding boxes of regions of REGION_TRIANGLES triangles,
+// so the engine can skip the parts of large models that are out of view
+#define REGION_THRESHOLD 16384
+#define REGION_TRIANGLES 4096
+
+// Sink that writes a .3d file as the mesh is received, through a fixed size buffer.
+// The file is only created when the mesh begins, so nothing is written for a mesh never generated
+class MeshFileWriter : public MeshSink {
+    protected:
+        string fileString;
+        ofstream file;
+        char buffer[1 << 16];
+        size_t used = 0;
+        bool failed = false;
+        unsigned int vertice_count = 0;
+        unsigned int index_count = 0;
+        vector<MeshLOD> lods;
+        bool strips = false;
+        unsigned int strip_triangles = 0;
+
+        bool open(bool binary);
+        void put(const char* data, size_t size);
+        void flush();
+    public:
+        MeshFileWriter(string fileString) {this->fileString = fileString;};
+        virtual ~MeshFileWriter() {};
+
+        unsigned int getVerticeCount() {return this->vertice_count;};
+        unsigned int getTriangleCount() {return this->strips ? this->strip_triangles : this->index_count / 3;};
+        bool hasFailed() {return this->failed;};
+        void setLODs(const vector<MeshLOD>& lods) {this->lods = lods;};
+        void end();
+};
+
+// Text .3d file: values of each section separated by ", ", one vertex or triangle per line,
+// floats written in their shortest form that reads back to the same value
+class TextMeshWriter : public MeshFileWriter {
+    private:
+        int column = 0;
+
+        void putLine(int values_per_line);
+        void putFloats(const float* values, size_t count, int values_per_line);
+    public:
+        TextMeshWriter(string fileString) : MeshFileWriter(fileString) {};
+
+        void begin(unsigned int vertice_count, unsigned int index_count, bool normals, bool textures);
+        void points(const float* values, size_t count) {putFloats(values, count, 3);};
+        void normals(const float* values, size_t count) {putFloats(values, count, 3);};
+        void textures(const float* values, size_t count) {putFloats(values, count, 2);};
+        void indices(const unsigned int* values, size_t count);
+};
+
+// Binary .3d file: the header is known from the sizes given by begin(), the arrays follow it in little-endian.
+// Quantized files need the bounds of the points, so points are kept until they're all received, and the
+// header is written again at the end with the quantization.
+// The bounds of the mesh and its regions are computed from the file once it's written, and stored in its header.
+// Meshes split into clusters have them instead of regions, and meshes made of triangle strips have neither
+class BinaryMeshWriter : public MeshFileWriter {
+    private:
+        File3DHeader header;
+        vector<File3DRegion> regions;
+        vector<MeshCluster> clusters;
+        bool short_indices = false;
+        unsigned int strip_length = 0;
+        bool quantize = false;
+        vector<float> pending_points;
+        int column = 0;
+
+        void putLE(const void* values, size_t count, size_t value_size);
+        void putQuantizedPoints();
+        void putQuantizedNormals(const float* values, size_t count);
+        void putHalfs(const float* values, size_t count);
+        void planRegions();
+        void encodeCluster(const MeshCluster& cluster, char* out);
+        void putBounds();
+    public:
+        BinaryMeshWriter(string fileString, bool quantize = false) : MeshFileWriter(fileString) {this->quantize = quantize;};
+
+        void setClusters(const vector<MeshCluster>& clusters) {this->clusters = clusters;};
+        void setStrips() {this->strips = true;};
+
+        void begin(unsigned int vertice_count, unsigned int index_count, bool normals, bool textures);
+        void points(const float* values, size_t count);
+        void normals(const float* values, size_t count);
+        void textures(const float* values, size_t count);
+        void indices(const unsigned int* values, size_t count);
+        void end();
+};
+
+unique_ptr<MeshFileWriter> openMeshWriter(string fileString, bool binary, bool quantize = false);
+
+#endif //MESH_WRITER_H
@@ -0,0 +1,187 @@
+#include <vector>
+#include <algorithm>
+#include <math.h>
+
+#include "meshlets.h"
+
+using namespace std;
+
+// Triangles using each vertex of a range of indices, in one array
+class VertexTriangles {
+    public:
+        vector<unsigned int> offsets;   // triangles of vertex v are triangles[offsets[v]] to triangles[offsets[v + 1]]
+        vector<unsigned int> triangles;
+
+        VertexTriangles(const unsigned int* indices, size_t triangle_count, unsigned int vertice_count) : offsets(vertice_count + 1, 0) {
+            for (size_t i = 0; i < triangle_count * 3; i++) this->offsets[indices[i] + 1]++;
+            for (unsigned int v = 0; v < vertice_count; v++) this->offsets[v + 1] += this->offsets[v];
+
+            vector<unsigned int> filled(this->offsets.begin(), this->offsets.end() - 1);
+            this->triangles.resize(triangle_count * 3);
+            for (size_t i = 0; i < triangle_count * 3; i++) this->triangles[filled[indices[i]]++] = (unsigned int) (i / 3);
+        };
+};
+
+// Bounding sphere of the vertices of a cluster and the cone around the normals of its triangles
+void clusterBounds(const PointSource& points, const unsigned int* indices, unsigned int index_count, MeshCluster* cluster) {
+    vector<unsigned int> vertices(indices, indices + index_count);
+    sort(vertices.begin(), vertices.end());
+    vertices.erase(unique(vertices.begin(), vertices.end()), vertices.end());
+
+    vector<float> cluster_points(vertices.size() * 3);
+    for (size_t i = 0; i < vertices.size(); i++) points.get(vertices[i], &cluster_points[i * 3]);
+    float radius;
+    boundingSphere(FloatPoints(cluster_points.data(), vertices.size()), cluster->centre, &radius);
+    cluster->radius = radius;
+
+    // The axis is the average of the unit normals, the cone as wide as the normal furthest from it
+    vector<float> normals;
+    float axis[3] = {0.0f, 0.0f, 0.0f};
+    for (unsigned int i = 0; i < index_count; i += 3) {
+        float a[3], b[3], c[3];
+        points.get(indices[i], a);
+        points.get(indices[i + 1], b);
+        points.get(indices[i + 2], c);
+        float u[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+        float w[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        float n[3] = {u[1] * w[2] - u[2] * w[1], u[2] * w[0] - u[0] * w[2], u[0] * w[1] - u[1] * w[0]};
+        float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length == 0.0f) continue;
+
+        for (int k = 0; k < 3; k++) {
+            normals.push_back(n[k] / length);
+            axis[k] += n[k] / length;
+        }
+    }
+
+    float length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    cluster->cone_cutoff = 1.0f;
+    if (length < 1e-6f) return;
+    for (int k = 0; k < 3; k++) cluster->cone_axis[k] = axis[k] / length;
+
+    float min_dot = 1.0f;
+    for (size_t i = 0; i < normals.size(); i += 3) {
+        float dot = normals[i] * cluster->cone_axis[0] + normals[i + 1] * cluster->cone_axis[1] + normals[i + 2] * cluster->cone_axis[2];
+        if (dot < min_dot) min_dot = dot;
+    }
+
+    // Normals within angle a of the axis all face away from directions within 90 - a degrees of it,
+    // whose cosine is sin(a). Cones of 90 degrees or more never face away
+    if (min_dot > 0.0f) cluster->cone_cutoff = sqrtf(1.0f - min_dot * min_dot);
+}
+
+// Grows clusters of a range of indices one triangle at a time. Each cluster starts from the first triangle left
+// and takes the neighbouring triangle adding the fewest new vertices, then the one closest to its centre,
+// until it's out of vertices, triangles or neighbours
+static void buildRangeMeshlets(Mesh* mesh, unsigned int first_index, unsigned int index_count, unsigned int max_vertices,
+                               unsigned int max_triangles, MeshletStats* stats) {
+    unsigned int* indices = mesh->indices.data() + first_index;
+    size_t triangle_count = index_count / 3;
+    unsigned int vertice_count = mesh->getVerticeCount();
+    const float* points = mesh->points.data();
+    VertexTriangles vertex_triangles(indices, triangle_count, vertice_count);
+
+    vector<unsigned int> ordered;
+    ordered.reserve(index_count);
+    vector<bool> emitted(triangle_count, false);
+    vector<unsigned int> candidate_of(triangle_count, 0);   // cluster number + 1 of the last cluster it was a candidate of
+    vector<unsigned int> in_cluster(vertice_count, 0);      // cluster number + 1 of the last cluster it was in
+    size_t next_seed = 0;
+
+    for (unsigned int cluster_number = 1; ordered.size() < triangle_count * 3; cluster_number++) {
+        while (emitted[next_seed]) next_seed++;
+
+        MeshCluster cluster;
+        cluster.first_index = first_index + (unsigned int) ordered.size();
+        vector<unsigned int> vertices, candidates;
+        float centroid[3] = {0.0f, 0.0f, 0.0f};
+        unsigned int cluster_triangles = 0;
+        size_t best = next_seed;
+
+        while (true) {
+            // Take the triangle, its new vertices and the triangles around them
+            emitted[best] = true;
+            cluster_triangles++;
+            for (int k = 0; k < 3; k++) {
+                unsigned int v = indices[best * 3 + k];
+                ordered.push_back(v);
+                for (int c = 0; c < 3; c++) centroid[c] += points[v * 3 + c] / 3.0f;
+                if (in_cluster[v] == cluster_number) continue;
+
+                in_cluster[v] = cluster_number;
+                vertices.push_back(v);
+                for (unsigned int t = vertex_triangles.offsets[v]; t < vertex_triangles.offsets[v + 1]; t++) {
+                    unsigned int triangle = vertex_triangles.triangles[t];
+                    if (emitted[triangle] || candidate_of[triangle] == cluster_number) continue;
+                    candidate_of[triangle] = cluster_number;
+                    candidates.push_back(triangle);
+                }
+            }
+            if (cluster_triangles == max_triangles) break;
+
+            // Choose the next one among the candidates that still fit
+            float centre[3] = {centroid[0] / cluster_triangles, centroid[1] / cluster_triangles, centroid[2] / cluster_triangles};
+            unsigned int best_new = 4;
+            float best_distance = 0.0f;
+            for (size_t i = 0; i < candidates.size(); i++) {
+                unsigned int triangle = candidates[i];
+                if (emitted[triangle]) {
+                    candidates[i--] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+
+                unsigned int new_vertices = 0;
+                float distance = 0.0f;
+                for (int k = 0; k < 3; k++) {
+                    unsigned int v = indices[triangle * 3 + k];
+                    if (in_cluster[v] != cluster_number) new_vertices++;
+                    for (int c = 0; c < 3; c++) {
+                        float d = points[v * 3 + c] - centre[c];
+                        distance += d * d;
+                    }
+                }
+                if (vertices.size() + new_vertices > max_vertices) continue;
+                if (new_vertices < best_new || (new_vertices == best_new && distance < best_distance)) {
+                    best = triangle;
+                    best_new = new_vertices;
+                    best_distance = distance;
+                }
+            }
+            if (best_new == 4) break;
+        }
+
+        cluster.index_count = cluster_triangles * 3;
+        clusterBounds(FloatPoints(points, vertice_count), ordered.data() + (cluster.first_index - first_index), cluster.index_count, &cluster);
+        mesh->clusters.push_back(cluster);
+
+        stats->count++;
+        stats->vertices += vertices.size();
+        stats->triangles += cluster_triangles;
+    }
+
+    copy(ordered.begin(), ordered.end(), indices);
+}
+
+MeshletStats buildMeshlets(Mesh* mesh, unsigned int max_vertices, unsigned int max_triangles) {
+    MeshletStats stats;
+    mesh->clusters.clear();
+
+    if (mesh->lods.empty()) {
+        buildRangeMeshlets(mesh, 0, (unsigned int) mesh->indices.size(), max_vertices, max_triangles, &stats);
+    }
+    for (MeshLOD& lod : mesh->lods) {
+        buildRangeMeshlets(mesh, lod.first_index, lod.index_count, max_vertices, max_triangles, &stats);
+    }
+
+    if (stats.count > 0) {
+        stats.vertices /= stats.count;
+        stats.triangles /= stats.count;
+    }
+    return stats;
+}
+
+void MeshletBuilder::end() {
+    this->stats = buildMeshlets(&this->mesh);
+    this->mesh.writeTo(this->sink);
+}
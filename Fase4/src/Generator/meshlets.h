@@ -0,0 +1,52 @@
+#ifndef MESHLETS_H
+#define MESHLETS_H
+
+#include <vector>
+
+#include "../utils/mesh.h"
+#include "../utils/bounds.h"
+
+using namespace std;
+
+// Largest number of vertices and triangles of a cluster, small enough for the vertices to stay in the cache
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+// Sizes of the clusters of a mesh, on average
+class MeshletStats {
+    public:
+        unsigned int count = 0;
+        float vertices = 0.0f;
+        float triangles = 0.0f;
+};
+
+// Splits each level of detail of a mesh into clusters of neighbouring triangles, reordering the triangles so
+// each cluster is a range of indices, and computes the bounding sphere and normal cone of each cluster
+MeshletStats buildMeshlets(Mesh* mesh, unsigned int max_vertices = MESHLET_MAX_VERTICES,
+                           unsigned int max_triangles = MESHLET_MAX_TRIANGLES);
+void clusterBounds(const PointSource& points, const unsigned int* indices, unsigned int index_count, MeshCluster* cluster);
+
+// Sink that gathers a whole mesh, splits it into clusters and only then gives it to another sink
+class MeshletBuilder : public MeshSink {
+    private:
+        Mesh mesh;
+        MeshBuilder builder = MeshBuilder(&mesh);
+        MeshSink* sink;
+        MeshletStats stats;
+    public:
+        MeshletBuilder(MeshSink* sink) {this->sink = sink;};
+
+        MeshletStats getStats() {return this->stats;};
+
+        void setLODs(const vector<MeshLOD>& lods) {this->mesh.lods = lods;};
+        void begin(unsigned int vertice_count, unsigned int index_count, bool normals, bool textures) {
+            this->builder.begin(vertice_count, index_count, normals, textures);
+        };
+        void points(const float* values, size_t count) {this->builder.points(values, count);};
+        void normals(const float* values, size_t count) {this->builder.normals(values, count);};
+        void textures(const float* values, size_t count) {this->builder.textures(values, count);};
+        void indices(const unsigned int* values, size_t count) {this->builder.indices(values, count);};
+        void end();
+};
+
+#endif //MESHLETS_H
@@ -0,0 +1,302 @@
+#include <vector>
+#include <algorithm>
+#include <math.h>
+
+#include "optimize.h"
+
+using namespace std;
+
+// Size of the LRU cache the triangle order is optimized for, and largest triangle count given its own score
+#define LRU_CACHE_SIZE 32
+#define MAX_VALENCE 64
+
+// FIFO vertex cache simulated with the time each vertex entered it, time counting the misses
+class FifoCache {
+    private:
+        vector<unsigned int> entered;
+        unsigned int time;
+        unsigned int size;
+    public:
+        FifoCache(unsigned int vertice_count, unsigned int size) : entered(vertice_count, 0) {
+            this->size = size;
+            this->time = size + 1;
+        };
+
+        // Returns 1 if v had to be transformed
+        int miss(unsigned int v) {
+            if (this->time - this->entered[v] <= this->size) return 0;
+            this->entered[v] = this->time++;
+            return 1;
+        };
+        void clear() {this->time += this->size + 1;};
+};
+
+CacheStats analyzeVertexCache(Mesh* mesh, int cache_size) {
+    CacheStats stats;
+    unsigned int vertice_count = mesh->getVerticeCount();
+    FifoCache cache(vertice_count, cache_size);
+    vector<bool> used(vertice_count, false);
+    unsigned int transforms = 0, used_count = 0;
+
+    for (unsigned int v : mesh->indices) {
+        transforms += cache.miss(v);
+        if (!used[v]) {
+            used[v] = true;
+            used_count++;
+        }
+    }
+
+    if (mesh->getTriangleCount() > 0) stats.acmr = (float) transforms / mesh->getTriangleCount();
+    if (used_count > 0) stats.atvr = (float) transforms / used_count;
+    return stats;
+}
+
+// Scores of a vertex from its position in the LRU cache and from the triangles still using it.
+// The last triangle's vertices score a bit less, so the order doesn't keep turning around them,
+// and vertices with few triangles left score more, so they're finished and leave the cache
+class VertexScores {
+    public:
+        float cache[LRU_CACHE_SIZE];
+        float valence[MAX_VALENCE + 1];
+
+        VertexScores() {
+            for (int i = 0; i < LRU_CACHE_SIZE; i++)
+                this->cache[i] = i < 3 ? 0.75f : powf(1.0f - (float) (i - 3) / (LRU_CACHE_SIZE - 3), 1.5f);
+            this->valence[0] = 0.0f;
+            for (int i = 1; i <= MAX_VALENCE; i++)
+                this->valence[i] = 2.0f / sqrtf((float) i);
+        };
+
+        float score(int cache_position, unsigned int remaining) const {
+            if (remaining == 0) return -1.0f;
+            float score = cache_position >= 0 ? this->cache[cache_position] : 0.0f;
+            return score + this->valence[remaining < MAX_VALENCE ? remaining : MAX_VALENCE];
+        };
+};
+
+// Linear-speed vertex cache optimization (Tom Forsyth): the next triangle is always the best scored
+// one among those using the vertices in the cache, the scores being the sum of its vertex scores
+static void optimizeVertexCache(unsigned int* indices, size_t index_count, unsigned int first_vertex, unsigned int vertice_count) {
+    static const VertexScores scores;
+    unsigned int triangle_count = (unsigned int) (index_count / 3);
+    if (triangle_count == 0) return;
+
+    // Triangles of each vertex, the ones not yet emitted at the start of its list
+    vector<unsigned int> remaining(vertice_count, 0), offsets(vertice_count + 1, 0), adjacency(index_count);
+    for (size_t i = 0; i < index_count; i++) remaining[indices[i] - first_vertex]++;
+    for (unsigned int v = 0; v < vertice_count; v++) offsets[v + 1] = offsets[v] + remaining[v];
+    vector<unsigned int> filled(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < index_count; i++) adjacency[filled[indices[i] - first_vertex]++] = (unsigned int) (i / 3);
+
+    vector<float> vertex_score(vertice_count), triangle_score(triangle_count, 0.0f);
+    for (unsigned int v = 0; v < vertice_count; v++) vertex_score[v] = scores.score(-1, remaining[v]);
+    for (size_t i = 0; i < index_count; i++) triangle_score[i / 3] += vertex_score[indices[i] - first_vertex];
+
+    vector<bool> emitted(triangle_count, false);
+    vector<unsigned int> output(index_count);
+    vector<unsigned int> cache, new_cache;
+    unsigned int cursor = 0;
+    int best = -1;
+
+    for (unsigned int out = 0; out < triangle_count; out++) {
+        // Without candidates in the cache, start again from the first triangle left
+        if (best < 0) {
+            while (emitted[cursor]) cursor++;
+            best = (int) cursor;
+        }
+
+        unsigned int t = (unsigned int) best;
+        emitted[t] = true;
+        new_cache.clear();
+        for (int corner = 0; corner < 3; corner++) {
+            unsigned int v = indices[t * 3 + corner] - first_vertex;
+            output[out * 3 + corner] = indices[t * 3 + corner];
+            new_cache.push_back(v);
+
+            // Take the triangle out of the vertex's list
+            unsigned int* list = &adjacency[offsets[v]];
+            for (unsigned int i = 0; i < remaining[v]; i++) {
+                if (list[i] == t) {
+                    list[i] = list[remaining[v] - 1];
+                    break;
+                }
+            }
+            remaining[v]--;
+        }
+        for (unsigned int v : cache) {
+            if (v != new_cache[0] && v != new_cache[1] && v != new_cache[2]) new_cache.push_back(v);
+        }
+
+        // Update the scores of every vertex in the cache, and of the vertices pushed out of it,
+        // along with their triangles
+        best = -1;
+        float best_score = -1.0f;
+        for (size_t i = 0; i < new_cache.size(); i++) {
+            unsigned int v = new_cache[i];
+            int position = i < LRU_CACHE_SIZE ? (int) i : -1;
+            float score = scores.score(position, remaining[v]);
+            float delta = score - vertex_score[v];
+            vertex_score[v] = score;
+
+            for (unsigned int j = 0; j < remaining[v]; j++) {
+                unsigned int adjacent = adjacency[offsets[v] + j];
+                triangle_score[adjacent] += delta;
+                if (position >= 0 && triangle_score[adjacent] > best_score) {
+                    best_score = triangle_score[adjacent];
+                    best = (int) adjacent;
+                }
+            }
+        }
+
+        if (new_cache.size() > LRU_CACHE_SIZE) new_cache.resize(LRU_CACHE_SIZE);
+        cache.swap(new_cache);
+    }
+
+    copy(output.begin(), output.end(), indices);
+}
+
+// View-independent overdraw reduction (Sander, Nehab and Barczak): the triangle order is cut into clusters
+// wherever the cache would have to start over anyway, and wherever a cluster already has a good enough
+// ACMR. Clusters facing away from the centre of the mesh are drawn first, as they're more likely to hide others
+static void optimizeOverdraw(const float* points, unsigned int* indices, size_t index_count, unsigned int first_vertex,
+                             unsigned int vertice_count, float threshold) {
+    unsigned int triangle_count = (unsigned int) (index_count / 3);
+    if (triangle_count < 2) return;
+
+    // Hard boundaries, where a triangle misses all its vertices
+    FifoCache cache(vertice_count, 16);
+    vector<unsigned int> misses(triangle_count);
+    vector<unsigned int> hard;
+    unsigned int total_misses = 0;
+    for (unsigned int t = 0; t < triangle_count; t++) {
+        misses[t] = 0;
+        for (int corner = 0; corner < 3; corner++) misses[t] += cache.miss(indices[t * 3 + corner] - first_vertex);
+        if (t == 0 || misses[t] == 3) hard.push_back(t);
+        total_misses += misses[t];
+    }
+    hard.push_back(triangle_count);
+
+    // Soft boundaries, cutting each hard cluster once its ACMR reaches threshold times the cluster's
+    vector<unsigned int> clusters;
+    FifoCache cluster_cache(vertice_count, 16);
+    for (size_t c = 0; c + 1 < hard.size(); c++) {
+        unsigned int start = hard[c], end = hard[c + 1];
+        unsigned int cluster_misses = 0;
+        for (unsigned int t = start; t < end; t++) cluster_misses += misses[t];
+        float cluster_threshold = threshold * cluster_misses / (end - start);
+
+        clusters.push_back(start);
+        cluster_cache.clear();
+        unsigned int last = start, accumulated = 0;
+        for (unsigned int t = start; t < end; t++) {
+            for (int corner = 0; corner < 3; corner++) accumulated += cluster_cache.miss(indices[t * 3 + corner] - first_vertex);
+            if (t + 1 < end && (float) accumulated / (t - last + 1) <= cluster_threshold) {
+                clusters.push_back(t + 1);
+                cluster_cache.clear();
+                last = t + 1;
+                accumulated = 0;
+            }
+        }
+    }
+    clusters.push_back(triangle_count);
+
+    // Centre of the mesh, and area weighted centre and normal of each cluster
+    double centre[3] = {0.0, 0.0, 0.0}, total_area = 0.0;
+    vector<double> cluster_centres((clusters.size() - 1) * 3, 0.0), cluster_normals((clusters.size() - 1) * 3, 0.0);
+    for (size_t c = 0; c + 1 < clusters.size(); c++) {
+        double cluster_area = 0.0;
+        for (unsigned int t = clusters[c]; t < clusters[c + 1]; t++) {
+            const float* a = &points[indices[t * 3] * 3];
+            const float* b = &points[indices[t * 3 + 1] * 3];
+            const float* p = &points[indices[t * 3 + 2] * 3];
+            double u[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]}, v[3] = {p[0] - a[0], p[1] - a[1], p[2] - a[2]};
+            double n[3] = {u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0]};
+            double area = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            for (int i = 0; i < 3; i++) {
+                double triangle_centre = (a[i] + b[i] + p[i]) / 3.0;
+                cluster_centres[c * 3 + i] += triangle_centre * area;
+                cluster_normals[c * 3 + i] += n[i];
+                centre[i] += triangle_centre * area;
+            }
+            cluster_area += area;
+        }
+        for (int i = 0; i < 3 && cluster_area > 0.0; i++) cluster_centres[c * 3 + i] /= cluster_area;
+        total_area += cluster_area;
+    }
+    for (int i = 0; i < 3 && total_area > 0.0; i++) centre[i] /= total_area;
+
+    vector<double> sort_keys(clusters.size() - 1);
+    vector<unsigned int> order(clusters.size() - 1);
+    for (size_t c = 0; c + 1 < clusters.size(); c++) {
+        double* n = &cluster_normals[c * 3];
+        double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        double key = 0.0;
+        for (int i = 0; i < 3 && length > 0.0; i++) key += (cluster_centres[c * 3 + i] - centre[i]) * n[i] / length;
+        sort_keys[c] = key;
+        order[c] = (unsigned int) c;
+    }
+    stable_sort(order.begin(), order.end(), [&sort_keys](unsigned int a, unsigned int b) {return sort_keys[a] > sort_keys[b];});
+
+    vector<unsigned int> sorted;
+    sorted.reserve(index_count);
+    for (unsigned int c : order) sorted.insert(sorted.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+
+    // Keep the cache order if the new one costs too many more vertices
+    FifoCache sorted_cache(vertice_count, 16);
+    unsigned int sorted_misses = 0;
+    for (unsigned int v : sorted) sorted_misses += sorted_cache.miss(v - first_vertex);
+    if (sorted_misses <= threshold * total_misses) copy(sorted.begin(), sorted.end(), indices);
+}
+
+// Renumbers the vertices of a range in the order the indices first use them, unused vertices going last
+static void optimizeVertexFetch(Mesh* mesh, unsigned int first_index, unsigned int index_count, unsigned int first_vertex, unsigned int vertice_count) {
+    const unsigned int unused = (unsigned int) -1;
+    vector<unsigned int> new_vertex(vertice_count, unused);
+    unsigned int next = 0;
+
+    for (unsigned int i = first_index; i < first_index + index_count; i++) {
+        unsigned int& v = mesh->indices[i];
+        if (new_vertex[v - first_vertex] == unused) new_vertex[v - first_vertex] = next++;
+        v = first_vertex + new_vertex[v - first_vertex];
+    }
+    for (unsigned int v = 0; v < vertice_count; v++) {
+        if (new_vertex[v] == unused) new_vertex[v] = next++;
+    }
+
+    auto permute = [&](vector<float>& values, int components) {
+        if (values.empty()) return;
+        vector<float> old(values.begin() + (size_t) first_vertex * components, values.begin() + (size_t) (first_vertex + vertice_count) * components);
+        for (unsigned int v = 0; v < vertice_count; v++) {
+            for (int i = 0; i < components; i++)
+                values[(size_t) (first_vertex + new_vertex[v]) * components + i] = old[(size_t) v * components + i];
+        }
+    };
+    permute(mesh->points, 3);
+    permute(mesh->normals, 3);
+    permute(mesh->textures, 2);
+}
+
+void optimizeMesh(Mesh* mesh, float overdraw_threshold) {
+    vector<MeshLOD> ranges = mesh->lods;
+    if (ranges.empty()) {
+        MeshLOD whole;
+        whole.index_count = (unsigned int) mesh->indices.size();
+        whole.vertice_count = mesh->getVerticeCount();
+        ranges.push_back(whole);
+    }
+
+    for (MeshLOD& range : ranges) {
+        unsigned int* indices = mesh->indices.data() + range.first_index;
+        optimizeVertexCache(indices, range.index_count, range.first_vertex, range.vertice_count);
+        optimizeOverdraw(mesh->points.data(), indices, range.index_count, range.first_vertex, range.vertice_count, overdraw_threshold);
+        optimizeVertexFetch(mesh, range.first_index, range.index_count, range.first_vertex, range.vertice_count);
+    }
+}
+
+void MeshOptimizer::end() {
+    this->before = analyzeVertexCache(&this->mesh);
+    optimizeMesh(&this->mesh);
+    this->after = analyzeVertexCache(&this->mesh);
+    this->mesh.writeTo(this->sink);
+}
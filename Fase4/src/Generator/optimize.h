@@ -0,0 +1,51 @@
+#ifndef OPTIMIZE_H
+#define OPTIMIZE_H
+
+#include <vector>
+
+#include "../utils/mesh.h"
+
+using namespace std;
+
+// Vertex cache efficiency of a triangle order, with a FIFO cache like the ones in GPUs.
+// ACMR is the average number of vertices transformed per triangle (0.5 is ideal for large grids, 3 the worst),
+// ATVR the average number of times each vertex is transformed (1 is ideal)
+class CacheStats {
+    public:
+        float acmr = 0.0f;
+        float atvr = 0.0f;
+};
+
+CacheStats analyzeVertexCache(Mesh* mesh, int cache_size = 16);
+
+// Reorders the triangles of each level of detail for vertex cache reuse and then, unless the cache gets
+// worse than threshold times the reordered one, puts the clusters facing out of the mesh first to reduce
+// overdraw. Vertices are then renumbered in the order they are used
+void optimizeMesh(Mesh* mesh, float overdraw_threshold = 1.05f);
+
+// Sink that gathers a whole mesh, optimizes it and only then gives it to another sink
+class MeshOptimizer : public MeshSink {
+    private:
+        Mesh mesh;
+        MeshBuilder builder = MeshBuilder(&mesh);
+        MeshSink* sink;
+        CacheStats before, after;
+    public:
+        MeshOptimizer(MeshSink* sink) {this->sink = sink;};
+        MeshSink* getSink() {return this->sink;};
+
+        CacheStats getStatsBefore() {return this->before;};
+        CacheStats getStatsAfter() {return this->after;};
+
+        void setLODs(const vector<MeshLOD>& lods) {this->mesh.lods = lods;};
+        void begin(unsigned int vertice_count, unsigned int index_count, bool normals, bool textures) {
+            this->builder.begin(vertice_count, index_count, normals, textures);
+        };
+        void points(const float* values, size_t count) {this->builder.points(values, count);};
+        void normals(const float* values, size_t count) {this->builder.normals(values, count);};
+        void textures(const float* values, size_t count) {this->builder.textures(values, count);};
+        void indices(const unsigned int* values, size_t count) {this->builder.indices(values, count);};
+        void end();
+};
+
+#endif //OPTIMIZE_H
@@ -0,0 +1,77 @@
+#include <thread>
+#include <vector>
+
+#include "parallel.h"
+
+// Number of hardware threads, or 1 if it can't be known
+int defaultThreadCount() {
+    int nr_threads = (int) thread::hardware_concurrency();
+
+    return nr_threads > 0 ? nr_threads : 1;
+}
+
+// Runs task(i) for every i in [0, count[ using up to nr_threads threads, the calling one included.
+// Each thread takes the next unprocessed i until there's none left, so tasks must be independent
+void parallelFor(int count, int nr_threads, function<void(int)> task) {
+    if (nr_threads > count) nr_threads = count;
+
+    if (nr_threads <= 1) {
+        for (int i = 0; i < count; i++) task(i);
+        return;
+    }
+
+    ThreadPool pool(nr_threads - 1);
+    pool.start(count, task);
+    pool.wait();
+}
+
+
+ThreadPool::ThreadPool(int nr_workers) {
+    for (int i = 0; i < nr_workers; i++) this->threads.push_back(thread([this]() {worker();}));
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> guard(this->lock);
+        this->stopping = true;
+    }
+    this->work_ready.notify_all();
+    for (thread& t : this->threads) t.join();
+}
+
+// Runs tasks as they're started, until the pool is destroyed
+void ThreadPool::worker() {
+    unique_lock<mutex> guard(this->lock);
+    while (true) {
+        this->work_ready.wait(guard, [this]() {return this->stopping || this->next < this->count;});
+        if (this->next >= this->count) return;
+        runNext(guard);
+    }
+}
+
+// Takes the next task and runs it without the lock, so other threads can take the following ones
+void ThreadPool::runNext(unique_lock<mutex>& guard) {
+    int i = this->next++;
+    guard.unlock();
+    this->task(i);
+    guard.lock();
+    if (++this->finished == this->count) this->work_done.notify_all();
+}
+
+// Tasks of a previous start() must be waited for first
+void ThreadPool::start(int count, function<void(int)> task) {
+    {
+        lock_guard<mutex> guard(this->lock);
+        this->task = task;
+        this->count = count;
+        this->next = 0;
+        this->finished = 0;
+    }
+    this->work_ready.notify_all();
+}
+
+void ThreadPool::wait() {
+    unique_lock<mutex> guard(this->lock);
+    while (this->next < this->count) runNext(guard);
+    this->work_done.wait(guard, [this]() {return this->finished == this->count;});
+}
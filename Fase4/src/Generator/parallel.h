@@ -0,0 +1,42 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+using namespace std;
+
+int defaultThreadCount();
+void parallelFor(int count, int nr_threads, function<void(int)> task);
+
+// Fixed set of worker threads, started once and reused for every batch of tasks.
+// start() hands task(i), for every i in [0, count[, to the workers and returns at once, so the caller can do
+// other work meanwhile; wait() runs the tasks no worker has taken yet and returns once they're all done.
+// A pool without workers runs every task in wait()
+class ThreadPool {
+    private:
+        vector<thread> threads;
+        mutex lock;
+        condition_variable work_ready;
+        condition_variable work_done;
+        function<void(int)> task;
+        int count = 0;
+        int next = 0;
+        int finished = 0;
+        bool stopping = false;
+
+        void worker();
+        void runNext(unique_lock<mutex>& lock);
+    public:
+        ThreadPool(int nr_workers);
+        ~ThreadPool();
+
+        int getWorkerCount() const {return (int) this->threads.size();};
+        void start(int count, function<void(int)> task);
+        void wait();
+};
+
+#endif //PARALLEL_H
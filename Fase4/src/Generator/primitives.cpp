@@ -1,367 +1,530 @@
 #define _USE_MATH_DEFINES 
 #include <math.h>
 #include <string>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <stdint.h>
 
 #include "../utils/float_vector.h"
 
 #include "primitives.h"
+#include "kernels.h"
+#include "parallel.h"
 
 using namespace std;
 
-// Criação de um plano na superfície do plano XZ.
-vector<Ponto> plane(float size) {
-
-	//vector<Ponto> É o mesmo que ter um array dinamico de Ponto
-	vector<Ponto> pontos;
-
-	float distancia = size / 2;
-
-	pontos.push_back(Ponto(distancia, 0, distancia));
-	pontos.push_back(Ponto(distancia, 0, -distancia));
-	pontos.push_back(Ponto(-distancia, 0, -distancia));
-
-	pontos.push_back(Ponto(-distancia, 0, -distancia));
-	pontos.push_back(Ponto(-distancia, 0, distancia));
-	pontos.push_back(Ponto(distancia, 0, distancia));
-
-	return pontos;
-
+// Senos e cossenos dos ângulos inicio + i * passo, com i de 0 a n, calculados uma única vez por primitiva.
+// Estão guardados em arrays separados para os kernels, que geram os vértices só com multiplicações e somas
+class TabelaTrig {
+	private:
+		vector<float> tabelaSenos;
+		vector<float> tabelaCossenos;
+	public:
+		TabelaTrig(int n, float passo, double inicio = 0.0) {
+			this->tabelaSenos.resize(n + 1);
+			this->tabelaCossenos.resize(n + 1);
+
+			for (int i = 0; i <= n; i++) {
+				float angulo = inicio + i * passo;
+				this->tabelaSenos[i] = sin(angulo);
+				this->tabelaCossenos[i] = cos(angulo);
+			}
+		};
+		float seno(int i) const {return this->tabelaSenos[i];};
+		float cosseno(int i) const {return this->tabelaCossenos[i];};
+		const float* senos() const {return this->tabelaSenos.data();};
+		const float* cossenos() const {return this->tabelaCossenos.data();};
+};
+
+// Valores i / n, com i de 0 a n, usados como coordenadas de textura
+static vector<float> fracoes(int n) {
+	vector<float> valores(n + 1);
+	for (int i = 0; i <= n; i++) valores[i] = (float) i / n;
+	return valores;
 }
 
-// Criação de uma box com as dimensões dadas e com um numero de Divisões em iguais secções da caixa
-vector<Ponto> box(float dimX, float dimY, float dimZ, int nrDivisoes) {
-
-	vector<Ponto> pontos;
+// Sends nr_rows rows of row_size values to send, in order. Rows are filled by fill(row, values) in batches of
+// PRIMITIVE_SLICES_PER_THREAD rows per worker of the pool, each worker filling a contiguous range of the batch.
+// There are two batches, so the workers fill the next one while the current one is sent. Every row is filled
+// the same way by any thread, so the output doesn't depend on the number of threads
+template <typename T, typename Fill, typename Send>
+static void sendRows(ThreadPool& pool, int nr_rows, int row_size, Fill fill, Send send) {
+	int nr_ranges = max(pool.getWorkerCount(), 1);
+	int batch_rows = nr_ranges * PRIMITIVE_SLICES_PER_THREAD;
+	int nr_batches = (nr_rows + batch_rows - 1) / batch_rows;
+	vector<T> batches[2];
+	for (vector<T>& batch : batches) batch.resize((size_t) min(nr_rows, batch_rows) * row_size);
+
+	auto rowCount = [&](int batch) {return min(batch_rows, nr_rows - batch * batch_rows);};
+	auto startBatch = [&](int batch) {
+		int first = batch * batch_rows, count = rowCount(batch);
+		T* values = batches[batch % 2].data();
+		pool.start(nr_ranges, [&fill, first, count, nr_ranges, row_size, values](int range) {
+			for (int row = count * range / nr_ranges; row < count * (range + 1) / nr_ranges; row++) {
+				fill(first + row, &values[(size_t) row * row_size]);
+			}
+		});
+	};
+
+	if (nr_batches > 0) startBatch(0);
+	pool.wait();
+	for (int batch = 0; batch < nr_batches; batch++) {
+		if (batch + 1 < nr_batches) startBatch(batch + 1);
+		send(batches[batch % 2].data(), (size_t) rowCount(batch) * row_size);
+		pool.wait();
+	}
+}
 
-	float inicialX = dimX / 2;
-	float inicialY = dimY / 2;
-	float inicialZ = dimZ / 2;
+// Criação de um plano na superfície do plano XZ.
+void plane(float size, Mesh* mesh) {
 
-	float distanciaX = dimX / nrDivisoes;
-	float distanciaY = dimY / nrDivisoes;
-	float distanciaZ = dimZ / nrDivisoes;
+	float distancia = size / 2;
 
-	for (int divX = 0; divX < nrDivisoes; divX++) {
-		for (int divZ = 0; divZ < nrDivisoes; divZ++) {
+	unsigned int p1 = mesh->addPoint(Ponto(distancia, 0, distancia));
+	unsigned int p2 = mesh->addPoint(Ponto(distancia, 0, -distancia));
+	unsigned int p3 = mesh->addPoint(Ponto(-distancia, 0, -distancia));
+	unsigned int p4 = mesh->addPoint(Ponto(-distancia, 0, distancia));
 
-			// Plano xz pos
-			pontos.push_back(Ponto(-inicialX + divX * distanciaX, inicialY, -inicialZ + (divZ + 1) * distanciaZ));
-			pontos.push_back(Ponto(-inicialX + (divX + 1) * distanciaX, inicialY, -inicialZ + divZ * distanciaZ));
-			pontos.push_back(Ponto(-inicialX + divX * distanciaX, inicialY, -inicialZ + divZ * distanciaZ));
+	mesh->addTriangle(p1, p2, p3);
+	mesh->addTriangle(p3, p4, p1);
+}
 
-			pontos.push_back(Ponto(-inicialX + divX * distanciaX, inicialY, -inicialZ + (divZ + 1) * distanciaZ));
-			pontos.push_back(Ponto(-inicialX + (divX + 1) * distanciaX, inicialY, -inicialZ + (divZ + 1) * distanciaZ));
-			pontos.push_back(Ponto(-inicialX + (divX + 1) * distanciaX, inicialY, -inicialZ + divZ * distanciaZ));
+// Adiciona uma face da box, dividida numa grelha de nrDivisoes x nrDivisoes quadrados.
+// Os vetores u e v vão de um quadrado para o seguinte, e u x v tem de apontar para fora da box
+void boxFace(Ponto origem, Ponto u, Ponto v, int nrDivisoes, Mesh* mesh) {
 
-			// Plano xz neg
-			pontos.push_back(Ponto(-inicialX + divX * distanciaX, -inicialY, -inicialZ + (divZ + 1) * distanciaZ));
-			pontos.push_back(Ponto(-inicialX + divX * distanciaX, -inicialY, -inicialZ + divZ * distanciaZ));
-			pontos.push_back(Ponto(-inicialX + (divX + 1) * distanciaX, -inicialY, -inicialZ + divZ * distanciaZ));
+	unsigned int base = mesh->getVerticeCount();
+	int pontosPorLinha = nrDivisoes + 1;
 
-			pontos.push_back(Ponto(-inicialX + divX * distanciaX, -inicialY, -inicialZ + (divZ + 1) * distanciaZ));
-			pontos.push_back(Ponto(-inicialX + (divX + 1) * distanciaX, -inicialY, -inicialZ + divZ * distanciaZ));
-			pontos.push_back(Ponto(-inicialX + (divX + 1) * distanciaX, -inicialY, -inicialZ + (divZ + 1) * distanciaZ));
+	// Cada linha da grelha começa em origem + i * u e avança v de ponto para ponto
+	float* pontos = mesh->addPoints(pontosPorLinha * pontosPorLinha);
+	float passo[3] = {v.getX(), v.getY(), v.getZ()};
 
-		}
+	for (int i = 0; i <= nrDivisoes; i++) {
+		float inicio[3] = {origem.getX() + i * u.getX(), origem.getY() + i * u.getY(), origem.getZ() + i * u.getZ()};
+		lineRow(inicio, passo, pontosPorLinha, &pontos[i * pontosPorLinha * 3]);
 	}
 
-	for (int divX = 0; divX < nrDivisoes; divX++) {
-		for (int divY = 0; divY < nrDivisoes; divY++) {
-
-			// Plano xy pos
-			pontos.push_back(Ponto(-inicialX + (divX + 1) * distanciaX, inicialY - divY * distanciaY, inicialZ));
-			pontos.push_back(Ponto(-inicialX + divX * distanciaX, inicialY - divY * distanciaY, inicialZ));
-			pontos.push_back(Ponto(-inicialX + divX * distanciaX, inicialY - (divY + 1) * distanciaY, inicialZ));
-
-			pontos.push_back(Ponto(-inicialX + (divX + 1) * distanciaX, inicialY - (divY + 1) * distanciaY, inicialZ));
-			pontos.push_back(Ponto(-inicialX + (divX + 1) * distanciaX, inicialY - divY * distanciaY, inicialZ));
-			pontos.push_back(Ponto(-inicialX + divX * distanciaX, inicialY - (divY + 1) * distanciaY, inicialZ));
-
-			// Plano xy neg
-			pontos.push_back(Ponto(-inicialX + (divX + 1) * distanciaX, inicialY - divY * distanciaY, -inicialZ));
-			pontos.push_back(Ponto(-inicialX + divX * distanciaX, inicialY - (divY + 1) * distanciaY, -inicialZ));
-			pontos.push_back(Ponto(-inicialX + divX * distanciaX, inicialY - divY * distanciaY, -inicialZ));
+	// Dois triângulos por quadrado, (p1, p2, p3) e (p1, p3, p4), com p1 = linha + j, p2 = proxLinha + j,
+	// p3 = proxLinha + j + 1 e p4 = linha + j + 1
+	unsigned int* triangulos = mesh->addTriangles(nrDivisoes * nrDivisoes * 2);
 
-			pontos.push_back(Ponto(-inicialX + (divX + 1) * distanciaX, inicialY - (divY + 1) * distanciaY, -inicialZ));
-			pontos.push_back(Ponto(-inicialX + divX * distanciaX, inicialY - (divY + 1) * distanciaY, -inicialZ));
-			pontos.push_back(Ponto(-inicialX + (divX + 1) * distanciaX, inicialY - divY * distanciaY, -inicialZ));
+	for (int i = 0; i < nrDivisoes; i++) {
+		unsigned int linha = base + i * pontosPorLinha;
+		unsigned int proxLinha = linha + pontosPorLinha;
+		unsigned int inicio[6] = {linha, proxLinha, proxLinha + 1, linha, proxLinha + 1, linha + 1};
 
-		}
+		quadRowIndices(inicio, 1, nrDivisoes, &triangulos[i * nrDivisoes * 6]);
 	}
+}
 
-	for (int divY = 0; divY < nrDivisoes; divY++) {
-		for (int divZ = 0; divZ < nrDivisoes; divZ++) {
-
-			// Plano yz pos
-			pontos.push_back(Ponto(inicialX, inicialY - (divY + 1) * distanciaY, inicialZ - divZ * distanciaZ));
-			pontos.push_back(Ponto(inicialX, inicialY - (divY + 1) * distanciaY, inicialZ - (divZ + 1) * distanciaZ));
-			pontos.push_back(Ponto(inicialX, inicialY - divY * distanciaY, inicialZ - (divZ + 1) * distanciaZ));
+// Criação de uma box com as dimensões dadas e com um numero de Divisões em iguais secções da caixa
+void box(float dimX, float dimY, float dimZ, int nrDivisoes, Mesh* mesh) {
 
-			pontos.push_back(Ponto(inicialX, inicialY - (divY + 1) * distanciaY, inicialZ - divZ * distanciaZ));
-			pontos.push_back(Ponto(inicialX, inicialY - divY * distanciaY, inicialZ - (divZ + 1) * distanciaZ));
-			pontos.push_back(Ponto(inicialX, inicialY - divY * distanciaY, inicialZ - divZ * distanciaZ));
+	float inicialX = dimX / 2;
+	float inicialY = dimY / 2;
+	float inicialZ = dimZ / 2;
 
-			// Plano yz neg
-			pontos.push_back(Ponto(-inicialX, inicialY - (divY + 1) * distanciaY, inicialZ - divZ * distanciaZ));
-			pontos.push_back(Ponto(-inicialX, inicialY - divY * distanciaY, inicialZ - (divZ + 1) * distanciaZ));
-			pontos.push_back(Ponto(-inicialX, inicialY - (divY + 1) * distanciaY, inicialZ - (divZ + 1) * distanciaZ));
+	Ponto passoX = Ponto(dimX / nrDivisoes, 0.0f, 0.0f);
+	Ponto passoY = Ponto(0.0f, dimY / nrDivisoes, 0.0f);
+	Ponto passoZ = Ponto(0.0f, 0.0f, dimZ / nrDivisoes);
 
-			pontos.push_back(Ponto(-inicialX, inicialY - (divY + 1) * distanciaY, inicialZ - divZ * distanciaZ));
-			pontos.push_back(Ponto(-inicialX, inicialY - divY * distanciaY, inicialZ - divZ * distanciaZ));
-			pontos.push_back(Ponto(-inicialX, inicialY - divY * distanciaY, inicialZ - (divZ + 1) * distanciaZ));
+	// Plano xz pos e neg
+	boxFace(Ponto(-inicialX, inicialY, -inicialZ), passoZ, passoX, nrDivisoes, mesh);
+	boxFace(Ponto(-inicialX, -inicialY, -inicialZ), passoX, passoZ, nrDivisoes, mesh);
 
-		}
-	}
+	// Plano xy pos e neg
+	boxFace(Ponto(-inicialX, -inicialY, inicialZ), passoX, passoY, nrDivisoes, mesh);
+	boxFace(Ponto(-inicialX, -inicialY, -inicialZ), passoY, passoX, nrDivisoes, mesh);
 
-	return pontos;
+	// Plano yz pos e neg
+	boxFace(Ponto(inicialX, -inicialY, -inicialZ), passoY, passoZ, nrDivisoes, mesh);
+	boxFace(Ponto(-inicialX, -inicialY, -inicialZ), passoZ, passoY, nrDivisoes, mesh);
 }
 
 // Criação de um cone com um dado raio, uma altura, nr slices e de stacks
-vector<Ponto> cone(float raioBase, float alturaCone, int nrSlices, int nrStacks) {
-
-	vector<Ponto> pontos;
+void cone(float raioBase, float alturaCone, int nrSlices, int nrStacks, Mesh* mesh) {
 
 	float defaultAngleFatia = (2 * M_PI) / nrSlices;
 	float alturaStack = alturaCone / nrStacks;
 	float mudancaRaioStack = raioBase / nrStacks;
 
-	for (int fatiaNr = 0; fatiaNr < nrSlices; fatiaNr++) {
+	TabelaTrig fatias = TabelaTrig(nrSlices, defaultAngleFatia);
 
-		float angulo = fatiaNr * defaultAngleFatia;
-		float proxAngulo = angulo + defaultAngleFatia;
+	// Base: centro seguido dos pontos da circunferência
+	unsigned int centro = mesh->addPoint(Ponto(0.0f, 0.0f, 0.0f));
+	ringRow(raioBase, 0.0f, fatias.senos(), fatias.cossenos(), nrSlices, mesh->addPoints(nrSlices));
 
-		float alturaAtual = 0;
-		float proxAltura = alturaStack;
-
-		float raioAtual = raioBase;
-		float proxRaio = raioBase - mudancaRaioStack;
-
-
-		// Base
-		pontos.push_back(Ponto(0.0f, 0.0f, 0.0f));
-		pontos.push_back(Ponto(raioBase * cos(angulo), 0.0f, raioBase * sin(angulo)));
-		pontos.push_back(Ponto(raioBase * cos(proxAngulo), 0.0f, raioBase * sin(proxAngulo)));
-
-		for (int nrCamada = 1; nrCamada < nrStacks; nrCamada++) {
-
-			//Triangulo de stacks intermédias que compõe um quadrado
-			pontos.push_back(Ponto(proxRaio * cos(proxAngulo), proxAltura, proxRaio * sin(proxAngulo)));
-			pontos.push_back(Ponto(raioAtual * cos(proxAngulo), alturaAtual, raioAtual * sin(proxAngulo)));
-			pontos.push_back(Ponto(raioAtual * cos(angulo), alturaAtual, raioAtual * sin(angulo)));
-
-			//Triangulo de stacks intermédias que compõe um quadrado
-			pontos.push_back(Ponto(proxRaio * cos(angulo), proxAltura, proxRaio * sin(angulo)));
-			pontos.push_back(Ponto(proxRaio * cos(proxAngulo), proxAltura, proxRaio * sin(proxAngulo)));
-			pontos.push_back(Ponto(raioAtual * cos(angulo), alturaAtual, raioAtual * sin(angulo)));
-
-			alturaAtual += alturaStack;
-			proxAltura += alturaStack;
-
-			raioAtual -= mudancaRaioStack;
-			proxRaio -= mudancaRaioStack;
-		}
+	for (int fatiaNr = 0; fatiaNr < nrSlices; fatiaNr++) {
+		mesh->addTriangle(centro, centro + 1 + fatiaNr, centro + 1 + (fatiaNr + 1) % nrSlices);
+	}
 
-		//Triângulos ultima stack
-		pontos.push_back(Ponto(raioAtual * cos(proxAngulo), alturaAtual, raioAtual * sin(proxAngulo)));
-		pontos.push_back(Ponto(raioAtual * cos(angulo), alturaAtual, raioAtual * sin(angulo)));
-		pontos.push_back(Ponto(0.0f, alturaCone, 0.0f));
+	// Superfície lateral: uma circunferência por stack, terminando no topo do cone
+	unsigned int base = mesh->getVerticeCount();
+	float* pontos = mesh->addPoints(nrStacks * nrSlices);
+	for (int nrCamada = 0; nrCamada < nrStacks; nrCamada++) {
+		float altura = nrCamada * alturaStack;
+		float raio = raioBase - nrCamada * mudancaRaioStack;
 
+		ringRow(raio, altura, fatias.senos(), fatias.cossenos(), nrSlices, &pontos[nrCamada * nrSlices * 3]);
 	}
+	unsigned int topo = mesh->addPoint(Ponto(0.0f, alturaCone, 0.0f));
 
-	return pontos;
+	for (int fatiaNr = 0; fatiaNr < nrSlices; fatiaNr++) {
+		unsigned int fatia = fatiaNr;
+		unsigned int proxFatia = (fatiaNr + 1) % nrSlices;
+
+		//Triangulos de stacks intermédias que compõem um quadrado, de camada em camada (nrSlices pontos)
+		unsigned int camada = base, proxCamada = base + nrSlices;
+		unsigned int inicio[6] = {proxCamada + proxFatia, camada + proxFatia, camada + fatia,
+								  proxCamada + fatia, proxCamada + proxFatia, camada + fatia};
+		quadRowIndices(inicio, nrSlices, nrStacks - 1, mesh->addTriangles((nrStacks - 1) * 2));
+
+		//Triângulo da ultima stack
+		unsigned int ultimaCamada = base + (nrStacks - 1) * nrSlices;
+		mesh->addTriangle(ultimaCamada + proxFatia, ultimaCamada + fatia, topo);
+	}
 }
 
 // Criação de uma esfera com um dado raio, nr slices e de stacks
-void sphere(float raio, int nrSlices, int nrStacks, vector<Ponto>* ps, vector<Ponto>* ns, vector<float>* ts) {
-
-	vector<Ponto> pontos;
-	vector<Ponto> normals;
-	vector<float> textures;
-
-	float defaultAngleFatia = (2 * M_PI) / nrSlices;
-	float defaultAngleStack = M_PI / nrStacks;
-
-	for (int fatiaNr = 0; fatiaNr < nrSlices; fatiaNr++) {
-
-		float anguloFatia = fatiaNr * defaultAngleFatia;
-		float proxAnguloFatia = anguloFatia + defaultAngleFatia;
-
-		float anguloStack = - M_PI_2;
-		float proxAnguloStack = anguloStack + defaultAngleStack;
-
-		// Para perceber ver slides P03, mais especificamente página 3/9 (tem lá as fórmulas e a explicação)
-
-		//Triângulos da primeira stack (mais em baixo)
-		Ponto p1 = Ponto(0.0f, -raio, 0.0f);
-		Ponto p2 = Ponto(raio * cos(proxAnguloStack) * sin(proxAnguloFatia), raio * sin(proxAnguloStack), raio * cos(proxAnguloStack) * cos(proxAnguloFatia));
-		Ponto p3 = Ponto(raio * cos(proxAnguloStack) * sin(anguloFatia), raio * sin (proxAnguloStack) , raio * cos(proxAnguloStack) * cos(anguloFatia));
-		
-		pontos.push_back(p1);
-		pontos.push_back(p2);
-		pontos.push_back(p3);
-
-		normals.push_back(vector_normalize_ponto(p1));
-		normals.push_back(vector_normalize_ponto(p2));
-		normals.push_back(vector_normalize_ponto(p3));
-
-		textures.push_back( anguloFatia / (2*M_PI) ); textures.push_back( 0.0 );
-		textures.push_back( proxAnguloFatia / (2*M_PI) ); textures.push_back( (proxAnguloStack + M_PI_2) / M_PI );
-		textures.push_back( anguloFatia / (2*M_PI) ); textures.push_back( (proxAnguloStack + M_PI_2) / M_PI );
+void sphere(float raio, int nrSlices, int nrStacks, MeshSink* sink, int nr_threads) {
+
+	// Para perceber ver slides P03, mais especificamente página 3/9 (tem lá as fórmulas e a explicação)
+
+	// Grelha de (nrSlices+1) x (nrStacks+1) pontos. A última fatia repete a primeira com outra
+	// coordenada de textura, e os polos são repetidos em cada fatia pelo mesmo motivo
+	int pontosPorFatia = nrStacks + 1;
+	int quadradosPorFatia = max(nrStacks - 2, 0);
+	int triangulosPorFatia = 2 + 2 * quadradosPorFatia;
+	sink->begin((nrSlices + 1) * pontosPorFatia, nrSlices * triangulosPorFatia * 3, true, true);
+	if ((long long) nrSlices * nrStacks < PRIMITIVE_PARALLEL_MIN_QUADS) nr_threads = 1;
+	ThreadPool pool(nr_threads > 1 ? nr_threads : 0);
+
+	// Senos e cossenos de cada fatia e de cada camada
+	TabelaTrig fatias = TabelaTrig(nrSlices, (2 * M_PI) / nrSlices);
+	TabelaTrig camadas = TabelaTrig(nrStacks, M_PI / nrStacks, - M_PI_2);
+
+	// Cada secção é enviada um lote de fatias de cada vez, por isso só são guardadas algumas fatias em memória.
+	// Os polos são exatos, e com raio 1 os pontos são as normais
+	auto enviarPontos = [&](const float* valores, size_t n) {sink->points(valores, n);};
+	sendRows<float>(pool, nrSlices + 1, pontosPorFatia * 3, [&](int fatiaNr, float* valores) {
+		sphereRow(raio, fatias.seno(fatiaNr), fatias.cosseno(fatiaNr), camadas.senos(), camadas.cossenos(), pontosPorFatia, valores);
+		float* ultimo = &valores[nrStacks * 3];
+		valores[0] = 0.0f; valores[1] = -raio; valores[2] = 0.0f;
+		ultimo[0] = 0.0f; ultimo[1] = raio; ultimo[2] = 0.0f;
+	}, enviarPontos);
+
+	auto enviarNormais = [&](const float* valores, size_t n) {sink->normals(valores, n);};
+	sendRows<float>(pool, nrSlices + 1, pontosPorFatia * 3, [&](int fatiaNr, float* valores) {
+		sphereRow(1.0f, fatias.seno(fatiaNr), fatias.cosseno(fatiaNr), camadas.senos(), camadas.cossenos(), pontosPorFatia, valores);
+		float* ultimo = &valores[nrStacks * 3];
+		valores[0] = 0.0f; valores[1] = -1.0f; valores[2] = 0.0f;
+		ultimo[0] = 0.0f; ultimo[1] = 1.0f; ultimo[2] = 0.0f;
+	}, enviarNormais);
+
+	vector<float> v = fracoes(nrStacks);
+	auto enviarTexturas = [&](const float* valores, size_t n) {sink->textures(valores, n);};
+	sendRows<float>(pool, nrSlices + 1, pontosPorFatia * 2, [&](int fatiaNr, float* valores) {
+		texturesRowFixedU((float) fatiaNr / nrSlices, v.data(), pontosPorFatia, valores);
+	}, enviarTexturas);
+
+	auto enviarIndices = [&](const unsigned int* indices, size_t n) {sink->indices(indices, n);};
+	sendRows<unsigned int>(pool, nrSlices, triangulosPorFatia * 3, [&](int fatiaNr, unsigned int* indices) {
+		unsigned int fatia = fatiaNr * pontosPorFatia;
+		unsigned int proxFatia = fatia + pontosPorFatia;
+		unsigned int* ultimoTriangulo = &indices[(triangulosPorFatia - 1) * 3];
+
+		//Triângulo da primeira stack (mais em baixo)
+		indices[0] = fatia; indices[1] = proxFatia + 1; indices[2] = fatia + 1;
+
+		//Triangulos de stacks intermédias que compõem um quadrado, a começar na camada 1
+		unsigned int inicio[6] = {fatia + 1, proxFatia + 1, fatia + 2, proxFatia + 1, proxFatia + 2, fatia + 2};
+		quadRowIndices(inicio, 1, quadradosPorFatia, &indices[3]);
+
+		//Triângulo da última stack (mais em cima)
+		ultimoTriangulo[0] = fatia + nrStacks - 1; ultimoTriangulo[1] = proxFatia + nrStacks - 1; ultimoTriangulo[2] = fatia + nrStacks;
+	}, enviarIndices);
+
+	sink->end();
+}
 
-		anguloStack += defaultAngleStack;
-		proxAnguloStack += defaultAngleStack;
+void sphere(float raio, int nrSlices, int nrStacks, Mesh* mesh, int nr_threads) {
+	MeshBuilder builder = MeshBuilder(mesh);
+	sphere(raio, nrSlices, nrStacks, &builder, nr_threads);
+}
 
-		for (int nrCamada = 1; nrCamada < nrStacks; nrCamada++) {
 
-			//Triangulo de stacks intermédias que compõe um quadrado
-			p1 = Ponto(raio * cos(anguloStack) * sin(anguloFatia), raio * sin(anguloStack), raio * cos(anguloStack) * cos(anguloFatia));
-			p2 = Ponto(raio * cos(anguloStack) * sin(proxAnguloFatia), raio * sin(anguloStack), raio * cos(anguloStack) * cos(proxAnguloFatia));
-			p3 = Ponto(raio * cos(proxAnguloStack) * sin(anguloFatia), raio * sin(proxAnguloStack), raio * cos(proxAnguloStack) * cos(anguloFatia));
+// Creates a torus centered on origin
+void torus(float innerRadius, float outerRadius, int slices, int stacks, MeshSink* sink, int nr_threads) {
 
-			pontos.push_back(p1);
-			pontos.push_back(p2);
-			pontos.push_back(p3);
+	float sliceAngle = (2 * M_PI) / slices;
+	float stackAngle = (2 * M_PI) / stacks;
 
-			normals.push_back(vector_normalize_ponto(p1));
-			normals.push_back(vector_normalize_ponto(p2));
-			normals.push_back(vector_normalize_ponto(p3));
+	// Grid of (slices+1) x (stacks+1) points, the last row and column repeat the first ones
+	// with different texture coordinates
+	int pointsPerSlice = stacks + 1;
+	sink->begin((slices + 1) * pointsPerSlice, slices * stacks * 6, true, true);
+	if ((long long) slices * stacks < PRIMITIVE_PARALLEL_MIN_QUADS) nr_threads = 1;
+	ThreadPool pool(nr_threads > 1 ? nr_threads : 0);
+
+	// Sines and cosines of every slice angle (alpha) and stack angle (beta)
+	TabelaTrig alpha = TabelaTrig(slices, sliceAngle);
+	TabelaTrig beta = TabelaTrig(stacks, stackAngle);
+
+	// Each section is sent a batch of slices at a time, so only a few slices are kept in memory
+	auto sendPoints = [&](const float* values, size_t count) {sink->points(values, count);};
+	sendRows<float>(pool, slices + 1, pointsPerSlice * 3, [&](int i, float* slice) {
+		torusPointsRow(innerRadius, outerRadius, alpha.seno(i), alpha.cosseno(i), beta.senos(), beta.cossenos(), pointsPerSlice, slice);
+	}, sendPoints);
+
+	auto sendNormals = [&](const float* values, size_t count) {sink->normals(values, count);};
+	sendRows<float>(pool, slices + 1, pointsPerSlice * 3, [&](int i, float* slice) {
+		torusNormalsRow(alpha.seno(i), alpha.cosseno(i), beta.senos(), beta.cossenos(), pointsPerSlice, slice);
+	}, sendNormals);
+
+	vector<float> u = fracoes(stacks);
+	auto sendTextures = [&](const float* values, size_t count) {sink->textures(values, count);};
+	sendRows<float>(pool, slices + 1, pointsPerSlice * 2, [&](int i, float* slice) {
+		texturesRowFixedV(u.data(), (float) i / slices, pointsPerSlice, slice);
+	}, sendTextures);
+
+	// Process each slice and stack, adding the two triangles associated to them:
+	// (p1, p2, p3) and (p1, p3, p4), with p1 = slice + j, p2 = slice + j + 1, p3 = next slice + j + 1, p4 = next slice + j
+	auto sendIndices = [&](const unsigned int* values, size_t count) {sink->indices(values, count);};
+	sendRows<unsigned int>(pool, slices, stacks * 6, [&](int i, unsigned int* indices) {
+		unsigned int first = i * pointsPerSlice;
+		unsigned int next = first + pointsPerSlice;
+		unsigned int start[6] = {first, first + 1, next + 1, first, next + 1, next};
+
+		quadRowIndices(start, 1, stacks, indices);
+	}, sendIndices);
+
+	sink->end();
+}
 
-			textures.push_back( anguloFatia / (2*M_PI) ); textures.push_back( (anguloStack + M_PI_2) / M_PI );
-			textures.push_back( proxAnguloFatia / (2*M_PI) ); textures.push_back( (anguloStack + M_PI_2) / M_PI );
-			textures.push_back( anguloFatia / (2*M_PI) ); textures.push_back( (proxAnguloStack + M_PI_2) / M_PI );
-			
-			//Triangulo de stacks intermédias que compõe um quadrado
-			p1 = Ponto(raio * cos(anguloStack) * sin(proxAnguloFatia), raio * sin(anguloStack), raio * cos(anguloStack) * cos(proxAnguloFatia));
-			p2 = Ponto(raio * cos(proxAnguloStack) * sin(proxAnguloFatia), raio * sin(proxAnguloStack), raio * cos(proxAnguloStack) * cos(proxAnguloFatia));
-			p3 = Ponto(raio * cos(proxAnguloStack) * sin(anguloFatia), raio * sin(proxAnguloStack), raio * cos(proxAnguloStack) * cos(anguloFatia));
+void torus(float innerRadius, float outerRadius, int slices, int stacks, Mesh* mesh, int nr_threads) {
+	MeshBuilder builder = MeshBuilder(mesh);
+	torus(innerRadius, outerRadius, slices, stacks, &builder, nr_threads);
+}
 
-			pontos.push_back(p1);
-			pontos.push_back(p2);
-			pontos.push_back(p3);
 
-			normals.push_back(vector_normalize_ponto(p1));
-			normals.push_back(vector_normalize_ponto(p2));
-			normals.push_back(vector_normalize_ponto(p3));
+// Unit icosahedron with a vertex at each pole and two rings of five vertices in between, 36 degrees apart
+static void icosahedron(vector<float>* points, vector<unsigned int>* triangles) {
+	float ringY = 1.0f / sqrt(5.0f);
+	float ringRadius = 2.0f / sqrt(5.0f);
 
-			textures.push_back( proxAnguloFatia / (2*M_PI) ); textures.push_back( (anguloStack + M_PI_2) / M_PI );
-			textures.push_back( proxAnguloFatia / (2*M_PI) ); textures.push_back( (proxAnguloStack + M_PI_2) / M_PI );
-			textures.push_back( anguloFatia / (2*M_PI) ); textures.push_back( (proxAnguloStack + M_PI_2) / M_PI );
+	*points = {0.0f, 1.0f, 0.0f};
+	for (int ring = 0; ring < 2; ring++) {
+		for (int i = 0; i < 5; i++) {
+			float angle = (2 * i + ring) * M_PI / 5;
+			points->push_back(ringRadius * sin(angle));
+			points->push_back(ring == 0 ? ringY : -ringY);
+			points->push_back(ringRadius * cos(angle));
+		}
+	}
+	points->insert(points->end(), {0.0f, -1.0f, 0.0f});
+
+	// Upper ring vertices are 1 to 5, lower ring vertices 6 to 10
+	triangles->clear();
+	for (unsigned int i = 0; i < 5; i++) {
+		unsigned int upper = 1 + i, nextUpper = 1 + (i + 1) % 5;
+		unsigned int lower = 6 + i, nextLower = 6 + (i + 1) % 5;
+		triangles->insert(triangles->end(), {0, upper, nextUpper});
+		triangles->insert(triangles->end(), {upper, lower, nextUpper});
+		triangles->insert(triangles->end(), {nextUpper, lower, nextLower});
+		triangles->insert(triangles->end(), {11, nextLower, lower});
+	}
+}
 
-			anguloStack += defaultAngleStack;
-			proxAnguloStack += defaultAngleStack;
+// Splits each triangle in four at the midpoints of its edges, pushed out to the unit sphere.
+// Edges shared by two triangles share their midpoint
+static void subdivideIcosphere(vector<float>* points, vector<unsigned int>* triangles) {
+	unordered_map<uint64_t, unsigned int> midpoints;
+	vector<unsigned int> subdivided;
+	subdivided.reserve(triangles->size() * 4);
+
+	auto midpoint = [&](unsigned int a, unsigned int b) {
+		uint64_t edge = a < b ? (uint64_t) a << 32 | b : (uint64_t) b << 32 | a;
+		auto found = midpoints.find(edge);
+		if (found != midpoints.end()) return found->second;
+
+		float p[3], length = 0.0f;
+		for (int c = 0; c < 3; c++) {
+			p[c] = (*points)[a * 3 + c] + (*points)[b * 3 + c];
+			length += p[c] * p[c];
 		}
+		length = sqrt(length);
+
+		unsigned int index = (unsigned int) (points->size() / 3);
+		for (int c = 0; c < 3; c++) points->push_back(p[c] / length);
+		midpoints[edge] = index;
+		return index;
+	};
+
+	for (size_t t = 0; t < triangles->size(); t += 3) {
+		unsigned int a = (*triangles)[t], b = (*triangles)[t + 1], c = (*triangles)[t + 2];
+		unsigned int ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+		subdivided.insert(subdivided.end(), {a, ab, ca, ab, b, bc, ca, bc, c, ab, bc, ca});
+	}
+	triangles->swap(subdivided);
+}
 
-		//Triângulos da última stack (mais em cima)
-		p1 = Ponto(0.0f, raio, 0.0f);
-		p2 = Ponto(raio * cos(anguloStack) * sin(proxAnguloFatia), raio * sin(anguloStack), raio * cos(anguloStack) * cos(proxAnguloFatia));
-		p3 = Ponto(raio * cos(anguloStack) * sin(anguloFatia), raio * sin(anguloStack), raio * cos(anguloStack) * cos(anguloFatia));
+// Creates a sphere from an icosahedron subdivided the given number of times, 20 * 4^subdivisions triangles
+// of about the same size. Texture coordinates follow the UV sphere. Triangles crossing the seam get copies of
+// their vertices with u + 1, and each triangle touching a pole gets its own pole vertex, in the middle of its u range
+void icosphere(float radius, int subdivisions, Mesh* mesh) {
+	vector<float> unit;
+	vector<unsigned int> triangles;
+	icosahedron(&unit, &triangles);
+	for (int i = 0; i < subdivisions; i++) subdivideIcosphere(&unit, &triangles);
+
+	size_t nrPoints = unit.size() / 3;
+	vector<float> u(nrPoints), v(nrPoints);
+	vector<bool> pole(nrPoints);
+	for (size_t i = 0; i < nrPoints; i++) {
+		const float* n = &unit[i * 3];
+		float angle = atan2(n[0], n[2]) / (2 * M_PI);
+		u[i] = angle < 0.0f ? angle + 1.0f : angle;
+		v[i] = 0.5f + asin(max(-1.0f, min(1.0f, n[1]))) / M_PI;
+		pole[i] = fabs(n[1]) >= 1.0f;
+	}
 
-		pontos.push_back(p1);
-		pontos.push_back(p2);
-		pontos.push_back(p3);
+	// Adds a copy of unit vertex i with texture coordinates (tu, v[i]), returning its index in the mesh
+	auto addVertex = [&](unsigned int i, float tu) {
+		const float* n = &unit[i * 3];
+		unsigned int index = mesh->addPoint(Ponto(radius * n[0], radius * n[1], radius * n[2]));
+		mesh->addNormal(Ponto(n[0], n[1], n[2]));
+		mesh->addTexture(tu, v[i]);
+		return index;
+	};
+
+	// Poles are only added with the triangles around them
+	vector<unsigned int> vertices(nrPoints);
+	for (size_t i = 0; i < nrPoints; i++) {
+		if (!pole[i]) vertices[i] = addVertex((unsigned int) i, u[i]);
+	}
 
-		normals.push_back(vector_normalize_ponto(p1));
-		normals.push_back(vector_normalize_ponto(p2));
-		normals.push_back(vector_normalize_ponto(p3));
+	unordered_map<unsigned int, unsigned int> seamCopies;
+	for (size_t t = 0; t < triangles.size(); t += 3) {
+		const unsigned int* corners = &triangles[t];
+		unsigned int indices[3];
+		float cornerU[3];
+		float minU = 1.0f, maxU = 0.0f;
+
+		for (int k = 0; k < 3; k++) {
+			cornerU[k] = u[corners[k]];
+			if (pole[corners[k]]) continue;
+			minU = min(minU, cornerU[k]);
+			maxU = max(maxU, cornerU[k]);
+		}
 
-		textures.push_back( anguloFatia / (2*M_PI) ); textures.push_back( 1.0 );
-		textures.push_back( proxAnguloFatia / (2*M_PI) ); textures.push_back( (anguloStack + M_PI_2) / M_PI );
-		textures.push_back( anguloFatia / (2*M_PI) ); textures.push_back( (anguloStack + M_PI_2) / M_PI );
+		bool seam = maxU - minU > 0.5f;
+		float sumU = 0.0f;
+		int nrSides = 0;
+		for (int k = 0; k < 3; k++) {
+			if (pole[corners[k]]) continue;
+			indices[k] = vertices[corners[k]];
+			if (seam && cornerU[k] < 0.5f) {
+				cornerU[k] += 1.0f;
+				auto found = seamCopies.find(corners[k]);
+				if (found == seamCopies.end()) found = seamCopies.emplace(corners[k], addVertex(corners[k], cornerU[k])).first;
+				indices[k] = found->second;
+			}
+			sumU += cornerU[k];
+			nrSides++;
+		}
 
-		anguloStack += defaultAngleStack;
-		proxAnguloStack += defaultAngleStack;
+		for (int k = 0; k < 3; k++) {
+			if (pole[corners[k]]) indices[k] = addVertex(corners[k], sumU / nrSides);
+		}
+		mesh->addTriangle(indices[0], indices[1], indices[2]);
 	}
+}
 
-	*ps = pontos;
-	*ns = normals;
-	*ts = textures;
+// Largest distance between a circle of given radius and the polygon of nrSegments sides inscribed in it
+static float erroCorda(float raio, int nrSegmentos) {
+	return raio * (1.0 - cos(M_PI / nrSegmentos));
 }
 
+// Limites do erro de cada primitiva, a maior distância entre os triângulos gerados e a superfície real.
+// Em cada direção a superfície afasta-se no máximo a flecha da corda entre dois pontos da grelha
+float sphereError(float raio, int nrSlices, int nrStacks) {
+	return erroCorda(raio, nrSlices) + erroCorda(raio, 2 * nrStacks);
+}
 
-// Torus auxiliary function to generate a point in the surface
-Ponto generateTorusPoint(float innerRadius, float outerRadius , float alpha, float beta) {
-	return Ponto(cos(alpha) * (innerRadius * sin(beta) + outerRadius),
-					-cos(beta) * innerRadius,
-					sin(alpha) * (innerRadius * sin(beta) + outerRadius));
+float coneError(float raioBase, int nrSlices) {
+	return erroCorda(raioBase, nrSlices);
 }
 
-// Torus auxiliary function to generate a point in the middle of its interior
-Ponto generateTorusCenterPoint(float alpha, float outerRadius) {
-	return Ponto(cos(alpha) * outerRadius, 0.0, sin(alpha) * outerRadius);
+float torusError(float innerRadius, float outerRadius, int slices, int stacks) {
+	return erroCorda(outerRadius + innerRadius, slices) + erroCorda(innerRadius, stacks);
 }
 
-// Creates a torus centered on origin
-void torus(float innerRadius, float outerRadius, int slices, int stacks, vector<Ponto>* ps, vector<Ponto>* ns, vector<float>* ts) {
-	
-	vector<Ponto> points;
-	vector<Ponto> normals;
-	vector<float> textures;
+// Every face of the icosahedron is subdivided the same way, so the error of the whole sphere is the error of one
+// face: the radius minus the distance to the plane of its flattest triangle
+float icosphereError(float radius, int subdivisions) {
+	vector<float> points;
+	vector<unsigned int> triangles;
+	icosahedron(&points, &triangles);
+	triangles.resize(3);
+	for (int i = 0; i < subdivisions; i++) subdivideIcosphere(&points, &triangles);
+
+	double closest = 1.0;
+	for (size_t t = 0; t < triangles.size(); t += 3) {
+		const float* a = &points[triangles[t] * 3];
+		const float* b = &points[triangles[t + 1] * 3];
+		const float* c = &points[triangles[t + 2] * 3];
+		double ab[3], ac[3];
+		for (int k = 0; k < 3; k++) {
+			ab[k] = b[k] - a[k];
+			ac[k] = c[k] - a[k];
+		}
+		double n[3] = {ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0]};
+		double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		closest = min(closest, fabs(n[0] * a[0] + n[1] * a[1] + n[2] * a[2]) / length);
+	}
+	return (float) (radius * (1.0 - closest));
+}
 
-	float alpha, alpha2, beta, beta2;
+// Checks that the divisions of a shape are between minimum and maximum, printing why they aren't otherwise.
+// Shared by the generator and the engine, so both reject the same shapes
+bool validDivisions(const char* name, int value, int minimum, int maximum) {
+	if (value >= minimum && value <= maximum) return true;
+	cout << "Invalid " << name << ": " << value;
+	if (maximum == INT_MAX) cout << ", must be at least " << minimum << "\n";
+	else cout << ", must be from " << minimum << " to " << maximum << "\n";
+	return false;
+}
 
-	float sliceAngle = (2 * M_PI) / slices;
-	float stackAngle = (2 * M_PI) / stacks;
+// Fewest subdivisions of an icosphere within error of the real sphere, up to ICOSPHERE_MAX_SUBDIVISIONS
+int icosphereSubdivisions(float radius, float error) {
+	int subdivisions = 0;
+	while (subdivisions < ICOSPHERE_MAX_SUBDIVISIONS && icosphereError(radius, subdivisions) > error) subdivisions++;
+	return subdivisions;
+}
 
-	// Process each slice
-	for (int i = 0; i < slices; i++) {
-		alpha = i * sliceAngle;
-		alpha2 = (i+1) * sliceAngle;
-
-		// Process each stack
-		for (int j = 0; j < stacks; j++) {
-			beta = j * stackAngle;
-			beta2 = (j+1) * stackAngle;
-
-			// Generates all four points associated to this slice and stack
-			Ponto p1 = generateTorusPoint(innerRadius, outerRadius, alpha, beta);
-			Ponto p2 = generateTorusPoint(innerRadius, outerRadius, alpha, beta2);
-			Ponto p3 = generateTorusPoint(innerRadius, outerRadius, alpha2, beta2);
-			Ponto p4 = generateTorusPoint(innerRadius, outerRadius, alpha2, beta);
-
-			// Adds the points of the two triangles associated to this slice and stack
-			points.push_back(p1);
-			points.push_back(p2);
-			points.push_back(p3);
-
-			points.push_back(p1);
-			points.push_back(p3);
-			points.push_back(p4);
-
-			// Adds the normals of the two triangles associated to this slice and stack
-			Ponto c_p1 = generateTorusCenterPoint(alpha, outerRadius);
-			Ponto c_p2 = generateTorusCenterPoint(alpha2, outerRadius);
-
-			normals.push_back(vector_normalize_ponto(vector_sub_ponto(p1, c_p1)));
-			normals.push_back(vector_normalize_ponto(vector_sub_ponto(p2, c_p1)));
-			normals.push_back(vector_normalize_ponto(vector_sub_ponto(p3, c_p2)));
-			
-			normals.push_back(vector_normalize_ponto(vector_sub_ponto(p1, c_p1)));
-			normals.push_back(vector_normalize_ponto(vector_sub_ponto(p3, c_p2)));
-			normals.push_back(vector_normalize_ponto(vector_sub_ponto(p4, c_p2)));
-
-			// Adds the textures coordinates of the two triangles associated to this slice and stack
-			textures.push_back( beta / (2*M_PI) );
-			textures.push_back( alpha / (2*M_PI) );
-
-			textures.push_back( beta2 / (2*M_PI) );
-			textures.push_back( alpha / (2*M_PI) );
-
-			textures.push_back( beta2 / (2*M_PI) );
-			textures.push_back( alpha2 / (2*M_PI) );
-		
-
-			textures.push_back( beta / (2*M_PI) );
-			textures.push_back( alpha / (2*M_PI) );
-
-			textures.push_back( beta2 / (2*M_PI) );
-			textures.push_back( alpha2 / (2*M_PI) );
-
-			textures.push_back( beta / (2*M_PI) );
-			textures.push_back( alpha2 / (2*M_PI) );
+// Slices and stacks of the UV sphere with the fewest triangles within error of the real sphere.
+// Returns false if no sphere of up to ICOSPHERE_MAX_SLICES slices is that close
+bool sphereDivisions(float raio, float erro, int* nrSlices, int* nrStacks) {
+	long long melhor = -1;
+
+	for (int slices = 3; slices <= ICOSPHERE_MAX_SLICES; slices++) {
+		float resto = erro - erroCorda(raio, slices);
+		if (resto <= 0.0f) continue;
+
+		// Menor número de stacks com erroCorda(raio, 2 * stacks) <= resto
+		int stacks = max(2, (int) ceil(M_PI / (2 * acos(max(-1.0, 1.0 - resto / raio)))));
+		while (stacks > 2 && erroCorda(raio, 2 * (stacks - 1)) <= resto) stacks--;
+		while (erroCorda(raio, 2 * stacks) > resto) stacks++;
+
+		long long triangulos = (long long) slices * (2 * stacks - 2);
+		if (melhor < 0 || triangulos < melhor) {
+			melhor = triangulos;
+			*nrSlices = slices;
+			*nrStacks = stacks;
 		}
 	}
-
-	*ps = points;
-	*ns = normals;
-	*ts = textures;
+	return melhor >= 0;
 }
@@ -2,13 +2,45 @@
 #define PRIMITIVES_H
 
 #include <vector>
+#include <climits>
 
 #include "../utils/ponto.h"
+#include "../utils/mesh.h"
 
-vector<Ponto> plane(float size);
-vector<Ponto> box(float dimX, float dimY, float dimZ, int nrDivisoes);
-vector<Ponto> cone(float raioBase, float alturaCone, int nrSlices, int nrStacks);
-void sphere(float raio, int nrSlices, int nrStacks, vector<Ponto>* pontos, vector<Ponto>* normals, vector<float>* ts);
-void torus(float innerRadius, float outerRadius, int slices, int stacks, vector<Ponto>* ps, vector<Ponto>* ns, vector<float>* ts);
+// Fewest divisions of each shape, fewer give no triangles or points that aren't numbers
+#define BOX_MIN_DIVISIONS 1
+#define CONE_MIN_SLICES 3
+#define CONE_MIN_STACKS 1
+#define SPHERE_MIN_SLICES 3
+#define SPHERE_MIN_STACKS 2
+#define TORUS_MIN_SLICES 3
+#define TORUS_MIN_STACKS 3
+#define BEZIER_MIN_TESSELLATION 1
+// Largest icosphere subdivision chosen for an error, 20 * 4^8 triangles
+#define ICOSPHERE_MAX_SUBDIVISIONS 8
+// Largest number of slices of the UV sphere compared with an icosphere
+#define ICOSPHERE_MAX_SLICES 4096
+// Spheres and toruses with fewer quads are generated by one thread, as starting the others costs more
+#define PRIMITIVE_PARALLEL_MIN_QUADS 65536
+// Slices each thread of the pool fills per batch, sent to the sink in order while the next batch is filled
+#define PRIMITIVE_SLICES_PER_THREAD 16
+
+void plane(float size, Mesh* mesh);
+void box(float dimX, float dimY, float dimZ, int nrDivisoes, Mesh* mesh);
+void cone(float raioBase, float alturaCone, int nrSlices, int nrStacks, Mesh* mesh);
+void sphere(float raio, int nrSlices, int nrStacks, Mesh* mesh, int nr_threads = 1);
+void sphere(float raio, int nrSlices, int nrStacks, MeshSink* sink, int nr_threads = 1);
+void torus(float innerRadius, float outerRadius, int slices, int stacks, Mesh* mesh, int nr_threads = 1);
+void torus(float innerRadius, float outerRadius, int slices, int stacks, MeshSink* sink, int nr_threads = 1);
+void icosphere(float radius, int subdivisions, Mesh* mesh);
+
+float sphereError(float raio, int nrSlices, int nrStacks);
+float coneError(float raioBase, int nrSlices);
+float torusError(float innerRadius, float outerRadius, int slices, int stacks);
+float icosphereError(float radius, int subdivisions);
+
+bool validDivisions(const char* name, int value, int minimum, int maximum = INT_MAX);
+int icosphereSubdivisions(float radius, float error);
+bool sphereDivisions(float raio, float erro, int* nrSlices, int* nrStacks);
 
 #endif //PRIMITIVES_H
@@ -0,0 +1,447 @@
+#include <vector>
+#include <queue>
+#include <unordered_map>
+#include <algorithm>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "simplify.h"
+
+using namespace std;
+
+// Symmetric 4x4 matrix summing the squared distances to a set of planes
+class Quadric {
+    public:
+        double q[10] = {0.0};   // aa ab ac ad bb bc bd cc cd dd
+
+        void addPlane(double a, double b, double c, double d) {
+            q[0] += a * a; q[1] += a * b; q[2] += a * c; q[3] += a * d;
+            q[4] += b * b; q[5] += b * c; q[6] += b * d;
+            q[7] += c * c; q[8] += c * d;
+            q[9] += d * d;
+        };
+        void add(const Quadric& other) {
+            for (int i = 0; i < 10; i++) q[i] += other.q[i];
+        };
+        double evaluate(const float* p) const {
+            double x = p[0], y = p[1], z = p[2];
+            double error = q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x
+                         + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y
+                         + q[7] * z * z + 2 * q[8] * z
+                         + q[9];
+            return error > 0.0 ? error : 0.0;
+        };
+};
+
+// Point, normal and texture coordinates of a vertex, compared by value so 0 and -0 are the same
+class VertexKey {
+    public:
+        float values[8];
+        int size = 0;
+
+        void add(const float* data, int count) {
+            for (int i = 0; i < count; i++) this->values[this->size++] = data[i] + 0.0f;
+        };
+        bool operator==(const VertexKey& other) const {
+            if (this->size != other.size) return false;
+            for (int i = 0; i < this->size; i++) {
+                if (this->values[i] != other.values[i]) return false;
+            }
+            return true;
+        };
+};
+
+class VertexKeyHash {
+    public:
+        size_t operator()(const VertexKey& key) const {
+            size_t hash = 14695981039346656037ULL;
+            for (int i = 0; i < key.size; i++) {
+                uint32_t bits;
+                memcpy(&bits, &key.values[i], sizeof(bits));
+                hash = (hash ^ bits) * 1099511628211ULL;
+            }
+            return hash;
+        };
+};
+
+// Collapse of every vertex at position from into the vertices at position to. Edges are queued in their
+// cheapest direction, the other one is only queued if that fails (reversed)
+class Collapse {
+    public:
+        float cost;
+        unsigned int from, to;
+        unsigned int stamp;     // sum of the stamps of both positions when queued
+        bool reversed;
+
+        bool operator>(const Collapse& other) const {return this->cost > other.cost;};
+};
+
+static void cross(const float* u, const float* v, float* out) {
+    out[0] = u[1] * v[2] - u[2] * v[1];
+    out[1] = u[2] * v[0] - u[0] * v[2];
+    out[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+static void triangleNormal(const float* a, const float* b, const float* c, float* normal) {
+    float u[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    float v[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    cross(u, v, normal);
+}
+
+// Mesh being simplified. Vertices keep their attributes, positions group the vertices with the same
+// point, which differ in normals or texture coordinates along seams. Collapses move positions, so a
+// seam only collapses along itself, when every vertex of the removed position has a match at the other
+class Simplifier {
+    private:
+        Mesh* mesh;
+        vector<unsigned int> vertex_position;   // position of each vertex
+        vector<float> positions;                // x, y, z of each position
+        vector<unsigned int> triangles;         // three vertices per triangle
+        vector<bool> triangle_alive;
+        vector<vector<unsigned int>> position_triangles;
+        vector<Quadric> quadrics;
+        vector<unsigned int> stamps;
+        vector<bool> removed, border, locked;
+        priority_queue<Collapse, vector<Collapse>, greater<Collapse>> collapses;
+        vector<unsigned int> edge_triangles, to_neighbours, shared, from_neighbours;    // kept between collapses to reuse their memory
+        vector<pair<unsigned int, unsigned int>> vertex_map;
+        unsigned int live_triangles = 0;
+
+        unsigned int positionAt(unsigned int triangle, int corner) {return this->vertex_position[this->triangles[triangle * 3 + corner]];};
+        const float* point(unsigned int position) {return &this->positions[position * 3];};
+
+        void weld();
+        void buildQuadrics();
+        vector<unsigned int>& liveTriangles(unsigned int position);
+        void pushCollapse(unsigned int from, unsigned int to, float cost, bool reversed);
+        void pushEdge(unsigned int p0, unsigned int p1);
+        bool tryCollapse(const Collapse& collapse, double* error);
+    public:
+        Simplifier(Mesh* mesh) {this->mesh = mesh;};
+        float simplify(unsigned int target_triangles);
+        void output(Mesh* simplified);
+        unsigned int getTriangleCount() {return this->live_triangles;};
+};
+
+// Merges vertices with the same attributes and groups them by position. Degenerate triangles are dropped
+void Simplifier::weld() {
+    Mesh* mesh = this->mesh;
+    bool normals = !mesh->normals.empty(), textures = !mesh->textures.empty();
+    unordered_map<VertexKey, unsigned int, VertexKeyHash> vertex_ids, position_ids;
+    vector<unsigned int> vertex_map(mesh->getVerticeCount());
+    this->vertex_position.resize(mesh->getVerticeCount());
+
+    for (unsigned int v = 0; v < mesh->getVerticeCount(); v++) {
+        VertexKey point, key;
+        point.add(&mesh->points[v * 3], 3);
+        key = point;
+        if (normals) key.add(&mesh->normals[v * 3], 3);
+        if (textures) key.add(&mesh->textures[v * 2], 2);
+
+        auto vertex = vertex_ids.emplace(key, v);
+        vertex_map[v] = vertex.first->second;
+        if (!vertex.second) continue;
+
+        auto position = position_ids.emplace(point, (unsigned int) this->positions.size() / 3);
+        if (position.second) this->positions.insert(this->positions.end(), point.values, point.values + 3);
+        this->vertex_position[v] = position.first->second;
+    }
+
+    for (size_t i = 0; i + 2 < mesh->indices.size(); i += 3) {
+        unsigned int a = vertex_map[mesh->indices[i]], b = vertex_map[mesh->indices[i + 1]], c = vertex_map[mesh->indices[i + 2]];
+        unsigned int pa = this->vertex_position[a], pb = this->vertex_position[b], pc = this->vertex_position[c];
+        if (pa == pb || pb == pc || pa == pc) continue;
+
+        this->triangles.push_back(a);
+        this->triangles.push_back(b);
+        this->triangles.push_back(c);
+    }
+
+    unsigned int nr_positions = (unsigned int) this->positions.size() / 3;
+    unsigned int nr_triangles = (unsigned int) this->triangles.size() / 3;
+    this->live_triangles = nr_triangles;
+    this->triangle_alive.assign(nr_triangles, true);
+    this->position_triangles.resize(nr_positions);
+    for (unsigned int t = 0; t < nr_triangles; t++) {
+        for (int corner = 0; corner < 3; corner++) this->position_triangles[positionAt(t, corner)].push_back(t);
+    }
+
+    this->quadrics.resize(nr_positions);
+    this->stamps.assign(nr_positions, 0);
+    this->removed.assign(nr_positions, false);
+    this->border.assign(nr_positions, false);
+    this->locked.assign(nr_positions, false);
+}
+
+// Each position starts with the planes of its triangles. Border and seam edges add a plane perpendicular
+// to their triangle, so collapses along them keep their shape. Then every edge is queued for collapse
+void Simplifier::buildQuadrics() {
+    unsigned int nr_triangles = (unsigned int) this->triangles.size() / 3;
+    unordered_map<unsigned long long, vector<unsigned int>> edges;   // triangles of each edge, by its positions
+    vector<unsigned long long> edge_list;
+
+    for (unsigned int t = 0; t < nr_triangles; t++) {
+        float normal[3];
+        triangleNormal(point(positionAt(t, 0)), point(positionAt(t, 1)), point(positionAt(t, 2)), normal);
+        double length = sqrt((double) normal[0] * normal[0] + (double) normal[1] * normal[1] + (double) normal[2] * normal[2]);
+        if (length == 0.0) continue;
+
+        double a = normal[0] / length, b = normal[1] / length, c = normal[2] / length;
+        const float* p = point(positionAt(t, 0));
+        double d = -(a * p[0] + b * p[1] + c * p[2]);
+        for (int corner = 0; corner < 3; corner++) this->quadrics[positionAt(t, corner)].addPlane(a, b, c, d);
+
+        for (int corner = 0; corner < 3; corner++) {
+            unsigned int p0 = positionAt(t, corner), p1 = positionAt(t, (corner + 1) % 3);
+            unsigned long long key = ((unsigned long long) min(p0, p1) << 32) | max(p0, p1);
+            edges[key].push_back(t);
+        }
+    }
+
+    for (auto& edge : edges) {
+        unsigned int p0 = (unsigned int) (edge.first >> 32), p1 = (unsigned int) edge.first;
+        vector<unsigned int>& edge_triangles = edge.second;
+        edge_list.push_back(edge.first);
+
+        // Edges shared by more than two triangles aren't collapsed
+        if (edge_triangles.size() > 2) {
+            this->locked[p0] = this->locked[p1] = true;
+            continue;
+        }
+
+        bool is_border = edge_triangles.size() == 1;
+        bool is_seam = false;
+        if (!is_border) {
+            for (int corner = 0; corner < 3; corner++) {
+                unsigned int position = positionAt(edge_triangles[0], corner);
+                if (position != p0 && position != p1) continue;
+                for (int other = 0; other < 3; other++) {
+                    if (positionAt(edge_triangles[1], other) == position &&
+                        this->triangles[edge_triangles[1] * 3 + other] != this->triangles[edge_triangles[0] * 3 + corner])
+                        is_seam = true;
+                }
+            }
+        }
+        if (!is_border && !is_seam) continue;
+        if (is_border) this->border[p0] = this->border[p1] = true;
+
+        // Plane through the edge, perpendicular to its first triangle
+        unsigned int t = edge_triangles[0];
+        float normal[3], direction[3], perpendicular[3];
+        triangleNormal(point(positionAt(t, 0)), point(positionAt(t, 1)), point(positionAt(t, 2)), normal);
+        for (int i = 0; i < 3; i++) direction[i] = point(p1)[i] - point(p0)[i];
+        cross(direction, normal, perpendicular);
+        double length = sqrt((double) perpendicular[0] * perpendicular[0] + (double) perpendicular[1] * perpendicular[1] +
+                             (double) perpendicular[2] * perpendicular[2]);
+        if (length == 0.0) continue;
+
+        double a = perpendicular[0] / length, b = perpendicular[1] / length, c = perpendicular[2] / length;
+        double d = -(a * point(p0)[0] + b * point(p0)[1] + c * point(p0)[2]);
+        this->quadrics[p0].addPlane(a, b, c, d);
+        this->quadrics[p1].addPlane(a, b, c, d);
+    }
+
+    // Every edge can collapse
+    for (unsigned long long edge : edge_list) {
+        pushEdge((unsigned int) (edge >> 32), (unsigned int) edge);
+    }
+}
+
+// Triangles still using a position, dropping the removed ones from its list
+vector<unsigned int>& Simplifier::liveTriangles(unsigned int position) {
+    vector<unsigned int>& list = this->position_triangles[position];
+    size_t live = 0;
+
+    for (unsigned int t : list) {
+        if (this->triangle_alive[t]) list[live++] = t;
+    }
+    list.resize(live);
+    return list;
+}
+
+void Simplifier::pushCollapse(unsigned int from, unsigned int to, float cost, bool reversed) {
+    Collapse collapse;
+    collapse.cost = cost;
+    collapse.from = from;
+    collapse.to = to;
+    collapse.stamp = this->stamps[from] + this->stamps[to];
+    collapse.reversed = reversed;
+    this->collapses.push(collapse);
+}
+
+void Simplifier::pushEdge(unsigned int p0, unsigned int p1) {
+    Quadric quadric = this->quadrics[p0];
+    quadric.add(this->quadrics[p1]);
+    float to_p1 = (float) quadric.evaluate(point(p1)), to_p0 = (float) quadric.evaluate(point(p0));
+
+    if (this->locked[p0] && this->locked[p1]) return;
+    if (this->locked[p0] || (!this->locked[p1] && to_p0 < to_p1)) pushCollapse(p1, p0, to_p0, false);
+    else pushCollapse(p0, p1, to_p1, false);
+}
+
+// Collapses unless it would change the topology, move a border or seam away from itself or flip a triangle
+bool Simplifier::tryCollapse(const Collapse& collapse, double* error) {
+    unsigned int from = collapse.from, to = collapse.to;
+    vector<unsigned int>& from_triangles = liveTriangles(from);
+    vector<unsigned int>& to_triangles = liveTriangles(to);
+
+    // Triangles of the edge and the vertex each of its from vertices becomes
+    vector<unsigned int>& edge_triangles = this->edge_triangles;
+    vector<pair<unsigned int, unsigned int>>& vertex_map = this->vertex_map;
+    edge_triangles.clear();
+    vertex_map.clear();
+    for (unsigned int t : from_triangles) {
+        int from_corner = -1, to_corner = -1;
+        for (int corner = 0; corner < 3; corner++) {
+            if (positionAt(t, corner) == from) from_corner = corner;
+            if (positionAt(t, corner) == to) to_corner = corner;
+        }
+        if (to_corner < 0) continue;
+
+        edge_triangles.push_back(t);
+        unsigned int from_vertex = this->triangles[t * 3 + from_corner], to_vertex = this->triangles[t * 3 + to_corner];
+        for (auto& mapping : vertex_map) {
+            if (mapping.first == from_vertex && mapping.second != to_vertex) return false;
+        }
+        vertex_map.push_back(make_pair(from_vertex, to_vertex));
+    }
+    if (edge_triangles.empty()) return false;
+    if (this->border[from] && edge_triangles.size() != 1) return false;
+
+    // Positions next to both ends can only be the third corner of the edge triangles
+    vector<unsigned int>& to_neighbours = this->to_neighbours;
+    to_neighbours.clear();
+    for (unsigned int t : to_triangles) {
+        for (int corner = 0; corner < 3; corner++) to_neighbours.push_back(positionAt(t, corner));
+    }
+    sort(to_neighbours.begin(), to_neighbours.end());
+    vector<unsigned int>& shared = this->shared;
+    shared.clear();
+    for (unsigned int t : from_triangles) {
+        for (int corner = 0; corner < 3; corner++) {
+            unsigned int position = positionAt(t, corner);
+            if (position != from && position != to && binary_search(to_neighbours.begin(), to_neighbours.end(), position))
+                shared.push_back(position);
+        }
+    }
+    sort(shared.begin(), shared.end());
+    if (unique(shared.begin(), shared.end()) - shared.begin() != (long) edge_triangles.size()) return false;
+
+    // Every vertex at from needs a match at to, and no remaining triangle can turn around
+    for (unsigned int t : from_triangles) {
+        int from_corner = 0;
+        bool in_edge = false;
+        for (int corner = 0; corner < 3; corner++) {
+            if (positionAt(t, corner) == from) from_corner = corner;
+            if (positionAt(t, corner) == to) in_edge = true;
+        }
+        if (in_edge) continue;
+
+        unsigned int from_vertex = this->triangles[t * 3 + from_corner];
+        bool mapped = false;
+        for (auto& mapping : vertex_map) mapped = mapped || mapping.first == from_vertex;
+        if (!mapped) return false;
+
+        const float* corners[3] = {point(positionAt(t, 0)), point(positionAt(t, 1)), point(positionAt(t, 2))};
+        float before[3], after[3];
+        triangleNormal(corners[0], corners[1], corners[2], before);
+        corners[from_corner] = point(to);
+        triangleNormal(corners[0], corners[1], corners[2], after);
+        if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0f) return false;
+    }
+
+    // Collapse
+    vector<unsigned int>& from_neighbours = this->from_neighbours;
+    from_neighbours.clear();
+    for (unsigned int t : from_triangles) {
+        for (int corner = 0; corner < 3; corner++) {
+            unsigned int position = positionAt(t, corner);
+            if (position != from && position != to) from_neighbours.push_back(position);
+        }
+    }
+    for (unsigned int t : edge_triangles) {
+        this->triangle_alive[t] = false;
+        this->live_triangles--;
+    }
+    for (unsigned int t : from_triangles) {
+        if (!this->triangle_alive[t]) continue;
+        for (int corner = 0; corner < 3; corner++) {
+            unsigned int& vertex = this->triangles[t * 3 + corner];
+            if (this->vertex_position[vertex] != from) continue;
+            for (auto& mapping : vertex_map) {
+                if (mapping.first == vertex) {
+                    vertex = mapping.second;
+                    break;
+                }
+            }
+        }
+        this->position_triangles[to].push_back(t);
+    }
+    this->quadrics[to].add(this->quadrics[from]);
+    this->removed[from] = true;
+    this->stamps[to]++;
+    *error = max(*error, (double) collapse.cost);
+
+    // Edges to the neighbours of from are new edges of to. Older collapses with to have a stale cost,
+    // which only grows as quadrics are added, so they're updated when they reach the top of the queue
+    sort(from_neighbours.begin(), from_neighbours.end());
+    from_neighbours.erase(unique(from_neighbours.begin(), from_neighbours.end()), from_neighbours.end());
+    for (unsigned int position : from_neighbours) pushEdge(position, to);
+
+    return true;
+}
+
+float Simplifier::simplify(unsigned int target_triangles) {
+    weld();
+    buildQuadrics();
+
+    double error = 0.0;
+    while (this->live_triangles > target_triangles && !this->collapses.empty()) {
+        Collapse collapse = this->collapses.top();
+        this->collapses.pop();
+
+        if (this->removed[collapse.from] || this->removed[collapse.to]) continue;
+        if (collapse.stamp != this->stamps[collapse.from] + this->stamps[collapse.to]) {
+            pushEdge(collapse.from, collapse.to);
+            continue;
+        }
+
+        if (!tryCollapse(collapse, &error) && !collapse.reversed && !this->locked[collapse.to]) {
+            Quadric quadric = this->quadrics[collapse.from];
+            quadric.add(this->quadrics[collapse.to]);
+            pushCollapse(collapse.to, collapse.from, (float) quadric.evaluate(point(collapse.from)), true);
+        }
+    }
+
+    return (float) sqrt(error);
+}
+
+// Copies the remaining triangles and the vertices they use
+void Simplifier::output(Mesh* simplified) {
+    Mesh* mesh = this->mesh;
+    bool normals = !mesh->normals.empty(), textures = !mesh->textures.empty();
+    vector<unsigned int> new_index(mesh->getVerticeCount(), (unsigned int) -1);
+
+    for (unsigned int t = 0; t < this->triangle_alive.size(); t++) {
+        if (!this->triangle_alive[t]) continue;
+
+        for (int corner = 0; corner < 3; corner++) {
+            unsigned int vertex = this->triangles[t * 3 + corner];
+            if (new_index[vertex] == (unsigned int) -1) {
+                new_index[vertex] = simplified->getVerticeCount();
+                simplified->points.insert(simplified->points.end(), &mesh->points[vertex * 3], &mesh->points[vertex * 3] + 3);
+                if (normals) simplified->normals.insert(simplified->normals.end(), &mesh->normals[vertex * 3], &mesh->normals[vertex * 3] + 3);
+                if (textures) simplified->textures.insert(simplified->textures.end(), &mesh->textures[vertex * 2], &mesh->textures[vertex * 2] + 2);
+            }
+            simplified->indices.push_back(new_index[vertex]);
+        }
+    }
+}
+
+float simplifyMesh(Mesh* mesh, float ratio, Mesh* simplified) {
+    Simplifier simplifier(mesh);
+    float error = simplifier.simplify((unsigned int) (mesh->getTriangleCount() * ratio));
+    simplifier.output(simplified);
+    return error;
+}
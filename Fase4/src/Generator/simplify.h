@@ -0,0 +1,12 @@
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+#include "../utils/mesh.h"
+
+using namespace std;
+
+// Quadric error edge-collapse decimation of mesh into simplified, keeping about ratio of its triangles.
+// Returns the error of the simplified mesh, the square root of its largest quadric error
+float simplifyMesh(Mesh* mesh, float ratio, Mesh* simplified);
+
+#endif //SIMPLIFY_H
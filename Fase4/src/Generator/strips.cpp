@@ -0,0 +1,141 @@
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+#include "strips.h"
+
+using namespace std;
+
+// Triangles of a range of indices, found by their directed edges. Every triangle (a, b, c) has the edges
+// a -> b, b -> c and c -> a, so the neighbour sharing an edge with the same winding has it the other way around
+class DirectedEdges {
+    private:
+        unordered_map<uint64_t, unsigned int> triangles;
+
+        static uint64_t key(unsigned int from, unsigned int to) {return (uint64_t) from << 32 | to;};
+    public:
+        DirectedEdges(const unsigned int* indices, unsigned int triangle_count) {
+            this->triangles.reserve(triangle_count * 3);
+            for (unsigned int t = 0; t < triangle_count; t++) {
+                const unsigned int* v = &indices[t * 3];
+                for (int e = 0; e < 3; e++) this->triangles.emplace(key(v[e], v[(e + 1) % 3]), t);
+            }
+        };
+
+        // Triangle with the edge from -> to, or -1 if there's none
+        long long find(unsigned int from, unsigned int to) const {
+            auto found = this->triangles.find(key(from, to));
+            return found == this->triangles.end() ? -1 : (long long) found->second;
+        };
+};
+
+// Corner of triangle t that isn't from or to
+static unsigned int thirdCorner(const unsigned int* indices, unsigned int t, unsigned int from, unsigned int to) {
+    const unsigned int* v = &indices[t * 3];
+    for (int c = 0; c < 3; c++) {
+        if (v[c] != from && v[c] != to) return v[c];
+    }
+    return v[0];
+}
+
+// Extends the strip starting with triangle start, rotated so its first corner is rotation, as far as possible.
+// The i-th triangle of a strip is (s[i], s[i+1], s[i+2]) if i is even and (s[i+1], s[i], s[i+2]) if it's odd, so
+// the next triangle must have the edge s[n-2] -> s[n-1] or s[n-1] -> s[n-2]. Triangles used are stamped with stamp
+static void growStrip(const unsigned int* indices, const DirectedEdges& edges, unsigned int start, int rotation,
+                      vector<unsigned int>& stamps, unsigned int stamp, vector<unsigned int>* strip) {
+    const unsigned int* v = &indices[start * 3];
+    strip->assign({v[rotation], v[(rotation + 1) % 3], v[(rotation + 2) % 3]});
+    stamps[start] = stamp;
+
+    while (true) {
+        size_t n = strip->size();
+        unsigned int a = (*strip)[n - 2], b = (*strip)[n - 1];
+        bool even = (n - 2) % 2 == 0;
+        long long next = even ? edges.find(a, b) : edges.find(b, a);
+        if (next < 0 || stamps[next] == stamp || stamps[next] == UINT32_MAX) break;
+
+        stamps[next] = stamp;
+        strip->push_back(thirdCorner(indices, (unsigned int) next, a, b));
+    }
+}
+
+// Strips of a range of triangle_count triangles, appended to strips with a restart index between them
+static unsigned int stripRange(const unsigned int* indices, unsigned int triangle_count, vector<unsigned int>* strips) {
+    DirectedEdges edges(indices, triangle_count);
+
+    // Triangles already in a strip are UINT32_MAX, the others the last trial that used them
+    vector<unsigned int> stamps(triangle_count, 0);
+    unsigned int stamp = 0, strip_count = 0;
+    vector<unsigned int> strip, best;
+
+    for (unsigned int t = 0; t < triangle_count; t++) {
+        if (stamps[t] == UINT32_MAX) continue;
+
+        // The rotation of the first triangle giving the longest strip
+        best.clear();
+        for (int rotation = 0; rotation < 3; rotation++) {
+            growStrip(indices, edges, t, rotation, stamps, ++stamp, &strip);
+            if (strip.size() > best.size()) best.swap(strip);
+        }
+
+        // Marks the triangles of the chosen strip as used, following it again
+        for (size_t i = 0; i + 2 < best.size(); i++) {
+            long long triangle = i % 2 == 0 ? edges.find(best[i], best[i + 1]) : edges.find(best[i + 1], best[i]);
+            if (i == 0) triangle = t;
+            stamps[triangle] = UINT32_MAX;
+        }
+
+        if (strip_count > 0) strips->push_back(MESH_RESTART_INDEX);
+        strips->insert(strips->end(), best.begin(), best.end());
+        strip_count++;
+    }
+    return strip_count;
+}
+
+StripStats buildStrips(Mesh* mesh) {
+    StripStats stats;
+    stats.indices_before = (unsigned int) mesh->indices.size();
+
+    vector<MeshLOD> lods = mesh->lods;
+    if (lods.empty()) {
+        MeshLOD whole;
+        whole.index_count = (unsigned int) mesh->indices.size();
+        lods.push_back(whole);
+    }
+
+    vector<unsigned int> strips;
+    strips.reserve(mesh->indices.size() / 2);
+    for (MeshLOD& lod : lods) {
+        unsigned int first_index = (unsigned int) strips.size();
+        stats.strips += stripRange(&mesh->indices[lod.first_index], lod.index_count / 3, &strips);
+        lod.first_index = first_index;
+        lod.index_count = (unsigned int) strips.size() - first_index;
+    }
+
+    if (!mesh->lods.empty()) mesh->lods = lods;
+    mesh->indices.swap(strips);
+    mesh->strips = true;
+    stats.indices_after = (unsigned int) mesh->indices.size();
+    return stats;
+}
+
+void stripsToTriangles(const unsigned int* indices, size_t count, unsigned int restart_index, vector<unsigned int>* triangles) {
+    size_t strip_start = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (indices[i] == restart_index) {
+            strip_start = i + 1;
+            continue;
+        }
+        if (i < strip_start + 2) continue;
+
+        unsigned int a = indices[i - 2], b = indices[i - 1], c = indices[i];
+        if ((i - strip_start) % 2 == 1) swap(a, b);
+        if (a == b || b == c || c == a) continue;
+        triangles->insert(triangles->end(), {a, b, c});
+    }
+}
+
+void MeshStripifier::end() {
+    this->stats = buildStrips(&this->mesh);
+    this->mesh.writeTo(this->sink);
+}
@@ -0,0 +1,48 @@
+#ifndef STRIPS_H
+#define STRIPS_H
+
+#include <vector>
+
+#include "../utils/mesh.h"
+
+using namespace std;
+
+// Number of strips and indices of a mesh converted to triangle strips
+class StripStats {
+    public:
+        unsigned int strips = 0;
+        unsigned int indices_before = 0;
+        unsigned int indices_after = 0;
+};
+
+// Converts the triangles of each level of detail into triangle strips joined by MESH_RESTART_INDEX, following
+// neighbouring triangles so each row of a grid becomes one strip. Triangles keep their winding
+StripStats buildStrips(Mesh* mesh);
+
+// Appends the triangles of count strip indices to triangles, three indices each, in the winding they're drawn with
+void stripsToTriangles(const unsigned int* indices, size_t count, unsigned int restart_index, vector<unsigned int>* triangles);
+
+// Sink that gathers a whole mesh, converts it to triangle strips and only then gives it to another sink
+class MeshStripifier : public MeshSink {
+    private:
+        Mesh mesh;
+        MeshBuilder builder = MeshBuilder(&mesh);
+        MeshSink* sink;
+        StripStats stats;
+    public:
+        MeshStripifier(MeshSink* sink) {this->sink = sink;};
+
+        StripStats getStats() {return this->stats;};
+
+        void setLODs(const vector<MeshLOD>& lods) {this->mesh.lods = lods;};
+        void begin(unsigned int vertice_count, unsigned int index_count, bool normals, bool textures) {
+            this->builder.begin(vertice_count, index_count, normals, textures);
+        };
+        void points(const float* values, size_t count) {this->builder.points(values, count);};
+        void normals(const float* values, size_t count) {this->builder.normals(values, count);};
+        void textures(const float* values, size_t count) {this->builder.textures(values, count);};
+        void indices(const unsigned int* values, size_t count) {this->builder.indices(values, count);};
+        void end();
+};
+
+#endif //STRIPS_H
@@ -0,0 +1,288 @@
+#include <iostream>
+#include <fstream>
+#include <string.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "terrain.h"
+#include "mapped_file.h"
+#include "../utils/file3d.h"
+
+using namespace std;
+
+// Reads the next number of a PGM header, skipping white space and comments
+static bool readPGMNumber(const char** next, const char* end, int* value) {
+    const char* p = *next;
+    while (p < end && (isspace((unsigned char) *p) || *p == '#')) {
+        if (*p == '#') while (p < end && *p != '\n') p++;
+        else p++;
+    }
+    if (p == end || !isdigit((unsigned char) *p)) return false;
+
+    *value = 0;
+    while (p < end && isdigit((unsigned char) *p) && *value < (1 << 24)) *value = *value * 10 + (*p++ - '0');
+    *next = p;
+    return true;
+}
+
+// Reads a PGM heightmap, binary (P5) with 8 or 16-bit big-endian samples or text (P2)
+static bool readPGM(const char* data, const char* end, Heightmap* heightmap) {
+    if (end - data < 2 || data[0] != 'P' || (data[1] != '5' && data[1] != '2')) return false;
+    bool binary = data[1] == '5';
+
+    const char* p = data + 2;
+    int width, height, max_value;
+    if (!readPGMNumber(&p, end, &width) || !readPGMNumber(&p, end, &height) || !readPGMNumber(&p, end, &max_value))
+        return false;
+    if (width < 2 || height < 2 || max_value < 1 || max_value > 65535) return false;
+
+    heightmap->width = width;
+    heightmap->height = height;
+    heightmap->heights.resize((size_t) width * height);
+
+    if (binary) {
+        size_t sample_size = max_value < 256 ? 1 : 2;
+        const unsigned char* samples = (const unsigned char*) p + 1;   // a single white space ends the header
+        if ((const char*) samples + heightmap->heights.size() * sample_size > end) return false;
+
+        for (size_t i = 0; i < heightmap->heights.size(); i++) {
+            int value = sample_size == 1 ? samples[i] : samples[i * 2] << 8 | samples[i * 2 + 1];
+            heightmap->heights[i] = (float) value / max_value;
+        }
+        return true;
+    }
+
+    for (size_t i = 0; i < heightmap->heights.size(); i++) {
+        int value;
+        if (!readPGMNumber(&p, end, &value)) return false;
+        heightmap->heights[i] = (float) value / max_value;
+    }
+    return true;
+}
+
+// Reads a raw heightmap: a square of 8-bit samples, or of 16-bit little-endian samples, told apart by the file size
+static bool readRaw(const char* data, size_t size, Heightmap* heightmap) {
+    int side8 = (int) lround(sqrt((double) size));
+    int side16 = (int) lround(sqrt((double) size / 2));
+    bool wide = (size_t) side8 * side8 != size;
+    int side = wide ? side16 : side8;
+    if (wide && (size_t) side16 * side16 * 2 != size) return false;
+    if (side < 2) return false;
+
+    heightmap->width = side;
+    heightmap->height = side;
+    heightmap->heights.resize((size_t) side * side);
+
+    const unsigned char* samples = (const unsigned char*) data;
+    for (size_t i = 0; i < heightmap->heights.size(); i++)
+        heightmap->heights[i] = wide ? (samples[i * 2] | samples[i * 2 + 1] << 8) / 65535.0f : samples[i] / 255.0f;
+    return true;
+}
+
+// Reads a .pgm heightmap, or a raw one with any other extension
+bool readHeightmap(string heightmapFile, Heightmap* heightmap) {
+    MappedFile file;
+    if (!file.open(heightmapFile)) {
+        std::cout << "Unable to open file: " << heightmapFile.c_str() << "\n";
+        return false;
+    }
+
+    bool pgm = heightmapFile.size() > 4 && heightmapFile.compare(heightmapFile.size() - 4, 4, ".pgm") == 0;
+    bool valid = pgm ? readPGM(file.begin(), file.end(), heightmap) : readRaw(file.begin(), file.getSize(), heightmap);
+    if (!valid) std::cout << "Invalid heightmap: " << heightmapFile.c_str() << "\n";
+    return valid;
+}
+
+
+// Chunks cover the cells between the samples, chunk_cells of them in each direction except at the far borders
+int terrainChunksX(const Heightmap& heightmap, const TerrainParameters& parameters) {
+    return (heightmap.width - 2) / parameters.chunk_cells + 1;
+}
+
+int terrainChunksZ(const Heightmap& heightmap, const TerrainParameters& parameters) {
+    return (heightmap.height - 2) / parameters.chunk_cells + 1;
+}
+
+// Samples used by a level along one direction of a chunk: every step-th sample from first to last, and last
+static vector<int> levelSamples(int first, int last, int step) {
+    vector<int> samples;
+    for (int s = first; s < last; s += step) samples.push_back(s);
+    samples.push_back(last);
+    return samples;
+}
+
+// Samples of a chunk along x and z at a level
+static void chunkSamples(const Heightmap& heightmap, const TerrainParameters& parameters, int chunk_x, int chunk_z, int level,
+                         vector<int>* xs, vector<int>* zs) {
+    int step = 1 << level;
+    int first_x = chunk_x * parameters.chunk_cells, first_z = chunk_z * parameters.chunk_cells;
+    int last_x = min(first_x + parameters.chunk_cells, heightmap.width - 1);
+    int last_z = min(first_z + parameters.chunk_cells, heightmap.height - 1);
+    *xs = levelSamples(first_x, last_x, step);
+    *zs = levelSamples(first_z, last_z, step);
+}
+
+// Largest vertical distance between the heightmap and a level of a chunk. Cells are split along the diagonal from
+// (x + 1, z) to (x, z + 1), like the triangles of the chunk
+float terrainChunkError(const Heightmap& heightmap, const TerrainParameters& parameters, int chunk_x, int chunk_z, int level) {
+    vector<int> xs, zs;
+    chunkSamples(heightmap, parameters, chunk_x, chunk_z, level, &xs, &zs);
+    if (level == 0) return 0.0f;
+
+    float error = 0.0f;
+    for (size_t j = 0; j + 1 < zs.size(); j++) {
+        for (size_t i = 0; i + 1 < xs.size(); i++) {
+            float h00 = heightmap.at(xs[i], zs[j]), h10 = heightmap.at(xs[i + 1], zs[j]);
+            float h01 = heightmap.at(xs[i], zs[j + 1]), h11 = heightmap.at(xs[i + 1], zs[j + 1]);
+
+            for (int z = zs[j]; z <= zs[j + 1]; z++) {
+                for (int x = xs[i]; x <= xs[i + 1]; x++) {
+                    float s = (float) (x - xs[i]) / (xs[i + 1] - xs[i]);
+                    float t = (float) (z - zs[j]) / (zs[j + 1] - zs[j]);
+                    float h = s + t <= 1.0f ? h00 + s * (h10 - h00) + t * (h01 - h00)
+                                            : h11 + (1.0f - s) * (h01 - h11) + (1.0f - t) * (h10 - h11);
+                    error = max(error, fabsf(h - heightmap.at(x, z)));
+                }
+            }
+        }
+    }
+
+    return error * parameters.height;
+}
+
+// Adds a level of a chunk: a grid of the level's samples and a skirt hanging skirt_depth units down from its
+// borders, covering the cracks left by neighbours drawn with other levels
+static void addChunkLevel(const Heightmap& heightmap, const TerrainParameters& parameters, int chunk_x, int chunk_z, int level,
+                          float skirt_depth, Mesh* mesh) {
+    vector<int> xs, zs;
+    chunkSamples(heightmap, parameters, chunk_x, chunk_z, level, &xs, &zs);
+
+    float cell = parameters.size / (heightmap.width - 1);
+    float origin_x = -parameters.size / 2.0f, origin_z = -cell * (heightmap.height - 1) / 2.0f;
+    unsigned int first = mesh->getVerticeCount();
+    unsigned int columns = (unsigned int) xs.size(), rows = (unsigned int) zs.size();
+
+    // Normals from the central differences of the whole heightmap, the same at every level
+    auto addVertex = [&](int x, int z, float depth) {
+        float y = heightmap.at(x, z) * parameters.height - depth;
+        mesh->addPoint(Ponto(origin_x + x * cell, y, origin_z + z * cell));
+
+        float dx = (heightmap.at(x + 1, z) - heightmap.at(x - 1, z)) * parameters.height / (2.0f * cell);
+        float dz = (heightmap.at(x, z + 1) - heightmap.at(x, z - 1)) * parameters.height / (2.0f * cell);
+        float length = sqrtf(dx * dx + 1.0f + dz * dz);
+        mesh->addNormal(Ponto(-dx / length, 1.0f / length, -dz / length));
+        mesh->addTexture((float) x / (heightmap.width - 1), (float) z / (heightmap.height - 1));
+    };
+
+    for (unsigned int j = 0; j < rows; j++) {
+        for (unsigned int i = 0; i < columns; i++) addVertex(xs[i], zs[j], 0.0f);
+    }
+    for (unsigned int j = 0; j + 1 < rows; j++) {
+        for (unsigned int i = 0; i + 1 < columns; i++) {
+            unsigned int v00 = first + j * columns + i, v10 = v00 + 1, v01 = v00 + columns, v11 = v01 + 1;
+            mesh->addTriangle(v00, v01, v10);
+            mesh->addTriangle(v10, v01, v11);
+        }
+    }
+
+    // The border is walked so each skirt quad faces out of the chunk
+    vector<unsigned int> border;
+    for (unsigned int i = 0; i < columns; i++) border.push_back(first + i);
+    for (unsigned int j = 1; j < rows; j++) border.push_back(first + j * columns + columns - 1);
+    for (unsigned int i = columns - 1; i-- > 0;) border.push_back(first + (rows - 1) * columns + i);
+    for (unsigned int j = rows - 1; j-- > 0;) border.push_back(first + j * columns);
+
+    unsigned int skirt = mesh->getVerticeCount();
+    for (unsigned int v : border) {
+        unsigned int i = (v - first) % columns, j = (v - first) / columns;
+        addVertex(xs[i], zs[j], skirt_depth);
+    }
+    for (size_t k = 0; k + 1 < border.size(); k++) {
+        unsigned int a = border[k], b = border[k + 1];
+        unsigned int a_low = skirt + (unsigned int) k, b_low = a_low + 1;
+        mesh->addTriangle(a, b, a_low);
+        mesh->addTriangle(b, b_low, a_low);
+    }
+}
+
+// Builds every level of a chunk, from the finest to the coarsest, with its error
+void terrainChunk(const Heightmap& heightmap, const TerrainParameters& parameters, int chunk_x, int chunk_z, float skirt_depth, Mesh* mesh) {
+    for (int level = 0; level < parameters.lod_count; level++) {
+        MeshLOD lod;
+        lod.first_index = (unsigned int) mesh->indices.size();
+        lod.first_vertex = mesh->getVerticeCount();
+        addChunkLevel(heightmap, parameters, chunk_x, chunk_z, level, skirt_depth, mesh);
+        lod.index_count = (unsigned int) mesh->indices.size() - lod.first_index;
+        lod.vertice_count = mesh->getVerticeCount() - lod.first_vertex;
+        lod.error = terrainChunkError(heightmap, parameters, chunk_x, chunk_z, level);
+        mesh->lods.push_back(lod);
+    }
+}
+
+// Writes the terrain container: the header, the chunk table and the binary .3d file of each chunk, in the
+// order of the table. The chunk files are removed once copied
+bool writeTerrainFile(string fileString, const Heightmap& heightmap, const TerrainParameters& parameters, const vector<string>& chunkFiles) {
+    File3DTerrainHeader header = {};
+    header.version = FILE3D_TERRAIN_VERSION;
+    header.header_size = sizeof(File3DTerrainHeader);
+    header.chunks_x = (uint32_t) terrainChunksX(heightmap, parameters);
+    header.chunks_z = (uint32_t) terrainChunksZ(heightmap, parameters);
+    header.chunks_offset = FILE3D_TERRAIN_HEADER_SIZE;
+    header.chunk_size = parameters.size / (heightmap.width - 1) * parameters.chunk_cells;
+
+    vector<File3DTerrainChunk> chunks(chunkFiles.size());
+    uint64_t offset = FILE3D_TERRAIN_HEADER_SIZE + chunks.size() * FILE3D_TERRAIN_CHUNK_SIZE;
+    for (size_t i = 0; i < chunkFiles.size(); i++) {
+        MappedFile chunk_file;
+        File3DHeader chunk_header;
+        if (!chunk_file.open(chunkFiles[i]) || !decodeFile3DHeader(chunk_file.begin(), chunk_file.getSize(), &chunk_header)) {
+            std::cout << "Unable to open file: " << chunkFiles[i].c_str() << "\n";
+            return false;
+        }
+
+        File3DTerrainChunk& chunk = chunks[i];
+        chunk.x = (uint32_t) (i % header.chunks_x);
+        chunk.z = (uint32_t) (i / header.chunks_x);
+        chunk.offset_low = (uint32_t) offset;
+        chunk.offset_high = (uint32_t) (offset >> 32);
+        chunk.size = (uint32_t) chunk_file.getSize();
+        for (int c = 0; c < 3; c++) {
+            chunk.min[c] = chunk_header.bounds_min[c];
+            chunk.max[c] = chunk_header.bounds_max[c];
+            if (i == 0 || chunk.min[c] < header.min[c]) header.min[c] = chunk.min[c];
+            if (i == 0 || chunk.max[c] > header.max[c]) header.max[c] = chunk.max[c];
+        }
+        offset += chunk.size;
+    }
+
+    remove(fileString.c_str());
+    ofstream file(fileString, ios::out | ios::trunc | ios::binary);
+    if (!file.is_open()) {
+        std::cout << "Unable to open file: " << fileString.c_str() << "\n";
+        return false;
+    }
+
+    char header_bytes[FILE3D_TERRAIN_HEADER_SIZE];
+    encodeFile3DTerrainHeader(&header, header_bytes);
+    file.write(header_bytes, FILE3D_TERRAIN_HEADER_SIZE);
+    for (File3DTerrainChunk& chunk : chunks) {
+        char chunk_bytes[FILE3D_TERRAIN_CHUNK_SIZE];
+        encodeFile3DTerrainChunk(&chunk, chunk_bytes);
+        file.write(chunk_bytes, FILE3D_TERRAIN_CHUNK_SIZE);
+    }
+
+    for (const string& chunkFile : chunkFiles) {
+        MappedFile chunk_file;
+        if (chunk_file.open(chunkFile)) file.write(chunk_file.begin(), chunk_file.getSize());
+        chunk_file.close();
+        remove(chunkFile.c_str());
+    }
+
+    if (!file.good()) {
+        std::cout << "Unable to write file: " << fileString.c_str() << "\n";
+        return false;
+    }
+    return true;
+}
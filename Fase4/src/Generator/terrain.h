@@ -0,0 +1,44 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include <string>
+#include <vector>
+
+#include "../utils/mesh.h"
+
+using namespace std;
+
+// Samples of a heightmap, row by row, from 0 (lowest) to 1 (highest)
+class Heightmap {
+    public:
+        int width = 0;
+        int height = 0;
+        vector<float> heights;
+
+        float at(int x, int z) const {
+            x = x < 0 ? 0 : x >= this->width ? this->width - 1 : x;
+            z = z < 0 ? 0 : z >= this->height ? this->height - 1 : z;
+            return this->heights[(size_t) z * this->width + x];
+        };
+};
+
+bool readHeightmap(string heightmapFile, Heightmap* heightmap);
+
+// Terrain made from a heightmap, centred on the origin: size units along x (the samples are square), height
+// units from the lowest to the highest sample. It's split into chunks of chunk_cells x chunk_cells cells, each
+// with lod_count levels of detail, every level with half the cells of the previous one
+class TerrainParameters {
+    public:
+        float size = 1.0f;
+        float height = 1.0f;
+        int chunk_cells = 64;
+        int lod_count = 1;
+};
+
+int terrainChunksX(const Heightmap& heightmap, const TerrainParameters& parameters);
+int terrainChunksZ(const Heightmap& heightmap, const TerrainParameters& parameters);
+float terrainChunkError(const Heightmap& heightmap, const TerrainParameters& parameters, int chunk_x, int chunk_z, int level);
+void terrainChunk(const Heightmap& heightmap, const TerrainParameters& parameters, int chunk_x, int chunk_z, float skirt_depth, Mesh* mesh);
+bool writeTerrainFile(string fileString, const Heightmap& heightmap, const TerrainParameters& parameters, const vector<string>& chunkFiles);
+
+#endif //TERRAIN_H
@@ -14,6 +14,7 @@
 #include <ostream>
 #include <string>
 #include <initializer_list>
+#include <limits>
 
 template <class T>
 class Matrix
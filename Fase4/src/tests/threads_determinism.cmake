@@ -0,0 +1,27 @@
+# Generates the same Bezier surface with 1 and 4 threads, as text and as binary, and fails unless both files
+# of each format are byte for byte the same. Run by CTest from a folder two levels below the one with files3D
+# and filesPATCH, like the generator itself, with GENERATOR set to its path
+set(FILES_FOLDER ../../files3D)
+
+foreach(format text binary)
+	set(options "")
+	if (format STREQUAL "binary")
+		set(options --binary)
+	endif ()
+
+	foreach(threads 1 4)
+		execute_process(COMMAND ${GENERATOR} --bezier teapot.patch 16 determinism_${format}_j${threads}.3d -j ${threads} ${options}
+						RESULT_VARIABLE result OUTPUT_QUIET)
+		if (NOT result EQUAL 0)
+			message(FATAL_ERROR "generator failed with -j ${threads} ${options}")
+		endif ()
+	endforeach ()
+
+	execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${FILES_FOLDER}/determinism_${format}_j1.3d
+															   ${FILES_FOLDER}/determinism_${format}_j4.3d
+					RESULT_VARIABLE different)
+	file(REMOVE ${FILES_FOLDER}/determinism_${format}_j1.3d ${FILES_FOLDER}/determinism_${format}_j4.3d)
+	if (different)
+		message(FATAL_ERROR "${format} files written with -j 1 and -j 4 are different")
+	endif ()
+endforeach ()
@@ -0,0 +1,190 @@
+#include <math.h>
+
+#include "bounds.h"
+
+void boundingBox(const PointSource& points, float min[3], float max[3]) {
+    size_t count = points.getCount();
+    for (int c = 0; c < 3; c++) min[c] = max[c] = 0.0f;
+    if (count == 0) return;
+
+    points.get(0, min);
+    points.get(0, max);
+    for (size_t i = 1; i < count; i++) {
+        float p[3];
+        points.get(i, p);
+        for (int c = 0; c < 3; c++) {
+            if (p[c] < min[c]) min[c] = p[c];
+            if (p[c] > max[c]) max[c] = p[c];
+        }
+    }
+}
+
+// Sphere with every point of a support set on its surface, centred on their affine hull
+class Ball {
+    public:
+        double centre[3] = {0.0, 0.0, 0.0};
+        double radius2 = 0.0;
+
+        bool contains(const double p[3]) const {
+            double d[3] = {p[0] - centre[0], p[1] - centre[1], p[2] - centre[2]};
+            return d[0] * d[0] + d[1] * d[1] + d[2] * d[2] <= this->radius2 * (1.0 + 1e-9) + 1e-30;
+        };
+};
+
+static inline double dot(const double a[3], const double b[3]) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static inline void cross(const double a[3], const double b[3], double res[3]) {
+    res[0] = a[1] * b[2] - a[2] * b[1];
+    res[1] = a[2] * b[0] - a[0] * b[2];
+    res[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+// Ball through 1 to 4 points. Returns false if the points are degenerate (collinear or coplanar),
+// in which case a smaller subset defines the ball
+static bool circumscribedBall(const double (*pts)[3], int n, Ball* ball) {
+    const double* p0 = pts[0];
+    double offset[3] = {0.0, 0.0, 0.0};
+
+    if (n == 2) {
+        for (int c = 0; c < 3; c++) offset[c] = (pts[1][c] - p0[c]) / 2;
+    }
+    else if (n == 3) {
+        double a[3], b[3], axb[3];
+        for (int c = 0; c < 3; c++) {
+            a[c] = pts[1][c] - p0[c];
+            b[c] = pts[2][c] - p0[c];
+        }
+        cross(a, b, axb);
+        double denominator = 2.0 * dot(axb, axb);
+        if (denominator <= 1e-24 * dot(a, a) * dot(b, b)) return false;
+
+        // ((|a|^2 b - |b|^2 a) x (a x b)) / (2 |a x b|^2)
+        double aa = dot(a, a), bb = dot(b, b), v[3];
+        for (int c = 0; c < 3; c++) v[c] = aa * b[c] - bb * a[c];
+        cross(v, axb, offset);
+        for (int c = 0; c < 3; c++) offset[c] /= denominator;
+    }
+    else if (n == 4) {
+        double a[3], b[3], d[3], bxd[3], dxa[3], axb[3];
+        for (int c = 0; c < 3; c++) {
+            a[c] = pts[1][c] - p0[c];
+            b[c] = pts[2][c] - p0[c];
+            d[c] = pts[3][c] - p0[c];
+        }
+        cross(b, d, bxd);
+        cross(d, a, dxa);
+        cross(a, b, axb);
+        double det = dot(a, bxd);
+        if (fabs(det) <= 1e-12 * sqrt(dot(a, a) * dot(b, b) * dot(d, d))) return false;
+
+        // (|a|^2 (b x d) + |b|^2 (d x a) + |d|^2 (a x b)) / (2 det)
+        double aa = dot(a, a), bb = dot(b, b), dd = dot(d, d);
+        for (int c = 0; c < 3; c++) offset[c] = (aa * bxd[c] + bb * dxa[c] + dd * axb[c]) / (2.0 * det);
+    }
+
+    for (int c = 0; c < 3; c++) ball->centre[c] = p0[c] + offset[c];
+    ball->radius2 = dot(offset, offset);
+    return true;
+}
+
+// Smallest ball containing a few points (at most 5), trying the ball through every subset of up to 4 of them.
+// support gets the points of the subset that defines it
+static Ball smallestBall(const double (*pts)[3], int n, double support[4][3], int* support_count) {
+    Ball best;
+    int best_mask = 0;
+
+    for (int mask = 1; mask < (1 << n); mask++) {
+        int subset_count = 0;
+        for (int i = 0; i < n; i++) subset_count += (mask >> i) & 1;
+        if (subset_count > 4) continue;
+
+        double subset[4][3];
+        subset_count = 0;
+        for (int i = 0; i < n; i++) {
+            if (!(mask & (1 << i))) continue;
+            for (int c = 0; c < 3; c++) subset[subset_count][c] = pts[i][c];
+            subset_count++;
+        }
+
+        Ball ball;
+        if (!circumscribedBall(subset, subset_count, &ball)) continue;
+        if (best_mask != 0 && ball.radius2 >= best.radius2) continue;
+
+        bool contains_all = true;
+        for (int i = 0; i < n && contains_all; i++) contains_all = ball.contains(pts[i]);
+        if (!contains_all) continue;
+
+        best = ball;
+        best_mask = mask;
+    }
+
+    *support_count = 0;
+    for (int i = 0; i < n; i++) {
+        if (!(best_mask & (1 << i))) continue;
+        for (int c = 0; c < 3; c++) support[*support_count][c] = pts[i][c];
+        (*support_count)++;
+    }
+    return best;
+}
+
+// Smallest sphere containing every point. Starting from a single point, the point furthest from the current
+// sphere is added to its support set, and the sphere is replaced by the smallest one of that set (at most 5
+// points), until no point is outside. The sphere grows at every step, so it ends at the smallest one, usually
+// after a few passes over the points. The radius is finally rounded up so every float point is inside
+void boundingSphere(const PointSource& points, float centre[3], float* radius) {
+    size_t count = points.getCount();
+    for (int c = 0; c < 3; c++) centre[c] = 0.0f;
+    *radius = 0.0f;
+    if (count == 0) return;
+
+    double support[4][3];
+    int support_count = 1;
+    float p[3];
+    points.get(0, p);
+    for (int c = 0; c < 3; c++) support[0][c] = p[c];
+
+    Ball ball;
+    circumscribedBall(support, 1, &ball);
+
+    for (int iteration = 0; iteration < 1000; iteration++) {
+        double furthest[3] = {0.0, 0.0, 0.0}, furthest_distance2 = -1.0;
+        for (size_t i = 0; i < count; i++) {
+            points.get(i, p);
+            double d[3] = {p[0] - ball.centre[0], p[1] - ball.centre[1], p[2] - ball.centre[2]};
+            double distance2 = dot(d, d);
+            if (distance2 > furthest_distance2) {
+                furthest_distance2 = distance2;
+                for (int c = 0; c < 3; c++) furthest[c] = p[c];
+            }
+        }
+        if (ball.contains(furthest)) break;
+
+        double candidates[5][3];
+        for (int i = 0; i < support_count; i++) {
+            for (int c = 0; c < 3; c++) candidates[i][c] = support[i][c];
+        }
+        for (int c = 0; c < 3; c++) candidates[support_count][c] = furthest[c];
+        ball = smallestBall(candidates, support_count + 1, support, &support_count);
+    }
+
+    for (int c = 0; c < 3; c++) centre[c] = (float) ball.centre[c];
+
+    double max_distance2 = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        points.get(i, p);
+        double d[3] = {(double) p[0] - centre[0], (double) p[1] - centre[1], (double) p[2] - centre[2]};
+        if (dot(d, d) > max_distance2) max_distance2 = dot(d, d);
+    }
+    double exact = sqrt(max_distance2);
+    *radius = (float) exact;
+    if (*radius < exact) *radius = nextafterf(*radius, INFINITY);
+}
+
+Bounds computeBounds(const PointSource& points) {
+    Bounds bounds;
+    boundingBox(points, bounds.min, bounds.max);
+    boundingSphere(points, bounds.centre, &bounds.radius);
+    return bounds;
+}
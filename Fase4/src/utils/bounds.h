@@ -0,0 +1,45 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <stddef.h>
+
+// Points read one at a time from wherever they're stored
+class PointSource {
+    public:
+        virtual ~PointSource() {};
+        virtual size_t getCount() const = 0;
+        virtual void get(size_t i, float p[3]) const = 0;
+};
+
+// Points stored as consecutive floats, x, y and z of each
+class FloatPoints : public PointSource {
+    private:
+        const float* values;
+        size_t count;
+    public:
+        FloatPoints(const float* values, size_t count) {
+            this->values = values;
+            this->count = count;
+        };
+        size_t getCount() const {return this->count;};
+        void get(size_t i, float p[3]) const {
+            p[0] = this->values[i * 3];
+            p[1] = this->values[i * 3 + 1];
+            p[2] = this->values[i * 3 + 2];
+        };
+};
+
+// Axis-aligned bounding box and smallest bounding sphere of a set of points
+class Bounds {
+    public:
+        float min[3] = {0.0f, 0.0f, 0.0f};
+        float max[3] = {0.0f, 0.0f, 0.0f};
+        float centre[3] = {0.0f, 0.0f, 0.0f};
+        float radius = 0.0f;
+};
+
+void boundingBox(const PointSource& points, float min[3], float max[3]);
+void boundingSphere(const PointSource& points, float centre[3], float* radius);
+Bounds computeBounds(const PointSource& points);
+
+#endif //BOUNDS_H
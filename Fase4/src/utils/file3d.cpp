@@ -0,0 +1,333 @@
+#include <string.h>
+
+#include "file3d.h"
+
+bool hostIsLittleEndian() {
+    uint32_t one = 1;
+    unsigned char first_byte;
+    memcpy(&first_byte, &one, 1);
+
+    return first_byte == 1;
+}
+
+static void putU32LE(char* out, uint32_t value) {
+    out[0] = (char) (value & 0xFF);
+    out[1] = (char) ((value >> 8) & 0xFF);
+    out[2] = (char) ((value >> 16) & 0xFF);
+    out[3] = (char) ((value >> 24) & 0xFF);
+}
+
+static uint32_t getU32LE(const char* in) {
+    const unsigned char* bytes = (const unsigned char*) in;
+
+    return (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) | ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+// Floats are stored as the bits of their value
+static void putF32LE(char* out, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(float));
+    putU32LE(out, bits);
+}
+
+static float getF32LE(const char* in) {
+    uint32_t bits = getU32LE(in);
+    float value;
+    memcpy(&value, &bits, sizeof(float));
+    return value;
+}
+
+// Checks if the given data starts with the binary .3d magic number
+bool isBinary3dFile(const char* data, size_t size) {
+    return size >= FILE3D_MAGIC_SIZE && memcmp(data, FILE3D_MAGIC, FILE3D_MAGIC_SIZE) == 0;
+}
+
+// Writes the magic number and the header fields to out, which must have FILE3D_HEADER_SIZE bytes
+void encodeFile3DHeader(const File3DHeader* header, char* out) {
+    memcpy(out, FILE3D_MAGIC, FILE3D_MAGIC_SIZE);
+
+    const uint32_t* fields = (const uint32_t*) header;
+    size_t nr_fields = sizeof(File3DHeader) / sizeof(uint32_t);
+    for (size_t i = 0; i < nr_fields; i++)
+        putU32LE(out + FILE3D_MAGIC_SIZE + i * sizeof(uint32_t), fields[i]);
+}
+
+// Reads the header of a binary .3d file, checking that all arrays it describes fit in the data.
+// Fields missing from older versions are set to zero
+bool decodeFile3DHeader(const char* data, size_t size, File3DHeader* header) {
+    memset(header, 0, sizeof(File3DHeader));
+
+    if (!isBinary3dFile(data, size) || size < FILE3D_MAGIC_SIZE + 2 * sizeof(uint32_t))
+        return false;
+
+    uint32_t version = getU32LE(data + FILE3D_MAGIC_SIZE);
+    uint32_t header_size = getU32LE(data + FILE3D_MAGIC_SIZE + sizeof(uint32_t));
+    if (version < 1 || version > FILE3D_VERSION || header_size > size - FILE3D_MAGIC_SIZE)
+        return false;
+
+    uint32_t* fields = (uint32_t*) header;
+    size_t nr_fields = header_size / sizeof(uint32_t);
+    if (nr_fields > sizeof(File3DHeader) / sizeof(uint32_t))
+        nr_fields = sizeof(File3DHeader) / sizeof(uint32_t);
+    for (size_t i = 0; i < nr_fields; i++)
+        fields[i] = getU32LE(data + FILE3D_MAGIC_SIZE + i * sizeof(uint32_t));
+
+    // Check that every array is inside the file
+    uint64_t count = header->vertice_count;
+    if (header->points_offset + count * FILE3D_POINT_SIZE(header->flags) > size)
+        return false;
+    if ((header->flags & FILE3D_HAS_NORMALS) && header->normals_offset + count * FILE3D_NORMAL_SIZE(header->flags) > size)
+        return false;
+    if ((header->flags & FILE3D_HAS_TEXTURES) && header->textures_offset + count * FILE3D_TEXTURE_SIZE(header->flags) > size)
+        return false;
+    if (header->index_count > 0) {
+        if (header->index_size != sizeof(uint16_t) && header->index_size != sizeof(uint32_t))
+            return false;
+        if (header->indices_offset + (uint64_t) header->index_count * header->index_size > size)
+            return false;
+    }
+    if (header->lod_count > 0 && header->lods_offset + (uint64_t) header->lod_count * FILE3D_LOD_SIZE > size)
+        return false;
+    if (header->region_count > 0 && header->regions_offset + (uint64_t) header->region_count * FILE3D_REGION_SIZE > size)
+        return false;
+    if (header->cluster_count > 0 && header->clusters_offset + (uint64_t) header->cluster_count * FILE3D_CLUSTER_SIZE > size)
+        return false;
+
+    return true;
+}
+
+// Writes a level of detail to out, which must have FILE3D_LOD_SIZE bytes
+void encodeFile3DLOD(const File3DLOD* lod, char* out) {
+    uint32_t error_bits;
+    memcpy(&error_bits, &lod->error, sizeof(float));
+
+    putU32LE(out, lod->first_index);
+    putU32LE(out + 4, lod->index_count);
+    putU32LE(out + 8, lod->first_vertex);
+    putU32LE(out + 12, lod->vertice_count);
+    putU32LE(out + 16, error_bits);
+}
+
+// Reads the lod_count levels of detail of a file whose header was already decoded,
+// checking that each one has indices and vertices and only uses those of the file
+bool decodeFile3DLODs(const char* data, const File3DHeader* header, File3DLOD* lods) {
+    for (uint32_t i = 0; i < header->lod_count; i++) {
+        const char* in = data + header->lods_offset + i * FILE3D_LOD_SIZE;
+        File3DLOD* lod = &lods[i];
+
+        lod->first_index = getU32LE(in);
+        lod->index_count = getU32LE(in + 4);
+        lod->first_vertex = getU32LE(in + 8);
+        lod->vertice_count = getU32LE(in + 12);
+        uint32_t error_bits = getU32LE(in + 16);
+        memcpy(&lod->error, &error_bits, sizeof(float));
+
+        if (lod->index_count == 0 || lod->vertice_count == 0 ||
+            (uint64_t) lod->first_index + lod->index_count > header->index_count ||
+            (uint64_t) lod->first_vertex + lod->vertice_count > header->vertice_count)
+            return false;
+    }
+
+    return true;
+}
+
+// Writes a region to out, which must have FILE3D_REGION_SIZE bytes
+void encodeFile3DRegion(const File3DRegion* region, char* out) {
+    putU32LE(out, region->first_index);
+    putU32LE(out + 4, region->index_count);
+    for (int i = 0; i < 3; i++) {
+        putF32LE(out + 8 + i * 4, region->min[i]);
+        putF32LE(out + 20 + i * 4, region->max[i]);
+    }
+}
+
+// Reads the region_count regions of a file whose header was already decoded,
+// checking that each one only uses indices of the file
+bool decodeFile3DRegions(const char* data, const File3DHeader* header, File3DRegion* regions) {
+    for (uint32_t i = 0; i < header->region_count; i++) {
+        const char* in = data + header->regions_offset + i * FILE3D_REGION_SIZE;
+        File3DRegion* region = &regions[i];
+
+        region->first_index = getU32LE(in);
+        region->index_count = getU32LE(in + 4);
+        for (int c = 0; c < 3; c++) {
+            region->min[c] = getF32LE(in + 8 + c * 4);
+            region->max[c] = getF32LE(in + 20 + c * 4);
+        }
+
+        if ((uint64_t) region->first_index + region->index_count > header->index_count)
+            return false;
+    }
+
+    return true;
+}
+
+// Writes a cluster to out, which must have FILE3D_CLUSTER_SIZE bytes
+void encodeFile3DCluster(const File3DCluster* cluster, char* out) {
+    putU32LE(out, cluster->first_index);
+    putU32LE(out + 4, cluster->index_count);
+    for (int i = 0; i < 3; i++) {
+        putF32LE(out + 8 + i * 4, cluster->centre[i]);
+        putF32LE(out + 24 + i * 4, cluster->cone_axis[i]);
+    }
+    putF32LE(out + 20, cluster->radius);
+    putF32LE(out + 36, cluster->cone_cutoff);
+}
+
+// Reads the cluster_count clusters of a file whose header was already decoded,
+// checking that each one only uses indices of the file
+bool decodeFile3DClusters(const char* data, const File3DHeader* header, File3DCluster* clusters) {
+    for (uint32_t i = 0; i < header->cluster_count; i++) {
+        const char* in = data + header->clusters_offset + i * FILE3D_CLUSTER_SIZE;
+        File3DCluster* cluster = &clusters[i];
+
+        cluster->first_index = getU32LE(in);
+        cluster->index_count = getU32LE(in + 4);
+        for (int c = 0; c < 3; c++) {
+            cluster->centre[c] = getF32LE(in + 8 + c * 4);
+            cluster->cone_axis[c] = getF32LE(in + 24 + c * 4);
+        }
+        cluster->radius = getF32LE(in + 20);
+        cluster->cone_cutoff = getF32LE(in + 36);
+
+        if ((uint64_t) cluster->first_index + cluster->index_count > header->index_count)
+            return false;
+    }
+
+    return true;
+}
+
+// Writes the terrain magic number and header to out, which must have FILE3D_TERRAIN_HEADER_SIZE bytes
+void encodeFile3DTerrainHeader(const File3DTerrainHeader* header, char* out) {
+    memcpy(out, FILE3D_TERRAIN_MAGIC, FILE3D_MAGIC_SIZE);
+
+    const uint32_t* fields = (const uint32_t*) header;
+    size_t nr_fields = sizeof(File3DTerrainHeader) / sizeof(uint32_t);
+    for (size_t i = 0; i < nr_fields; i++)
+        putU32LE(out + FILE3D_MAGIC_SIZE + i * sizeof(uint32_t), fields[i]);
+}
+
+// Reads the header of a terrain from the first size bytes of data. Returns false if they aren't a terrain
+// this version can read. The chunk table isn't checked, as the rest of the file is read a chunk at a time
+bool decodeFile3DTerrainHeader(const char* data, size_t size, File3DTerrainHeader* header) {
+    memset(header, 0, sizeof(File3DTerrainHeader));
+
+    if (size < FILE3D_MAGIC_SIZE + 2 * sizeof(uint32_t) || memcmp(data, FILE3D_TERRAIN_MAGIC, FILE3D_MAGIC_SIZE) != 0)
+        return false;
+
+    uint32_t version = getU32LE(data + FILE3D_MAGIC_SIZE);
+    uint32_t header_size = getU32LE(data + FILE3D_MAGIC_SIZE + sizeof(uint32_t));
+    if (version < 1 || version > FILE3D_TERRAIN_VERSION || header_size > size - FILE3D_MAGIC_SIZE)
+        return false;
+
+    uint32_t* fields = (uint32_t*) header;
+    size_t nr_fields = header_size / sizeof(uint32_t);
+    if (nr_fields > sizeof(File3DTerrainHeader) / sizeof(uint32_t))
+        nr_fields = sizeof(File3DTerrainHeader) / sizeof(uint32_t);
+    for (size_t i = 0; i < nr_fields; i++)
+        fields[i] = getU32LE(data + FILE3D_MAGIC_SIZE + i * sizeof(uint32_t));
+
+    return true;
+}
+
+// Writes a terrain chunk to out, which must have FILE3D_TERRAIN_CHUNK_SIZE bytes
+void encodeFile3DTerrainChunk(const File3DTerrainChunk* chunk, char* out) {
+    putU32LE(out, chunk->x);
+    putU32LE(out + 4, chunk->z);
+    putU32LE(out + 8, chunk->offset_low);
+    putU32LE(out + 12, chunk->offset_high);
+    putU32LE(out + 16, chunk->size);
+    for (int i = 0; i < 3; i++) {
+        putF32LE(out + 20 + i * 4, chunk->min[i]);
+        putF32LE(out + 32 + i * 4, chunk->max[i]);
+    }
+}
+
+void decodeFile3DTerrainChunk(const char* data, File3DTerrainChunk* chunk) {
+    chunk->x = getU32LE(data);
+    chunk->z = getU32LE(data + 4);
+    chunk->offset_low = getU32LE(data + 8);
+    chunk->offset_high = getU32LE(data + 12);
+    chunk->size = getU32LE(data + 16);
+    for (int i = 0; i < 3; i++) {
+        chunk->min[i] = getF32LE(data + 20 + i * 4);
+        chunk->max[i] = getF32LE(data + 32 + i * 4);
+    }
+}
+
+// Converts values of value_size bytes between little and big endian, in place
+void swapEndianness(void* values, size_t count, size_t value_size) {
+    char* bytes = (char*) values;
+
+    for (size_t i = 0; i < count; i++) {
+        char* b = bytes + i * value_size;
+        for (size_t j = 0; j < value_size / 2; j++) {
+            char aux = b[j];
+            b[j] = b[value_size - 1 - j];
+            b[value_size - 1 - j] = aux;
+        }
+    }
+}
+
+// Converts a float to the nearest half float (1 sign, 5 exponent and 10 mantissa bits), ties to even.
+// Values too large become infinity, values too small become subnormal halves or zero
+uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(float));
+
+    uint16_t sign = (uint16_t) ((bits >> 16) & 0x8000);
+    uint32_t exponent = (bits >> 23) & 0xFF;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    // Infinity and NaN
+    if (exponent == 0xFF) return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+
+    int half_exponent = (int) exponent - 127 + 15;
+    if (half_exponent >= 0x1F) return sign | 0x7C00;
+
+    // Subnormal halves keep fewer mantissa bits
+    int shift = 13;
+    if (half_exponent <= 0) {
+        if (half_exponent < -10) return sign;
+        mantissa |= 0x800000;
+        shift = 14 - half_exponent;
+        half_exponent = 0;
+    }
+
+    uint32_t half = ((uint32_t) half_exponent << 10) | (mantissa >> shift);
+    uint32_t remainder = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half & 1))) half++;   // may carry into the exponent
+
+    return sign | (uint16_t) half;
+}
+
+float halfToFloat(uint16_t half) {
+    uint32_t sign = (uint32_t) (half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    uint32_t bits;
+
+    if (exponent == 0x1F) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else if (exponent != 0) {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+    else if (mantissa == 0) {
+        bits = sign;
+    }
+    else {
+        // Subnormal half, normalized as a float
+        exponent = 127 - 15 + 1;
+        while (!(mantissa & 0x400)) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    }
+
+    float value;
+    memcpy(&value, &bits, sizeof(float));
+    return value;
+}
@@ -0,0 +1,173 @@
+#ifndef FILE3D_H
+#define FILE3D_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Binary .3d files start with this magic number, text files start with the number of points
+#define FILE3D_MAGIC "CG3D"
+#define FILE3D_MAGIC_SIZE 4
+#define FILE3D_VERSION 7
+
+// Flags indicating which vertex attributes are stored in a binary .3d file
+#define FILE3D_HAS_NORMALS 0x1
+#define FILE3D_HAS_TEXTURES 0x2
+#define FILE3D_QUANTIZED 0x4
+#define FILE3D_HAS_BOUNDS 0x8
+#define FILE3D_TRIANGLE_STRIPS 0x10
+
+// Offsets are 32-bit, so a binary file can't be larger than this
+#define FILE3D_MAX_FILE_SIZE 0xFFFFFFFFull
+
+// Largest index stored with 16 bits, 0xFFFF is kept free to be used as a primitive restart index
+#define FILE3D_MAX_SHORT_INDEX 0xFFFE
+
+// Header of a binary .3d file.
+// All fields are stored as little-endian 32-bit unsigned integers, offsets are in bytes from the
+// start of the file and point to raw little-endian float arrays (xyz for points and normals, uv for textures).
+// Since version 2, triangles are described by index_count 16 or 32-bit indices (index_size bytes each),
+// a file without indices is drawn as a list of independent triangles.
+// Since version 3, a file can hold several levels of detail of the same model, described by lod_count
+// entries at lods_offset.
+// Since version 4, attributes can be quantized (FILE3D_QUANTIZED): each point is 4 16-bit integers (x, y, z and
+// padding) multiplied by quantization_scale and added to quantization_centre, each normal is 4 8-bit integers
+// (x, y, z and padding) where 127 is 1, and each texture coordinate is 2 half floats. The quantization
+// fields are stored as the bits of their floats.
+// Since version 5, files with FILE3D_HAS_BOUNDS have the bounding box and the smallest bounding sphere of their
+// points (in model units, after quantization), and large files have region_count bounding boxes of consecutive
+// ranges of triangles at regions_offset.
+// Since version 6, a file can be split into cluster_count clusters of a few triangles (meshlets) at
+// clusters_offset, each with its bounding sphere and normal cone.
+// Since version 7, the indices of files with FILE3D_TRIANGLE_STRIPS are triangle strips, joined by the largest
+// index of their size (0xFFFF or 0xFFFFFFFF) to restart the strip. Levels of detail are ranges of strips.
+// header_size lets newer versions append fields without breaking older readers.
+typedef struct {
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t flags;
+    uint32_t vertice_count;
+    uint32_t points_offset;
+    uint32_t normals_offset;
+    uint32_t textures_offset;
+    uint32_t index_count;
+    uint32_t index_size;
+    uint32_t indices_offset;
+    uint32_t lod_count;
+    uint32_t lods_offset;
+    float quantization_centre[3];
+    float quantization_scale;
+    float bounds_min[3];
+    float bounds_max[3];
+    float sphere_centre[3];
+    float sphere_radius;
+    uint32_t region_count;
+    uint32_t regions_offset;
+    uint32_t cluster_count;
+    uint32_t clusters_offset;
+} File3DHeader;
+
+// Level of detail of a binary .3d file: a range of the index array, drawing its own range of vertices.
+// Levels are stored from the finest to the coarsest. error is the largest distance between the level
+// and the real surface, in model units, and is stored as the bits of a float
+typedef struct {
+    uint32_t first_index;
+    uint32_t index_count;
+    uint32_t first_vertex;
+    uint32_t vertice_count;
+    float error;
+} File3DLOD;
+
+#define FILE3D_LOD_SIZE (5 * sizeof(uint32_t))
+
+// Region of a binary .3d file: a range of the index array, never crossing levels of detail, and the bounding
+// box of the points its triangles use, stored as the bits of its floats
+typedef struct {
+    uint32_t first_index;
+    uint32_t index_count;
+    float min[3];
+    float max[3];
+} File3DRegion;
+
+#define FILE3D_REGION_SIZE (8 * sizeof(uint32_t))
+
+// Cluster of a binary .3d file: a range of the index array, never crossing levels of detail, the smallest
+// sphere around its points and the cone of its triangle normals, stored as the bits of their floats.
+// The cluster faces away from cameras where dot(centre - camera, cone_axis) >= cone_cutoff * |centre - camera| + radius
+typedef struct {
+    uint32_t first_index;
+    uint32_t index_count;
+    float centre[3];
+    float radius;
+    float cone_axis[3];
+    float cone_cutoff;
+} File3DCluster;
+
+#define FILE3D_CLUSTER_SIZE (10 * sizeof(uint32_t))
+
+// Size in bytes of each vertex attribute, depending on the header flags
+#define FILE3D_POINT_SIZE(flags) ((flags) & FILE3D_QUANTIZED ? 4 * sizeof(int16_t) : 3 * sizeof(float))
+#define FILE3D_NORMAL_SIZE(flags) ((flags) & FILE3D_QUANTIZED ? 4 * sizeof(int8_t) : 3 * sizeof(float))
+#define FILE3D_TEXTURE_SIZE(flags) ((flags) & FILE3D_QUANTIZED ? 2 * sizeof(uint16_t) : 2 * sizeof(float))
+
+// Largest quantized point coordinate and normal component
+#define FILE3D_MAX_QUANTIZED_POINT 32767
+#define FILE3D_MAX_QUANTIZED_NORMAL 127
+
+// Size in bytes of the header as written in the file, magic number included
+#define FILE3D_HEADER_SIZE (FILE3D_MAGIC_SIZE + sizeof(File3DHeader))
+
+// Terrain container: a header, a table of chunks and, for each chunk, a whole binary .3d file with its own
+// levels of detail, so chunks can be read one at a time. Fields are little-endian 32-bit like the .3d header
+#define FILE3D_TERRAIN_MAGIC "CG3T"
+#define FILE3D_TERRAIN_VERSION 1
+
+// chunks_x by chunks_z chunks of chunk_size units each, the terrain being inside min and max.
+// Chunk (x, z) is entry z * chunks_x + x of the table at chunks_offset
+typedef struct {
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t chunks_x;
+    uint32_t chunks_z;
+    uint32_t chunks_offset;
+    float chunk_size;
+    float min[3];
+    float max[3];
+} File3DTerrainHeader;
+
+// Chunk of a terrain: the offset (in two halves, so terrains can be larger than 4 GB) and size of its
+// .3d file, and the bounding box of its points
+typedef struct {
+    uint32_t x;
+    uint32_t z;
+    uint32_t offset_low;
+    uint32_t offset_high;
+    uint32_t size;
+    float min[3];
+    float max[3];
+} File3DTerrainChunk;
+
+#define FILE3D_TERRAIN_HEADER_SIZE (FILE3D_MAGIC_SIZE + sizeof(File3DTerrainHeader))
+#define FILE3D_TERRAIN_CHUNK_SIZE (11 * sizeof(uint32_t))
+
+bool hostIsLittleEndian();
+
+bool isBinary3dFile(const char* data, size_t size);
+void encodeFile3DHeader(const File3DHeader* header, char* out);
+bool decodeFile3DHeader(const char* data, size_t size, File3DHeader* header);
+void encodeFile3DLOD(const File3DLOD* lod, char* out);
+bool decodeFile3DLODs(const char* data, const File3DHeader* header, File3DLOD* lods);
+void encodeFile3DRegion(const File3DRegion* region, char* out);
+bool decodeFile3DRegions(const char* data, const File3DHeader* header, File3DRegion* regions);
+void encodeFile3DCluster(const File3DCluster* cluster, char* out);
+bool decodeFile3DClusters(const char* data, const File3DHeader* header, File3DCluster* clusters);
+void encodeFile3DTerrainHeader(const File3DTerrainHeader* header, char* out);
+bool decodeFile3DTerrainHeader(const char* data, size_t size, File3DTerrainHeader* header);
+void encodeFile3DTerrainChunk(const File3DTerrainChunk* chunk, char* out);
+void decodeFile3DTerrainChunk(const char* data, File3DTerrainChunk* chunk);
+
+void swapEndianness(void* values, size_t count, size_t value_size);
+
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t half);
+
+#endif //FILE3D_H
@@ -0,0 +1,143 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <vector>
+#include <stddef.h>
+
+#include "ponto.h"
+
+using namespace std;
+
+// Index joining two triangle strips, when a mesh is made of strips
+#define MESH_RESTART_INDEX 0xFFFFFFFFu
+
+// Level of detail of a mesh holding several tessellations of the same model, one after the other.
+// error is the largest distance between the level and the real surface
+class MeshLOD {
+    public:
+        unsigned int first_index = 0;
+        unsigned int index_count = 0;
+        unsigned int first_vertex = 0;
+        unsigned int vertice_count = 0;
+        float error = 0.0f;
+};
+
+// Cluster (meshlet) of a mesh: a range of its indices with a few vertices, the smallest sphere around them and
+// the cone of its triangle normals. Every triangle faces away from cameras where
+// dot(centre - camera, cone_axis) >= cone_cutoff * |centre - camera| + radius. cone_cutoff is 1 if the
+// normals are too spread for the cluster to ever face away
+class MeshCluster {
+    public:
+        unsigned int first_index = 0;
+        unsigned int index_count = 0;
+        float centre[3] = {0.0f, 0.0f, 0.0f};
+        float radius = 0.0f;
+        float cone_axis[3] = {0.0f, 0.0f, 0.0f};
+        float cone_cutoff = 1.0f;
+};
+
+// Receives a mesh section by section, in the same order as the .3d files: every point, then every
+// normal, then every texture coordinate and finally every index, each section in as many batches as
+// wanted. begin() gives the sizes of the whole mesh up front, so the sink never has to hold it
+class MeshSink {
+    public:
+        virtual ~MeshSink() {};
+        virtual void setLODs(const vector<MeshLOD>& /* lods */) {};        // before begin(), if the mesh has levels of detail
+        virtual void setClusters(const vector<MeshCluster>& /* clusters */) {};   // before begin(), if the mesh has clusters
+        virtual void setStrips() {};     // before begin(), if the indices are triangle strips, only handled by writers
+        virtual void begin(unsigned int vertice_count, unsigned int index_count, bool normals, bool textures) = 0;
+        virtual void points(const float* values, size_t count) = 0;       // count floats, 3 per vertex
+        virtual void normals(const float* values, size_t count) = 0;      // count floats, 3 per vertex
+        virtual void textures(const float* values, size_t count) = 0;     // count floats, 2 per vertex
+        virtual void indices(const unsigned int* values, size_t count) = 0;
+        virtual void end() = 0;
+};
+
+// Indexed triangle mesh: unique vertices plus three indices per triangle
+class Mesh {
+    public:
+        vector<float> points;           // x, y, z of each vertex
+        vector<float> normals;          // x, y, z of each vertex, empty if there's no normals
+        vector<float> textures;         // u, v of each vertex, empty if there's no texture coordinates
+        vector<unsigned int> indices;   // three per triangle
+        vector<MeshLOD> lods;           // empty if the mesh has a single level of detail
+        vector<MeshCluster> clusters;   // empty if the mesh isn't split in clusters
+        bool strips = false;            // indices are triangle strips joined by MESH_RESTART_INDEX, not triangles
+
+        unsigned int getVerticeCount() {return (unsigned int) (this->points.size() / 3);};
+        unsigned int getTriangleCount() {return (unsigned int) (this->indices.size() / 3);};
+
+        // Adds a vertex position and returns its index
+        unsigned int addPoint(Ponto p) {
+            this->points.push_back(p.getX());
+            this->points.push_back(p.getY());
+            this->points.push_back(p.getZ());
+            return getVerticeCount() - 1;
+        };
+        void addNormal(Ponto n) {
+            this->normals.push_back(n.getX());
+            this->normals.push_back(n.getY());
+            this->normals.push_back(n.getZ());
+        };
+        void addTexture(float u, float v) {
+            this->textures.push_back(u);
+            this->textures.push_back(v);
+        };
+        void addTriangle(unsigned int a, unsigned int b, unsigned int c) {
+            this->indices.push_back(a);
+            this->indices.push_back(b);
+            this->indices.push_back(c);
+        };
+
+        // Make room for count vertices or triangles at the end of the mesh, to be written directly
+        float* addPoints(unsigned int count) {
+            size_t size = this->points.size();
+            this->points.resize(size + count * 3);
+            return &this->points[size];
+        };
+        unsigned int* addTriangles(unsigned int count) {
+            size_t size = this->indices.size();
+            this->indices.resize(size + count * 3);
+            return &this->indices[size];
+        };
+
+        // Gives the whole mesh to a sink
+        void writeTo(MeshSink* sink) {
+            if (!this->lods.empty()) sink->setLODs(this->lods);
+            if (!this->clusters.empty()) sink->setClusters(this->clusters);
+            if (this->strips) sink->setStrips();
+            sink->begin(getVerticeCount(), (unsigned int) this->indices.size(), !this->normals.empty(), !this->textures.empty());
+            sink->points(this->points.data(), this->points.size());
+            sink->normals(this->normals.data(), this->normals.size());
+            sink->textures(this->textures.data(), this->textures.size());
+            sink->indices(this->indices.data(), this->indices.size());
+            sink->end();
+        };
+};
+
+// Sink that appends what it receives to a mesh, offsetting the indices by the vertices already there.
+// Levels of detail and clusters of the received mesh are ignored
+class MeshBuilder : public MeshSink {
+    private:
+        Mesh* mesh;
+        unsigned int base = 0;
+    public:
+        MeshBuilder(Mesh* mesh) {this->mesh = mesh;};
+
+        void begin(unsigned int vertice_count, unsigned int index_count, bool normals, bool textures) {
+            this->base = this->mesh->getVerticeCount();
+            this->mesh->points.reserve(this->mesh->points.size() + vertice_count * 3);
+            if (normals) this->mesh->normals.reserve(this->mesh->normals.size() + vertice_count * 3);
+            if (textures) this->mesh->textures.reserve(this->mesh->textures.size() + vertice_count * 2);
+            this->mesh->indices.reserve(this->mesh->indices.size() + index_count);
+        };
+        void points(const float* values, size_t count) {this->mesh->points.insert(this->mesh->points.end(), values, values + count);};
+        void normals(const float* values, size_t count) {this->mesh->normals.insert(this->mesh->normals.end(), values, values + count);};
+        void textures(const float* values, size_t count) {this->mesh->textures.insert(this->mesh->textures.end(), values, values + count);};
+        void indices(const unsigned int* values, size_t count) {
+            for (size_t i = 0; i < count; i++) this->mesh->indices.push_back(this->base + values[i]);
+        };
+        void end() {};
+};
+
+#endif //MESH_H